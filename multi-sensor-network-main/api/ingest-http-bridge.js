@@ -2,9 +2,185 @@
 // This endpoint accepts HTTP POST requests from ESP32
 // Writes data to Supabase database for persistent storage
 // Also maintains in-memory latestReading for backward compatibility
+//
+// POST body can be a single reading object, a JSON array of readings
+// (gateway batch mode), NDJSON (Content-Type: application/x-ndjson, one reading per line)
+// or the gateway's binary batch format (Content-Type: application/octet-stream)
 
 let latestReading = null; // For backward compatibility with frontend
 
+// co2 is null for readings without CO2 (stations taking T/RH-only measurements in between)
+function isValidReading(m) {
+  return (
+    !!m &&
+    (typeof m.co2 === 'number' || m.co2 === null) &&
+    typeof m.temperature === 'number' &&
+    typeof m.humidity === 'number'
+  );
+}
+
+// Binary batch format from the gateway (Content-Type: application/octet-stream).
+// Layout is documented in include/uplink_binary.h:
+// "MS", version, flags, station count (u16), record count (u16), records (13 bytes each),
+// station MAC table (6 bytes each), CRC-32. All little endian.
+const BIN_HEADER_LEN = 8;
+const BIN_RECORD_LEN = 13;
+const BIN_MAC_LEN = 6;
+const BIN_CO2_NONE = 0xffff; // Reading without CO2
+
+const CRC_TABLE = (() => {
+  const table = new Uint32Array(256);
+  for (let n = 0; n < 256; n++) {
+    let c = n;
+    for (let k = 0; k < 8; k++) {
+      c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+    }
+    table[n] = c >>> 0;
+  }
+  return table;
+})();
+
+function crc32(buf, end) {
+  let crc = 0xffffffff;
+  for (let i = 0; i < end; i++) {
+    crc = CRC_TABLE[(crc ^ buf[i]) & 0xff] ^ (crc >>> 8);
+  }
+  return (crc ^ 0xffffffff) >>> 0;
+}
+
+function decodeBinaryBatch(buf, now = Date.now()) {
+  if (buf.length < BIN_HEADER_LEN + 4 || buf[0] !== 0x4d || buf[1] !== 0x53) {
+    throw new Error('Not a binary batch');
+  }
+  const version = buf[2];
+  if (version !== 1) {
+    throw new Error(`Unsupported binary batch version ${version}`);
+  }
+  const stationCount = buf.readUInt16LE(4);
+  const recordCount = buf.readUInt16LE(6);
+  const tableStart = BIN_HEADER_LEN + recordCount * BIN_RECORD_LEN;
+  const crcStart = tableStart + stationCount * BIN_MAC_LEN;
+  if (buf.length !== crcStart + 4) {
+    throw new Error('Binary batch length mismatch');
+  }
+  if (crc32(buf, crcStart) !== buf.readUInt32LE(crcStart)) {
+    throw new Error('Binary batch CRC mismatch');
+  }
+
+  const macs = [];
+  for (let i = 0; i < stationCount; i++) {
+    const off = tableStart + i * BIN_MAC_LEN;
+    const parts = [];
+    for (let j = 0; j < BIN_MAC_LEN; j++) {
+      parts.push(buf[off + j].toString(16).toUpperCase().padStart(2, '0'));
+    }
+    macs.push(parts.join(':'));
+  }
+
+  const readings = [];
+  for (let i = 0; i < recordCount; i++) {
+    const off = BIN_HEADER_LEN + i * BIN_RECORD_LEN;
+    const mac = macs[buf.readUInt16LE(off)];
+    if (!mac) {
+      throw new Error('Binary batch station index out of range');
+    }
+    readings.push({
+      mac,
+      device_id: mac,
+      temperature: buf.readInt16LE(off + 2) / 100,
+      humidity: buf.readUInt16LE(off + 4) / 100,
+      co2: buf.readUInt16LE(off + 6) === BIN_CO2_NONE ? null : buf.readUInt16LE(off + 6),
+      rssi: buf.readInt8(off + 8),
+      ts: now - buf.readUInt32LE(off + 9),
+    });
+  }
+  return readings;
+}
+
+// Turn the request body into a list of readings (single object, array, NDJSON or binary batch)
+function parseReadings(req) {
+  let body = req.body;
+  if (Buffer.isBuffer(body)) {
+    if ((req.headers['content-type'] || '').includes('application/octet-stream')) {
+      return decodeBinaryBatch(body);
+    }
+    body = body.toString('utf8');
+  }
+  if (typeof body === 'string') {
+    const contentType = req.headers['content-type'] || '';
+    if (contentType.includes('ndjson')) {
+      return body
+        .split('\n')
+        .map((line) => line.trim())
+        .filter((line) => line.length > 0)
+        .map((line) => {
+          try {
+            return JSON.parse(line);
+          } catch (e) {
+            return null;
+          }
+        });
+    }
+    try {
+      body = JSON.parse(body);
+    } catch (e) {
+      return [];
+    }
+  }
+  if (Array.isArray(body)) {
+    return body;
+  }
+  if (body && Array.isArray(body.readings)) {
+    return body.readings;
+  }
+  return body ? [body] : [];
+}
+
+// Readings replayed from the gateway backlog carry age_ms (time since the gateway received them)
+function readingTimestamp(r, now) {
+  if (typeof r.ts === 'number') return r.ts;
+  if (typeof r.age_ms === 'number' && r.age_ms >= 0) return now - r.age_ms;
+  return now;
+}
+
+// Row for the Supabase table. ts: when the reading was taken (readingTimestamp), stored as
+// recorded_at next to the table's own received_at
+function supabaseRow(m, ts) {
+  return {
+    device_id: m.device_id || m.mac || 'unknown',
+    temperature: m.temperature,
+    humidity: m.humidity,
+    co2: m.co2,
+    recorded_at: new Date(ts).toISOString(),
+  };
+}
+
+// One POST per gateway batch: the Edge Function takes a single row or an array of rows and
+// inserts an array in one statement
+async function forwardToSupabase(rows, url, apiKey) {
+  try {
+    // Forward to Supabase Edge Function
+    const response = await fetch(url, {
+      method: 'POST',
+      headers: {
+        'Content-Type': 'application/json',
+        'X-API-Key': apiKey,
+      },
+      body: JSON.stringify(rows.length === 1 ? rows[0] : rows),
+    });
+
+    if (response.ok) {
+      const result = await response.json();
+      console.log('Data written to Supabase:', result);
+    } else {
+      console.error('Supabase write failed:', response.status, await response.text());
+    }
+  } catch (error) {
+    console.error('Error writing to Supabase:', error);
+    // Don't fail the request if Supabase write fails
+  }
+}
+
 export default async function handler(req, res) {
   // Enable CORS
   res.setHeader('Access-Control-Allow-Origin', '*');
@@ -39,7 +215,14 @@ export default async function handler(req, res) {
   }
 
   // Accept HTTP POST from ESP32
-  const m = req.body;
+  let items;
+  try {
+    items = parseReadings(req);
+  } catch (error) {
+    console.error('Rejected binary batch:', error.message);
+    return res.status(400).json({ ok: false, error: error.message });
+  }
+  const m = items.length === 1 ? items[0] : null;
   
   // Allow messages with just a "message" field (for connection notifications)
   if (m && m.message) {
@@ -51,63 +234,43 @@ export default async function handler(req, res) {
   }
   
   // Otherwise, require sensor data fields
-  if (
-    !m ||
-    typeof m.co2 !== 'number' ||
-    typeof m.temperature !== 'number' ||
-    typeof m.humidity !== 'number'
-  ) {
+  const readings = items.filter(isValidReading);
+  if (readings.length === 0) {
     return res.status(400).json({ ok: false, error: 'Invalid payload' });
   }
 
-  // Store in memory for backward compatibility
+  // Store in memory for backward compatibility (newest reading of the batch)
+  const now = Date.now();
+  const last = readings[readings.length - 1];
   latestReading = {
-    mac: m.mac || m.device_id || null,
-    device_id: m.device_id || m.mac || null,
-    temperature: m.temperature,
-    co2: m.co2,
-    humidity: m.humidity,
-    ts: Date.now(),
+    mac: last.mac || last.device_id || null,
+    device_id: last.device_id || last.mac || null,
+    temperature: last.temperature,
+    co2: last.co2,
+    humidity: last.humidity,
+    ts: readingTimestamp(last, now),
   };
 
-  console.log('INGEST (via HTTP bridge):', latestReading);
+  if (readings.length === 1) {
+    console.log('INGEST (via HTTP bridge):', latestReading);
+  } else {
+    console.log(`INGEST (via HTTP bridge): batch of ${readings.length} readings (${items.length - readings.length} rejected)`);
+  }
 
   // Also write to Supabase if configured
   const SUPABASE_EDGE_FUNCTION_URL = process.env.SUPABASE_EDGE_FUNCTION_URL;
   const SUPABASE_API_KEY = process.env.SUPABASE_API_KEY;
 
   if (SUPABASE_EDGE_FUNCTION_URL && SUPABASE_API_KEY) {
-    try {
-      // Forward to Supabase Edge Function
-      const response = await fetch(SUPABASE_EDGE_FUNCTION_URL, {
-        method: 'POST',
-        headers: {
-          'Content-Type': 'application/json',
-          'X-API-Key': SUPABASE_API_KEY,
-        },
-        body: JSON.stringify({
-          device_id: m.device_id || m.mac || 'unknown',
-          temperature: m.temperature,
-          humidity: m.humidity,
-          co2: m.co2,
-        }),
-      });
-
-      if (response.ok) {
-        const result = await response.json();
-        console.log('Data written to Supabase:', result);
-      } else {
-        console.error('Supabase write failed:', response.status, await response.text());
-      }
-    } catch (error) {
-      console.error('Error writing to Supabase:', error);
-      // Don't fail the request if Supabase write fails
-    }
+    await forwardToSupabase(readings.map((r) => supabaseRow(r, readingTimestamp(r, now))),
+      SUPABASE_EDGE_FUNCTION_URL, SUPABASE_API_KEY);
   }
 
   return res.status(200).json({ 
     ok: true, 
-    message: 'Data received'
+    message: 'Data received',
+    accepted: readings.length,
+    rejected: items.length - readings.length
   });
 }
 
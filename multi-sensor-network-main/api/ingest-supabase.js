@@ -81,7 +81,8 @@ export default async function handler(req, res) {
       temperature: latest.temperature || 0,
       humidity: latest.humidity || 0,
       co2: latest.co2 || 0,
-      ts: latest.received_at ? new Date(latest.received_at).getTime() : Date.now(),
+      // recorded_at: when the sensor took the reading (older rows only have received_at)
+      ts: new Date(latest.recorded_at || latest.received_at || Date.now()).getTime(),
     };
 
     return res.status(200).json({
@@ -5,12 +5,138 @@ const path = require("path");
 const app = express();
 app.use(cors());
 app.use(express.json());
+// Gateway batch mode can also send NDJSON (one reading per line)
+app.use(express.text({ type: "application/x-ndjson", limit: "1mb" }));
+// ... or its compact binary batch format
+app.use(express.raw({ type: "application/octet-stream", limit: "1mb" }));
 
 // Serve static files from the gateway-server directory
 app.use(express.static(__dirname));
 
 const clients = new Set();
 
+// co2 is null for readings without CO2 (stations taking T/RH-only measurements in between)
+function isValidReading(m) {
+  return (
+    !!m &&
+    (typeof m.co2 === "number" || m.co2 === null) &&
+    typeof m.temperature === "number" &&
+    typeof m.humidity === "number"
+  );
+}
+
+// Binary batch format from the gateway (Content-Type: application/octet-stream).
+// Layout is documented in include/uplink_binary.h:
+// "MS", version, flags, station count (u16), record count (u16), records (13 bytes each),
+// station MAC table (6 bytes each), CRC-32. All little endian.
+const BIN_HEADER_LEN = 8;
+const BIN_RECORD_LEN = 13;
+const BIN_MAC_LEN = 6;
+const BIN_CO2_NONE = 0xffff; // Reading without CO2
+
+const CRC_TABLE = (() => {
+  const table = new Uint32Array(256);
+  for (let n = 0; n < 256; n++) {
+    let c = n;
+    for (let k = 0; k < 8; k++) {
+      c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+    }
+    table[n] = c >>> 0;
+  }
+  return table;
+})();
+
+function crc32(buf, end) {
+  let crc = 0xffffffff;
+  for (let i = 0; i < end; i++) {
+    crc = CRC_TABLE[(crc ^ buf[i]) & 0xff] ^ (crc >>> 8);
+  }
+  return (crc ^ 0xffffffff) >>> 0;
+}
+
+function decodeBinaryBatch(buf, now = Date.now()) {
+  if (buf.length < BIN_HEADER_LEN + 4 || buf[0] !== 0x4d || buf[1] !== 0x53) {
+    throw new Error("Not a binary batch");
+  }
+  const version = buf[2];
+  if (version !== 1) {
+    throw new Error(`Unsupported binary batch version ${version}`);
+  }
+  const stationCount = buf.readUInt16LE(4);
+  const recordCount = buf.readUInt16LE(6);
+  const tableStart = BIN_HEADER_LEN + recordCount * BIN_RECORD_LEN;
+  const crcStart = tableStart + stationCount * BIN_MAC_LEN;
+  if (buf.length !== crcStart + 4) {
+    throw new Error("Binary batch length mismatch");
+  }
+  if (crc32(buf, crcStart) !== buf.readUInt32LE(crcStart)) {
+    throw new Error("Binary batch CRC mismatch");
+  }
+
+  const macs = [];
+  for (let i = 0; i < stationCount; i++) {
+    const off = tableStart + i * BIN_MAC_LEN;
+    const parts = [];
+    for (let j = 0; j < BIN_MAC_LEN; j++) {
+      parts.push(buf[off + j].toString(16).toUpperCase().padStart(2, "0"));
+    }
+    macs.push(parts.join(":"));
+  }
+
+  const readings = [];
+  for (let i = 0; i < recordCount; i++) {
+    const off = BIN_HEADER_LEN + i * BIN_RECORD_LEN;
+    const mac = macs[buf.readUInt16LE(off)];
+    if (!mac) {
+      throw new Error("Binary batch station index out of range");
+    }
+    readings.push({
+      mac,
+      device_id: mac,
+      temperature: buf.readInt16LE(off + 2) / 100,
+      humidity: buf.readUInt16LE(off + 4) / 100,
+      co2: buf.readUInt16LE(off + 6) === BIN_CO2_NONE ? null : buf.readUInt16LE(off + 6),
+      rssi: buf.readInt8(off + 8),
+      ts: now - buf.readUInt32LE(off + 9),
+    });
+  }
+  return readings;
+}
+
+// Turn the request body into a list of readings (single object, JSON array, NDJSON or binary batch)
+function parseReadings(body) {
+  if (Buffer.isBuffer(body)) {
+    return decodeBinaryBatch(body);
+  }
+  if (typeof body === "string") {
+    return body
+      .split("\n")
+      .map((line) => line.trim())
+      .filter((line) => line.length > 0)
+      .map((line) => {
+        try {
+          return JSON.parse(line);
+        } catch (e) {
+          return null;
+        }
+      });
+  }
+  if (Array.isArray(body)) {
+    return body;
+  }
+  if (body && Array.isArray(body.readings)) {
+    return body.readings;
+  }
+  return body ? [body] : [];
+}
+
+// Readings replayed from the gateway backlog carry age_ms (time since the gateway received them)
+function readingTimestamp(r, now) {
+  if (typeof r.ts === "number") return r.ts;
+  if (typeof r.age_ms === "number" && r.age_ms >= 0) return now - r.age_ms;
+  return now;
+}
+
 app.post("/ingest", (req, res) => {
   const m = req.body;
   if (!m || typeof m.co2 !== "number") {
@@ -23,8 +149,16 @@ app.post("/ingest", (req, res) => {
 });
 
 // HTTP Bridge endpoint for ESP32-S3 (accepts same format as Vercel endpoint)
+// Body is a single reading, a JSON array of readings, NDJSON or a binary batch (gateway batch mode)
 app.post("/api/ingest-http-bridge", (req, res) => {
-  const m = req.body;
+  let items;
+  try {
+    items = parseReadings(req.body);
+  } catch (error) {
+    console.error("Rejected binary batch:", error.message);
+    return res.status(400).json({ ok: false, error: error.message });
+  }
+  const m = items.length === 1 ? items[0] : null;
   
   // Allow messages with just a "message" field (for connection notifications)
   if (m && m.message) {
@@ -36,24 +170,30 @@ app.post("/api/ingest-http-bridge", (req, res) => {
   }
   
   // Otherwise, require sensor data fields
-  if (
-    !m ||
-    typeof m.co2 !== "number" ||
-    typeof m.temperature !== "number" ||
-    typeof m.humidity !== "number"
-  ) {
+  const readings = items.filter(isValidReading);
+  if (readings.length === 0) {
     return res.status(400).json({ ok: false, error: "Invalid payload" });
   }
 
-  console.log("INGEST (via HTTP bridge):", req.body);
+  if (readings.length === 1) {
+    console.log("INGEST (via HTTP bridge):", readings[0]);
+  } else {
+    console.log(`INGEST (via HTTP bridge): batch of ${readings.length} readings (${items.length - readings.length} rejected)`);
+  }
   
-  // Broadcast to SSE clients
-  const payload = `data: ${JSON.stringify(m)}\n\n`;
-  clients.forEach((r) => r.write(payload));
+  // Broadcast to SSE clients (one event per reading, the dashboard expects single readings)
+  const now = Date.now();
+  readings.forEach((r) => {
+    r.ts = readingTimestamp(r, now);
+    const payload = `data: ${JSON.stringify(r)}\n\n`;
+    clients.forEach((c) => c.write(payload));
+  });
   
   res.json({ 
     ok: true, 
-    message: "Data received"
+    message: "Data received",
+    accepted: readings.length,
+    rejected: items.length - readings.length
   });
 });
 
@@ -81,6 +221,7 @@ app.get("/api/status", (req, res) => {
     connectedClients: clients.size,
     endpoints: {
       ingest: "POST /ingest",
+      ingestBridge: "POST /api/ingest-http-bridge (object, array, NDJSON or binary batch)",
       events: "GET /events",
       dashboard: "GET /"
     }
@@ -157,10 +157,11 @@ async function getSensorData() {
         // Debug logging
         console.log(`Received sensor data - Temp: ${temperature}°C, CO2: ${co2}ppm, Humidity: ${humidity}%`);
 
+        // co2 is null when the station measured temperature and humidity only
         return {
             temperature: `${temperature.toFixed(1)} °C`,
             humidity: `${humidity.toFixed(1)} %`,
-            co2: `${co2.toFixed(0)} ppm`,
+            co2: co2 === null ? '– ppm' : `${co2.toFixed(0)} ppm`,
             rawTemp: temperature,
             rawCo2: co2,
             rawHumidity: humidity
@@ -220,7 +221,8 @@ async function updateDashboard() {
     // --- Graph Update Logic ---
     // Only add new data points when we receive NEW real sensor data (non-zero values that changed)
     // This ensures graphs only update when actual new measurements arrive
-    if (data.rawTemp !== null && data.rawCo2 !== null && data.rawHumidity !== null) {
+    // (rawCo2 may be null: a T/RH-only reading leaves a gap in the CO2 graph)
+    if (data.rawTemp !== null && data.rawHumidity !== null) {
         // Check if this is real sensor data (not placeholder zeros)
         const isRealData = data.rawTemp !== 0 || data.rawCo2 !== 0 || data.rawHumidity !== 0;
         
@@ -1,9 +1,10 @@
-
 // Required standard libarries
 #include <Arduino.h>
 #include <Wire.h>
 #include <SensirionI2cScd4x.h>      // https://github.com/Sensirion/arduino-i2c-scd4x/blob/master/src/SensirionI2cScd4x.h -- Thank you Sensirion!
 #include "typedef.h"
+#include "config.h"
+#include "serial_log.h"
 
 // SCD41 standards
 #ifdef NO_ERROR
@@ -19,65 +20,135 @@
 #define I2C_SDA_PIN 26
 #define I2C_SCL_PIN 25
 
-// Sensor class
-SensirionI2cScd4x sensor;
-
-static char errorMessage[64];
-static int16_t error;
-    // Message struct to hold sensor data
-sensor_msg msg;
+// Command timings from the SCD41 datasheet (ms)
+#define SCD41_POWER_UP_MS 500          // Wait after power-on before the first command
+#define SCD41_PERIODIC_FIRST_MS 5000   // First reading after start_periodic_measurement
+#define SCD41_SINGLE_SHOT_MS 5000      // measure_single_shot
+#define SCD41_SINGLE_SHOT_RHT_MS 50    // measure_single_shot_rht_only
+#define SCD41_CMD_MEASURE_SINGLE_SHOT 0x219D
+#define SCD41_CMD_MEASURE_SINGLE_SHOT_RHT 0x2196
 
-uint16_t co2Concentration = 0;
-float temperature = 0.0;
-float relativeHumidity = 0.0;
+// The SCD41 driver and its error handling. One measurement is start() ... [sleep for
+// measureTimeMs()] ... waitReady() ... read(); the ESP32 may deep sleep in between, the sensor
+// keeps measuring. Mode (SCD41_MODE in config.h):
+//   periodic:    start_periodic_measurement, read the first reading, stop again
+//   single shot: one measure_single_shot (CO2, T, RH) or measure_single_shot_rht_only (T, RH;
+//                the sensor reports CO2 as 0, read() turns that into CO2_NONE), the sensor idles
+//                in between
+// The driver's measureSingleShot*() block for the whole measurement, so the single-shot commands
+// are written to the bus directly and the data-ready flag is polled instead.
+class Scd41Sensor {
+public:
+  Scd41Sensor() : error(NO_ERROR) { errorMessage[0] = 0; }
 
-void initSensor(){
+  // I2C bus and driver only. Enough after a deep sleep wake: the sensor keeps running (or idling)
+  // while the ESP32 sleeps, so it needs neither the power-up wait nor wakeUp()
+  void attach() {
     pinMode(I2C_SDA_PIN, INPUT_PULLUP);
     pinMode(I2C_SCL_PIN, INPUT_PULLUP);
-    Wire.begin(I2C_SDA_PIN,I2C_SCL_PIN);
-    sensor.begin(Wire, SCD41_I2C_ADDR_62);
-    delay(500);
+    Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+    driver.begin(Wire, SCD41_I2C_ADDR_62);
+  }
 
+  // Full init after power-on
+  void init() {
+    attach();
+    delay(SCD41_POWER_UP_MS);
     // Wake up the sensor (if in low power mode)
-    error = sensor.wakeUp();
-    if (error != NO_ERROR) {
-        Serial.print("Error trying to execute wakeUp(): ");
-        errorToString(error, errorMessage, sizeof errorMessage);
-        Serial.println(errorMessage);
-    }
+    check(driver.wakeUp(), "wakeUp()");
+  }
 
-}
+  // Start one measurement; co2 = false takes the fast T/RH-only shot (single-shot mode only)
+  bool start(bool co2) {
+#if SCD41_MODE == SCD41_MODE_SINGLE_SHOT
+    return sendCommand(co2 ? SCD41_CMD_MEASURE_SINGLE_SHOT : SCD41_CMD_MEASURE_SINGLE_SHOT_RHT);
+#else
+    (void)co2;
+    return check(driver.startPeriodicMeasurement(), "startPeriodicMeasurement()");
+#endif
+  }
 
-sensor_msg readSDA41() {
-    // Read the measured data from the sensor
-    error = sensor.readMeasurement(co2Concentration, temperature,
-                                            relativeHumidity);
-    if (error != NO_ERROR) {
-        Serial.print("Error trying to execute measureMeasurement(): ");
-        errorToString(error, errorMessage, sizeof errorMessage);
-        Serial.println(errorMessage);
+  // Time from start() until the reading should be ready; the scheduler sleeps this long
+  static uint32_t measureTimeMs(bool co2) {
+#if SCD41_MODE == SCD41_MODE_SINGLE_SHOT
+    return co2 ? SCD41_SINGLE_SHOT_MS : SCD41_SINGLE_SHOT_RHT_MS;
+#else
+    (void)co2;
+    return SCD41_PERIODIC_FIRST_MS;
+#endif
+  }
+
+  // Poll the data-ready flag every SCD41_POLL_MS for up to timeoutMs (the sleep timer and the
+  // sensor's own clock both drift a little). Returns true once a reading is waiting.
+  bool waitReady(uint32_t timeoutMs) {
+    unsigned long start = millis();
+    for (;;) {
+      bool ready = false;
+      if (!check(driver.getDataReadyStatus(ready), "getDataReadyStatus()")) return false;
+      if (ready) return true;
+      if (millis() - start >= timeoutMs) {
+        LOG_W("SCD41: no data after %lu ms extra wait\n", millis() - start);
+        return false;
+      }
+      delay(SCD41_POLL_MS);
     }
+  }
 
-    error = sensor.stopPeriodicMeasurement();
-    if (error != NO_ERROR) {
-        Serial.print("Error trying to execute stopPeriodicMeasurement(): ");
-        errorToString(error, errorMessage, sizeof errorMessage);
-        Serial.println(errorMessage);
+  // Read the measured data into out (temperature, humidity, co2). Periodic mode stops the
+  // measurement again, so the sensor idles until the next start(). co2Measured: what start() was
+  // told; after a T/RH-only shot out.co2 is CO2_NONE, not the sensor's 0.
+  bool read(sensor_msg& out, bool co2Measured = true) {
+    uint16_t co2 = 0;
+    float temperature = 0.0;
+    float humidity = 0.0;
+    bool ok = check(driver.readMeasurement(co2, temperature, humidity), "readMeasurement()");
+#if SCD41_MODE == SCD41_MODE_SINGLE_SHOT
+    if (!co2Measured) co2 = CO2_NONE;
+#else
+    (void)co2Measured;   // Periodic measurements always include CO2
+    check(driver.stopPeriodicMeasurement(), "stopPeriodicMeasurement()");
+#endif
+    if (co2 == CO2_NONE) {
+      LOG_I("CO2 concentration [ppm]: - (T/RH only)\nTemperature [°C]: %.2f\nRelative Humidity [RH]: %.2f\n",
+            temperature, humidity);
+    } else {
+      LOG_I("CO2 concentration [ppm]: %u\nTemperature [°C]: %.2f\nRelative Humidity [RH]: %.2f\n",
+            co2, temperature, humidity);
     }
 
-    Serial.print("CO2 concentration [ppm]: ");
-    Serial.print(co2Concentration);
-    Serial.println();
-    Serial.print("Temperature [°C]: ");
-    Serial.print(temperature);
-    Serial.println();
-    Serial.print("Relative Humidity [RH]: ");
-    Serial.print(relativeHumidity);
+    // Fill the message struct
+    out.co2 = co2;
+    out.temperature = temperature;
+    out.humidity = humidity;
+    return ok;
+  }
 
-    // Fill the message struct and return this
-    msg.co2 = co2Concentration; 
-    msg.temperature = temperature;
-    msg.humidity = relativeHumidity;
+  // Log a failed driver call; returns true if err is NO_ERROR
+  bool check(int16_t err, const char* what) {
+    error = err;
+    if (err == NO_ERROR) return true;
+    errorToString(err, errorMessage, sizeof errorMessage);
+    LOG_E("Error trying to execute %s: %s\n", what, errorMessage);
+    return false;
+  }
 
-    return msg; // return the message with sensor data
-}
+  SensirionI2cScd4x driver;   // For commands not wrapped here (calibration)
+  int16_t error;              // Result of the last driver call
+  char errorMessage[64];
+
+private:
+  // Send a command without arguments and return at once
+  bool sendCommand(uint16_t command) {
+    Wire.beginTransmission(SCD41_I2C_ADDR_62);
+    Wire.write((uint8_t)(command >> 8));
+    Wire.write((uint8_t)(command & 0xFF));
+    uint8_t status = Wire.endTransmission();
+    if (status != 0) {
+      LOG_E("Error trying to send command 0x%04X: I2C status %u\n", command, status);
+      error = -1;
+      return false;
+    }
+    error = NO_ERROR;
+    return true;
+  }
+};
@@ -10,7 +10,69 @@
 
 #define FAN_DURATION 3          // Duration to run the fan in seconds (only relevant if fan is used). 1-5 seconds should be sufficient to clear stale air
 
-#define NUM_STATIONS 10         // Number of stations objects that can be "connected" to gateway
+#define NUM_STATIONS 256        // Number of stations objects that can be "connected" to gateway (hash table, lookup cost does not grow with it)
+
+// RSSI source per node. Promiscuous mode runs a callback for every frame on the channel, which
+// costs CPU on the gateway and awake time on battery stations, so it is only used where the
+// ESP-NOW receive callback has no RSSI (older ESP32 SDK without esp_now_recv_info_t).
+#define RSSI_MODE_OFF         0     // No RSSI tracking (stations: they never need it)
+#define RSSI_MODE_RECV_INFO   1     // RSSI from recv_info->rx_ctrl in OnDataRecv (ESP32-S3)
+#define RSSI_MODE_PROMISCUOUS 2     // Sniff ESP-NOW action frames in promiscuous mode
+#ifndef RSSI_MODE                   // Can be overridden per env in platformio.ini (-DRSSI_MODE=...)
+  #if !defined(ROLE_GATEWAY)
+    #define RSSI_MODE RSSI_MODE_OFF
+  #elif defined(ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32S3)
+    #define RSSI_MODE RSSI_MODE_RECV_INFO
+  #else
+    #define RSSI_MODE RSSI_MODE_PROMISCUOUS
+  #endif
+#endif
+#define RSSI_EWMA_ALPHA 0.125f      // Weight of a new sample in the per-station RSSI mean/variance
+
+// Station batching: readings are buffered in RTC memory and sent STATION_BATCH_READINGS at a
+// time in one ESP-NOW frame (max MULTI_MAX_READINGS = 26), so the radio starts once per frame
+// instead of once per reading. 1 sends every reading as it is taken.
+#ifndef STATION_BATCH_READINGS      // Can be overridden per env in platformio.ini (-DSTATION_BATCH_READINGS=...)
+#define STATION_BATCH_READINGS 1
+#endif
+
+// Station -> gateway delivery. A station broadcasts until a gateway acknowledges one of its
+// frames (MSG_TYPE_ACK), then sends unicast to that gateway's MAC (cached in RTC memory), which
+// the MAC layer acknowledges. Failed sends are retried with bounded exponential backoff.
+#define ESPNOW_SEND_ATTEMPTS 4          // Tries per frame
+#define ESPNOW_RETRY_BASE_MS 10         // Backoff before the 2nd try, doubled for each further try (plus jitter)
+#define ESPNOW_RETRY_MAX_MS 80          // Backoff cap
+#define ESPNOW_SEND_TIMEOUT_MS 50       // Max wait for the send callback
+#define ESPNOW_ACK_TIMEOUT_MS 100       // Max wait for the gateway's ACK to a broadcast frame
+#define ESPNOW_PEER_LOST_AFTER 3        // Undelivered frames in a row before going back to broadcast discovery
+
+// Channel discovery. ESP-NOW only reaches nodes on the same channel, and the gateway has to use its
+// AP's channel. The gateway broadcasts a beacon (MSG_TYPE_BEACON) with that channel; a station
+// scans for it on a cold boot and keeps the channel in RTC memory, so timer wakes just set it.
+#define GATEWAY_BEACON_INTERVAL_MS 100  // Beacon period on the gateway
+#define ESPNOW_SCAN_DWELL_MS 150        // Time a scanning station listens on each channel (> beacon period)
+#define ESPNOW_SCAN_CHANNELS 13         // Channels 1..13 are scanned
+#define ESPNOW_RESCAN_AFTER 6           // Undelivered frames in a row before the station scans again
+#ifndef DIAG_INTERVAL_S
+#define DIAG_INTERVAL_S 600             // Stations send their awake-time profile (MSG_TYPE_DIAG) this often
+#endif
+#if ESPNOW_SCAN_DWELL_MS <= GATEWAY_BEACON_INTERVAL_MS
+#error "ESPNOW_SCAN_DWELL_MS must be longer than GATEWAY_BEACON_INTERVAL_MS, or a scan can miss the gateway"
+#endif
+
+// SCD41 measurement mode (SDA41_sensor.h). Periodic mode keeps the sensor measuring (and drawing
+// periodic-mode current) until the reading is taken; single shot measures once and lets it idle.
+#define SCD41_MODE_PERIODIC    0    // start_periodic_measurement each cycle, stopped after the read
+#define SCD41_MODE_SINGLE_SHOT 1    // measure_single_shot each cycle
+#ifndef SCD41_MODE                  // Can be overridden per env in platformio.ini (-DSCD41_MODE=...)
+#define SCD41_MODE SCD41_MODE_PERIODIC
+#endif
+#ifndef SCD41_CO2_EVERY
+#define SCD41_CO2_EVERY 1           // Single shot: CO2 on every Nth reading, T/RH-only shots (no CO2, CO2_NONE) in between
+#endif
+#define SCD41_POLL_MS 10            // Data-ready poll interval
+#define SCD41_READY_TIMEOUT_MS 1000 // Max extra wait for data past the nominal measurement time
+#define SCD41_DEEP_SLEEP_MIN_MS 300 // Shorter measurement waits are slept through in light sleep (no reboot)
 
 #define CALI_DURATION 2         // Hours that it will take for the device to recalibrate itself - default = 4
 
@@ -32,9 +94,88 @@ bool needCalibration = true;      // set to true by default, turned into false i
 // ESP32-S3 Arduino framework 3.3.4 doesn't have WiFiClientSecure
 // Railway accepts HTTP connections and runs 24/7
 // HTTP works perfectly with Railway (tested and confirmed)
+#ifndef SUPABASE_EDGE_FUNCTION_URL   // The native env points this at a local server
 #define SUPABASE_EDGE_FUNCTION_URL "http://multisensor.up.railway.app/api/ingest-http-bridge"
+#endif
 
 // API key for Supabase Edge Function authentication
 // This matches the TELEMETRY_API_KEY secret set in Supabase
 // Note: The proxy will add this header, but we keep it for consistency
-#define SUPABASE_API_KEY "Isaak124"
\ No newline at end of file
+#define SUPABASE_API_KEY "Isaak124"
+
+// Gateway uplink queue: the ESP-NOW callback only copies readings into this queue,
+// a separate FreeRTOS task does the HTTP upload.
+#define UPLINK_QUEUE_LEN 64         // Readings buffered between receive and upload (must be a power of two)
+#define UPLINK_TASK_STACK 8192      // Uploader task stack size in bytes
+#define UPLINK_TASK_PRIORITY 1      // Keep below the Wi-Fi task so uploads never starve the radio
+#define UPLINK_TASK_CORE 1          // Wi-Fi runs on core 0, uploads run on the app core
+
+// Uplink format / batching. Readings from all stations are collected and sent in one POST.
+// A batch is sent as soon as it reaches UPLINK_BATCH_MAX_COUNT readings, UPLINK_BATCH_MAX_BYTES
+// of body, or when its oldest reading is UPLINK_BATCH_MAX_AGE_MS old.
+#define UPLINK_FORMAT_JSON       0  // One JSON object per POST (no batching, old behaviour)
+#define UPLINK_FORMAT_JSON_ARRAY 1  // JSON array of readings
+#define UPLINK_FORMAT_NDJSON     2  // Newline-delimited JSON, one reading per line
+#define UPLINK_FORMAT_BINARY     3  // Compact binary batch (application/octet-stream), see uplink_binary.h
+#ifndef UPLINK_FORMAT               // Can be overridden per env in platformio.ini (-DUPLINK_FORMAT=...)
+#define UPLINK_FORMAT UPLINK_FORMAT_JSON_ARRAY
+#endif
+#define UPLINK_BATCH_MAX_COUNT 32       // Max readings per POST
+#define UPLINK_BATCH_MAX_BYTES 4096     // Max body size per POST in bytes
+#define UPLINK_BATCH_MAX_AGE_MS 5000    // Max time a reading waits in a partly filled batch
+
+// Uplink mode. Raw: every reading is uploaded. Aggregate: readings are summarised per station over
+// tumbling windows of AGG_WINDOW_S seconds (count, min, max, mean, last, see reading_aggregator.h)
+// and only one summary per station and window is uploaded; the raw readings stay in the local
+// station history.
+#define UPLINK_MODE_RAW       0
+#define UPLINK_MODE_AGGREGATE 1
+#ifndef UPLINK_MODE                 // Can be overridden per env in platformio.ini (-DUPLINK_MODE=...)
+#define UPLINK_MODE UPLINK_MODE_RAW
+#endif
+#ifndef AGG_WINDOW_S
+#define AGG_WINDOW_S 300                // Window length in seconds (aligned to the clock)
+#endif
+#define AGG_GRACE_S (2 * MEASUREMENT_INTERVAL)  // Wait this long past the window end for a quiet station
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+#define UPLINK_RECORD_INTERVAL_S AGG_WINDOW_S
+#else
+#define UPLINK_RECORD_INTERVAL_S MEASUREMENT_INTERVAL
+#endif
+
+// Store-and-forward backlog (gateway PSRAM). Readings that can't be uploaded (Wi-Fi down,
+// server errors) are kept here and replayed in large batches once the uplink is back.
+#define UPLINK_BACKLOG_HOURS 6          // Outage length the backlog should cover
+#define UPLINK_BACKLOG_MAX_LEN 32768    // Upper bound (~900 KB of PSRAM) when many stations are registered
+#define UPLINK_BACKLOG_WANTED ((uint32_t)NUM_STATIONS * UPLINK_BACKLOG_HOURS * 3600 / UPLINK_RECORD_INTERVAL_S)
+#define UPLINK_BACKLOG_LEN (UPLINK_BACKLOG_WANTED < UPLINK_BACKLOG_MAX_LEN ? UPLINK_BACKLOG_WANTED : UPLINK_BACKLOG_MAX_LEN)
+#define UPLINK_REPLAY_MAX_COUNT 256     // Max readings per replay POST
+#define UPLINK_REPLAY_MAX_BYTES 16384   // Max body size per replay POST
+#define UPLINK_REPLAY_INTERVAL_MS 500   // Min time between replay POSTs (rate limit)
+#define UPLINK_REPLAY_RETRY_MS 10000    // Back-off after a failed upload
+
+// Write-ahead log on the "wal" LittleFS partition (partitions_gateway.csv), so readings that
+// were not uploaded yet survive a reboot. See flash_wal.h for the format.
+#define WAL_SEGMENT_PAGES 64            // 256-byte pages per segment file (16 KB)
+#define WAL_MAX_SEGMENTS 64             // 1 MB; the oldest segment is dropped beyond this
+#define WAL_COMMIT_INTERVAL_MS 5000     // Group commit: max time a reading waits before it is written
+#define WAL_CURSOR_INTERVAL_MS 10000    // Min time between upload cursor writes
+
+// Per-station reading history in PSRAM (station_history.h), compressed to ~5 bytes per reading,
+// for local dashboards and backfill without a round trip to the cloud
+#define HISTORY_RETENTION_HOURS 72       // Older readings are dropped
+#define HISTORY_BLOCK_BYTES 512          // Allocation unit; each station fills one block at a time
+#define HISTORY_READING_BYTES 5          // Average compressed size, for sizing the pool
+#define HISTORY_POOL_MAX_BYTES (2 * 1024 * 1024)  // Upper bound on PSRAM for the history
+// Enough for the retention period with all NUM_STATIONS stations, up to the cap. With the cap the
+// oldest blocks are evicted sooner: 2 MB is ~400k readings, 72 h for ~20 stations at 10 s, or
+// ~4.5 h with 256 stations (see "blocks evicted" in the stats).
+#define HISTORY_POOL_WANTED ((uint32_t)NUM_STATIONS * HISTORY_RETENTION_HOURS * 3600 / MEASUREMENT_INTERVAL * HISTORY_READING_BYTES)
+#define HISTORY_POOL_BYTES (HISTORY_POOL_WANTED < HISTORY_POOL_MAX_BYTES ? HISTORY_POOL_WANTED : HISTORY_POOL_MAX_BYTES)
+
+// Prometheus metrics endpoint on the gateway (metrics_server.h): GET http://<gateway>:METRICS_PORT/metrics
+#ifndef METRICS_PORT                // Can be overridden per env in platformio.ini; 0 = no metrics server
+#define METRICS_PORT 8080
+#endif
+#define METRICS_TASK_STACK 6144     // HTTP server task stack size in bytes
+#define METRICS_TASK_PRIORITY 1     // Scrapes never delay the radio; same level as the uplink task
@@ -9,6 +9,29 @@
 
 #include "typedef.h"
 #include "config.h"
+#include "station_registry.h"
+#include "seq_tracker.h"
+#include "serial_log.h"
+#include "phase_profiler.h"
+#ifdef ROLE_STATION
+#include <Preferences.h>
+#endif
+#ifdef ROLE_GATEWAY
+#include "uplink_queue.h"
+#include "uplink_client.h"
+#include "uplink_batch.h"
+#include "uplink_backlog.h"
+#include "flash_wal_littlefs.h"
+#include "station_history.h"
+#include "reading_aggregator.h"
+#include "gateway_metrics.h"
+#include <freertos/semphr.h>
+#include <time.h>
+#endif
+
+// MAC address as log arguments: LOG_I("From " MAC_FMT "\n", MAC_ARGS(mac))
+#define MAC_FMT "%02X:%02X:%02X:%02X:%02X:%02X"
+#define MAC_ARGS(m) (m)[0], (m)[1], (m)[2], (m)[3], (m)[4], (m)[5]
 
 // HTTP support - ESP32-S3 Arduino framework doesn't include WiFiClientSecure in version 3.3.4
 // Using HTTP to Cloudflare Worker which forwards to HTTPS Vercel
@@ -19,8 +42,30 @@
 #endif
 
 bool send_done = false;
+bool send_ok = false;     // Status of the last completed send
+
+#ifdef ROLE_STATION
+// Gateway this station delivers to, learned from its ACK (see sendToGateway)
+RTC_DATA_ATTR uint8_t gateway_mac[6];
+RTC_DATA_ATTR bool gateway_known = false;
+RTC_DATA_ATTR uint8_t failed_sends = 0;   // Undelivered frames in a row
+RTC_DATA_ATTR uint8_t gateway_channel = 0; // Channel the gateway is on, 0 until a scan found it
+volatile bool ack_received = false;
+// Time the last sendToGateway() spent per step (us), for the station's phase profile
+uint32_t last_tune_us = 0;
+uint32_t last_send_us = 0;
+uint32_t last_ack_wait_us = 0;
+volatile bool beacon_heard = false;        // Set by OnDataRecv while scanning
+volatile uint8_t beacon_channel = 0;
+uint8_t beacon_mac[6];
+uint8_t own_mac[6];
+#endif
 // FF:FF:FF:FF:FF:FF is broadcast MAC
 uint8_t broadcastAddr[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+#ifdef ROLE_GATEWAY
+// Counted in OnDataRecv and the uplink task, served on /metrics (metrics_server.h)
+GatewayMetrics gatewayMetrics;
+#endif
 
 
 
@@ -28,324 +73,631 @@ uint8_t broadcastAddr[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
 class Station {
 public:
   uint8_t mac[6]; // MAC address
-  int rssi;
+  int rssi;       // Smoothed RSSI in dBm (rounded rssiMean), 0 until the first sample
+  float rssiMean; // Exponentially weighted mean and variance of the RSSI samples
+  float rssiVar;
+  uint32_t rssiSamples;
+  uint32_t lastSeenMs;  // millis() of the last frame from this station
+  SeqTracker link;  // Duplicates, gaps and reorders of this station's messages
   struct readings { // Store sensor readings
     float temperature;
-    uint16_t co2;
+    uint16_t co2;   // CO2_NONE: T/RH-only reading
     float humidity;
   } readings;
 
-  Station(const uint8_t* mac_addr) : rssi(0) {
+  Station() : rssi(0), rssiMean(0), rssiVar(0), rssiSamples(0), lastSeenMs(0) {
+    memset(mac, 0, 6);
+  }
+
+  Station(const uint8_t* mac_addr) : rssi(0), rssiMean(0), rssiVar(0), rssiSamples(0), lastSeenMs(0) {
     memcpy(mac, mac_addr, 6);
     // Initialize other members if needed
   }
 
+  // Incremental EWMA of mean and variance (alpha = RSSI_EWMA_ALPHA), so single
+  // fades or reflections don't make the link look better or worse than it is
   void updateRSSI(int new_rssi) {
-    rssi = new_rssi;
-  }
-
-  void handleMessage(const uint8_t* data, int len) {
-    if (len == sizeof(sensor_msg)) {
-      const sensor_msg* msg = (const sensor_msg*)data;
-      readings.temperature = msg->temperature;
-      readings.co2 = msg->co2;
-      readings.humidity = msg->humidity;
-      Serial.print("Message from station: ");
-      for (int i = 0; i < 6; ++i) {
-        Serial.printf("%02X", mac[i]);
-        if (i < 5) Serial.print(":");
+    if (rssiSamples++ == 0) {
+      rssiMean = new_rssi;
+      rssiVar = 0;
+    } else {
+      float diff = new_rssi - rssiMean;
+      float incr = RSSI_EWMA_ALPHA * diff;
+      rssiMean += incr;
+      rssiVar = (1.0f - RSSI_EWMA_ALPHA) * (rssiVar + diff * incr);
+    }
+    rssi = (int)lroundf(rssiMean);
+  }
+
+  // Take a decoded reading. Returns false if it was already seen (numbered: boot/seq are valid)
+  bool handleMessage(const sensor_msg& msg, bool numbered) {
+    if (numbered) {
+      SeqResult r = link.accept(msg.boot, msg.seq);
+      if (r == SEQ_DUPLICATE || r == SEQ_STALE) {
+#ifdef ROLE_GATEWAY
+        metricInc(gatewayMetrics.duplicates);
+#endif
+        LOG_D("%s message from station (boot %u, seq %u), ignored\n",
+              r == SEQ_DUPLICATE ? "Duplicate" : "Stale", msg.boot, msg.seq);
+        return false;
       }
-      Serial.printf(" | Temp: %.2f, CO2: %d, Humidity: %.2f | RSSI: %d\n", readings.temperature, readings.co2, readings.humidity, rssi);
+      LOG_D("Seq %u (boot %u, station uptime %u s)%s\n", msg.seq, msg.boot, msg.uptime_s,
+            r == SEQ_REORDERED ? " - out of order" : "");
+    }
+    readings.temperature = msg.temperature;
+    readings.co2 = msg.co2;
+    readings.humidity = msg.humidity;
+    if (readings.co2 == CO2_NONE) {
+      LOG_I("Message from station: " MAC_FMT " | Temp: %.2f, CO2: -, Humidity: %.2f | RSSI: %d\n", MAC_ARGS(mac),
+            readings.temperature, readings.humidity, rssi);
     } else {
-      Serial.println("Invalid sensor_msg length");
+      LOG_I("Message from station: " MAC_FMT " | Temp: %.2f, CO2: %d, Humidity: %.2f | RSSI: %d\n", MAC_ARGS(mac),
+            readings.temperature, readings.co2, readings.humidity, rssi);
     }
+    return true;
   }
 };
 
-// Generate Station objects 
-Station* stations[NUM_STATIONS]; 
-int stationCount = 0;
+#ifdef ROLE_GATEWAY
+// Registered stations, stored inline and looked up by MAC in constant time (gateway only:
+// ~30 KB that station builds do not need)
+StationRegistry<Station, NUM_STATIONS> stations;
 
-// Helper to find or create a Station object for a given MAC
 Station* findStation(const uint8_t* mac) {
-  for (int i = 0; i < stationCount; ++i) {
-    if (memcmp(stations[i]->mac, mac, 6) == 0) {
-      return stations[i];
-    }
-  }
-  return NULL;
+  return stations.find(mac);
 }
 
-// Debug function to print all registered stations
+// Debug function to print all registered stations (direct output: from loop() or at exit only)
 void printRegisteredStations() {
-  Serial.printf("Registered stations: %d / %d\n", stationCount, NUM_STATIONS);
-  for (int i = 0; i < stationCount; ++i) {
-    Serial.printf("  Station %d: ", i);
-    for (int j = 0; j < 6; ++j) {
-      Serial.printf("%02X", stations[i]->mac[j]);
-      if (j < 5) Serial.print(":");
-    }
-    Serial.printf(" (RSSI: %d)\n", stations[i]->rssi);
+  LOG_PRINTF("Registered stations: %d / %d\n", stations.size(), NUM_STATIONS);
+  for (int i = 0; i < stations.size(); ++i) {
+    LOG_PRINTF("  Station %d: " MAC_FMT " (RSSI: %d dBm, std dev %.1f dB, %u samples)\n", i,
+               MAC_ARGS(stations[i].mac), stations[i].rssi, sqrtf(stations[i].rssiVar), stations[i].rssiSamples);
+    const SeqTracker& l = stations[i].link;
+    LOG_PRINTF("    loss %.2f%% (%u received, %u lost, %u duplicates, %u reordered, %u restarts)\n",
+               l.lossRate() * 100.0f, l.received, l.lost, l.duplicates, l.reordered, l.restarts);
   }
 }
 
-// Create or get the existing Station
-Station* getOrCreateStation(const uint8_t* mac) {
-  Station* existing = findStation(mac);
-  if (existing) {
-    return existing;
+// Totals over all stations, and the station with the worst loss rate
+void printLinkStats() {
+  uint32_t received = 0, lost = 0, duplicates = 0, reordered = 0;
+  int worst = -1;
+  for (int i = 0; i < stations.size(); ++i) {
+    const SeqTracker& l = stations[i].link;
+    received += l.received;
+    lost += l.lost;
+    duplicates += l.duplicates;
+    reordered += l.reordered;
+    if (worst < 0 || l.lossRate() > stations[worst].link.lossRate()) worst = i;
+  }
+  LOG_I("Links: %u received, %u lost (%.2f%%), %u duplicates dropped, %u reordered\n",
+        received, lost, (received + lost) ? lost * 100.0f / (received + lost) : 0.0f,
+        duplicates, reordered);
+  if (worst >= 0 && stations[worst].link.lost) {
+    const uint8_t* m = stations[worst].mac;
+    LOG_I("  Worst link: " MAC_FMT ", loss %.2f%%\n",
+          MAC_ARGS(m), stations[worst].link.lossRate() * 100.0f);
   }
-  if (stationCount < NUM_STATIONS) {
-    stations[stationCount] = new Station(mac);
-    return stations[stationCount++];
+}
+
+// Awake-time profile a station sent (MSG_TYPE_DIAG): per phase count, mean, p90 and max, and the
+// estimated charge per day it implies
+void printDiag(const uint8_t* mac, const diag_msg& d) {
+  LOG_I("Diagnostics from " MAC_FMT " (boot %u): %u wakes in %u s, awake %u ms (%.1f ms per wake)\n",
+        MAC_ARGS(mac), d.boot, d.wakes, d.window_s, d.awake_ms,
+        d.wakes ? (float)d.awake_ms / d.wakes : 0.0f);
+  for (uint8_t i = 0; i < d.count; ++i) {
+    const diag_phase& p = d.phases[i];
+    LOG_I("  %-13s %5u x  mean %7u us  p90 < %7u us  max %7u us\n", phaseName(p.phase), p.count,
+          p.mean_us, diagQuantileUs(p, 0.9f), p.max_us);
   }
-  return NULL; // Max stations reached
+  LOG_I("  ~%.2f mAh/day awake (estimate; sleep current and sensor not included)\n", diagAwakeMahPerDay(d));
 }
 
-// Promiscuous RX callback to update RSSI for matching stations
+// Create or get the existing Station (NULL when NUM_STATIONS are registered)
+Station* getOrCreateStation(const uint8_t* mac) {
+  return stations.findOrInsert(mac);
+}
+
+// Promiscuous RX callback to update RSSI for matching stations (RSSI_MODE_PROMISCUOUS).
+// Runs for every management frame on the channel, so it rejects what it can before the lookup.
 void promiscuous_rx_cb(void *buf, wifi_promiscuous_pkt_type_t type) {
   if (type != WIFI_PKT_MGMT)
     return;
   const wifi_promiscuous_pkt_t *ppkt = (wifi_promiscuous_pkt_t *)buf;
   const wifi_ieee80211_packet_t *ipkt = (wifi_ieee80211_packet_t *)ppkt->payload;
   const wifi_ieee80211_mac_hdr_t *hdr = &ipkt->hdr;
+  // ESP-NOW uses action frames; skip beacons, probes etc. and senders that can't be stations
+  if ((hdr->frame_ctrl[0] & 0xFC) != 0xD0 || !stations.mayContain(hdr->addr2))
+    return;
   Station* station = findStation(hdr->addr2);
     if (station) {
       station->updateRSSI(ppkt->rx_ctrl.rssi);
     }
 }
+#endif
 
 // Callback when data is sent
 void OnDataSent(const uint8_t* mac, esp_now_send_status_t status) {
-  Serial.print("Send Status: ");
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Success" : "Fail");
+  (void)mac;
+#ifdef ROLE_STATION
+  // (The gateway only sends broadcast beacons and ACKs, whose status means nothing)
+  LOG_D("Send Status: %s\n", status == ESP_NOW_SEND_SUCCESS ? "Success" : "Fail");
+#endif
+  send_ok = status == ESP_NOW_SEND_SUCCESS;
   send_done = true;
 }
 
 // Forward received data to web server (only compiled for gateway)
 #ifdef ROLE_GATEWAY
-void sendToServer(const Station* st) {
-  if (!st) return;
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi not connected, skipping HTTP send");
-    return;
-  }
 
-  // Using WiFiClientSecure for HTTPS connections (works on ESP32-S3!)
-  
-  // Check free heap memory
-  Serial.printf("Free heap before connection: %d bytes\n", ESP.getFreeHeap());
+// Ingest endpoint client: URL parsed once at startup, connection kept open between batches
+UplinkClient uplinkClient(SUPABASE_EDGE_FUNCTION_URL);
+
+// POST a ready-made body to the ingest endpoint. Returns the HTTP status code, or a negative UPLINK_ERR_* code.
+int sendToServer(const uint8_t* body, size_t len, const char* contentType) {
   if (ESP.getFreeHeap() < 50000) {
-    Serial.println("WARNING: Low free heap memory");
-  }
-  
-  String fullUrl = String(SUPABASE_EDGE_FUNCTION_URL);
-  bool useHTTPS = fullUrl.startsWith("https://");
-  
-  Serial.printf("Connecting to server: %s\n", fullUrl.c_str());
-  Serial.printf("Protocol: %s\n", useHTTPS ? "HTTPS" : "HTTP");
-  
-  // Extract domain and path from URL
-  String domain = fullUrl;
-  int protocolEnd = domain.indexOf("://");
-  if (protocolEnd > 0) {
-    domain = domain.substring(protocolEnd + 3);
+    LOG_W("WARNING: Low free heap memory (%d bytes)\n", ESP.getFreeHeap());
   }
-  
-  String path = "/";
-  int pathStart = domain.indexOf("/");
-  if (pathStart > 0) {
-    path = domain.substring(pathStart);
-    domain = domain.substring(0, pathStart);
-  }
-  
-  // Extract port (default 443 for HTTPS, 80 for HTTP)
-  int port = useHTTPS ? 443 : 80;
-  int portStart = domain.indexOf(":");
-  if (portStart > 0) {
-    String portStr = domain.substring(portStart + 1);
-    port = portStr.toInt();
-    domain = domain.substring(0, portStart);
-  }
-  
-  Serial.printf("Host: %s, Port: %d, Path: %s\n", domain.c_str(), port, path.c_str());
-  
-  // Build MAC string for device_id
-  char macStr[18];
-  snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-           st->mac[0], st->mac[1], st->mac[2],
-           st->mac[3], st->mac[4], st->mac[5]);
-
-  // Build JSON payload
-  String payload = "{";
-  payload += "\"mac\":\""; payload += macStr; payload += "\",";
-  payload += "\"device_id\":\""; payload += macStr; payload += "\",";
-  payload += "\"temperature\":"; payload += String(st->readings.temperature, 2); payload += ",";
-  payload += "\"humidity\":"; payload += String(st->readings.humidity, 2); payload += ",";
-  payload += "\"co2\":"; payload += String(st->readings.co2);
-  payload += "}";
-
-  Serial.print("Sending data to server: ");
-  Serial.println(payload);
-  
-  int httpCode = -1;
-  
-  // Use HTTP to Cloudflare Worker (ESP32-S3 doesn't have WiFiClientSecure in Arduino framework 3.3.4)
-  Serial.println("Using HTTP to Cloudflare Worker...");
-  WiFiClient regularClient;
-  
-  // Set longer timeout for connection
-  regularClient.setTimeout(15000);
-  
-  Serial.printf("Attempting HTTP connection to %s:%d...\n", domain.c_str(), port);
-  Serial.printf("Domain length: %d chars\n", domain.length());
-  
-  // Try connecting with hostname (required for Cloudflare)
-  unsigned long connectStart = millis();
-  bool connected = regularClient.connect(domain.c_str(), port);
-  unsigned long connectTime = millis() - connectStart;
-  
-  Serial.printf("Connection attempt took %lu ms\n", connectTime);
-  Serial.printf("Connected: %s\n", connected ? "YES" : "NO");
-  Serial.printf("Client status: %d\n", regularClient.connected());
-  
-  if (connected) {
-    Serial.println("✓ HTTP connection established!");
-    
-    // Send HTTP POST request with proper headers
-    Serial.println("Sending HTTP POST request...");
-    regularClient.print("POST ");
-    regularClient.print(path);
-    regularClient.println(" HTTP/1.1");
-    regularClient.print("Host: ");
-    regularClient.println(domain);
-    regularClient.println("Content-Type: application/json");
-    regularClient.println("User-Agent: ESP32-S3-Gateway/1.0");
-    regularClient.println("Accept: application/json");
-    regularClient.println("Connection: close");
-    regularClient.print("Content-Length: ");
-    regularClient.println(payload.length());
-    regularClient.println(); // Empty line before body
-    regularClient.print(payload);
-    regularClient.println(); // Final newline
-    
-    Serial.println("✓ HTTP POST request sent");
-    Serial.printf("Payload length: %d bytes\n", payload.length());
-    
-    // Wait for response with longer timeout
-    unsigned long timeout = millis() + 20000; // 20 second timeout
-    Serial.println("Waiting for response...");
-    int availableCount = 0;
-    while (!regularClient.available() && millis() < timeout) {
-      delay(100);
-      if (millis() % 2000 < 100) { // Print every 2 seconds
-        Serial.print(".");
-      }
-    }
-    Serial.println();
-    
-    if (regularClient.available()) {
-      Serial.println("✓ Response received!");
-      Serial.printf("Bytes available: %d\n", regularClient.available());
-      
-      String response = "";
-      unsigned long readStart = millis();
-      while (regularClient.available() || (millis() - readStart < 5000)) {
-        if (regularClient.available()) {
-          char c = regularClient.read();
-          response += c;
-          if (response.length() > 2000) break; // Limit response size
-        } else {
-          delay(10);
-        }
-      }
-      
-      Serial.printf("Response length: %d chars\n", response.length());
-      
-      // Extract status code
-      int statusCodePos = response.indexOf("HTTP/1.");
-      if (statusCodePos >= 0) {
-        int codeStart = response.indexOf(" ", statusCodePos) + 1;
-        int codeEnd = response.indexOf(" ", codeStart);
-        if (codeEnd > codeStart) {
-          httpCode = response.substring(codeStart, codeEnd).toInt();
-          Serial.printf("HTTP Status Code: %d\n", httpCode);
-        }
-      }
-      
-      Serial.print("Response (first 500 chars): ");
-      Serial.println(response.substring(0, 500));
-    } else {
-      Serial.println("✗ No response received (timeout)");
-      Serial.printf("Connection still active: %s\n", regularClient.connected() ? "YES" : "NO");
-      httpCode = -1;
-    }
-    
-    regularClient.stop();
-    Serial.println("Connection closed");
-  } else {
-    Serial.printf("✗ HTTP connection failed to %s:%d\n", domain.c_str(), port);
-    Serial.printf("Last error: %d\n", regularClient.getWriteError());
-    Serial.println("Possible causes:");
-    Serial.println("  1. Cloudflare Workers on *.workers.dev only accept HTTPS from embedded devices");
-    Serial.println("  2. Need to use custom domain with HTTP support");
-    Serial.println("  3. Firewall/router blocking outbound port 80");
-    Serial.println("  4. Cloudflare blocking embedded device connections");
-    httpCode = -1;
+
+  unsigned long start = millis();
+  uint32_t connectsBefore = uplinkClient.connects;
+  int httpCode = uplinkClient.post((const char*)body, len, contentType);
+  unsigned long elapsed = millis() - start;
+  gatewayMetrics.postLatency.observe(elapsed);
+  metricInc(gatewayMetrics.posts[uplinkResult(httpCode)]);
+
+  if (uplinkClient.connects != connectsBefore) {
+    LOG_I("Connected to %s:%d (connection attempt took %lu ms)\n",
+          uplinkClient.endpoint().host, uplinkClient.endpoint().port,
+          (unsigned long)uplinkClient.lastConnectMs);
   }
+  LOG_I("POST %s -> %d in %lu ms (%u bytes, %s connection)\n",
+        uplinkClient.endpoint().path, httpCode, elapsed, (unsigned)len,
+        uplinkClient.connects != connectsBefore ? "new" : "reused");
   
   // Handle response
   if (httpCode > 0) {
     if (httpCode >= 200 && httpCode < 300) {
-      Serial.println("✓ SUCCESS: Data sent successfully to web server!");
-      Serial.println("Data should now be visible on the website");
+      LOG_I("✓ SUCCESS: Data sent successfully to web server!\n");
     } else if (httpCode == 308) {
-      Serial.println("WARNING: 308 redirect received - POST data may be lost");
-      Serial.println("This usually means the server redirected HTTP to HTTPS");
+      LOG_W("WARNING: 308 redirect received - POST data may be lost\n");
+      LOG_W("This usually means the server redirected HTTP to HTTPS\n");
     } else {
-      Serial.printf("Unexpected response code: %d\n", httpCode);
+      LOG_W("Unexpected response code: %d\n", httpCode);
     }
   } else {
-    Serial.printf("✗ Connection failed, error code: %d\n", httpCode);
+    LOG_E("✗ Connection failed, error code: %d\n", httpCode);
     
     // More detailed error information
     if (httpCode == -1) {
-      Serial.println("Error -1: Connection refused");
-      Serial.println("Vercel blocks HTTP connections - requires HTTPS");
-      Serial.println("Solutions:");
-      Serial.println("  1. Use a local server: http://YOUR_LOCAL_IP:3000/api/ingest-http-bridge");
-      Serial.println("  2. Use a different cloud service that accepts HTTP");
-      Serial.println("  3. Set up a reverse proxy that accepts HTTP");
-      Serial.println("  4. ESP32-S3 cannot do HTTPS without WiFiClientSecure");
+      LOG_E("Error -1: Connection refused\n");
+      LOG_I("Vercel blocks HTTP connections - requires HTTPS\n");
+      LOG_I("Solutions:\n");
+      LOG_I("  1. Use a local server: http://YOUR_LOCAL_IP:3000/api/ingest-http-bridge\n");
+      LOG_I("  2. Use a different cloud service that accepts HTTP\n");
+      LOG_I("  3. Set up a reverse proxy that accepts HTTP\n");
+      LOG_I("  4. ESP32-S3 cannot do HTTPS without WiFiClientSecure\n");
     } else if (httpCode == -2) {
-      Serial.println("Error -2: Send header failed");
+      LOG_E("Error -2: Send header failed\n");
     } else if (httpCode == -3) {
-      Serial.println("Error -3: Send payload failed");
+      LOG_E("Error -3: Send payload failed\n");
     } else if (httpCode == -4) {
-      Serial.println("Error -4: Not connected");
+      LOG_E("Error -4: Not connected\n");
     } else if (httpCode == -5) {
-      Serial.println("Error -5: Connection lost");
+      LOG_E("Error -5: Connection lost\n");
     } else if (httpCode == -6) {
-      Serial.println("Error -6: No stream");
+      LOG_E("Error -6: No stream\n");
     } else if (httpCode == -7) {
-      Serial.println("Error -7: No HTTP server");
+      LOG_E("Error -7: No HTTP server\n");
     } else if (httpCode == -8) {
-      Serial.println("Error -8: Too less RAM");
+      LOG_E("Error -8: Too less RAM\n");
     } else if (httpCode == -9) {
-      Serial.println("Error -9: Encoding");
+      LOG_E("Error -9: Encoding\n");
     } else if (httpCode == -10) {
-      Serial.println("Error -10: Stream write");
+      LOG_E("Error -10: Stream write\n");
     } else if (httpCode == -11) {
-      Serial.println("Error -11: Read timeout");
+      LOG_E("Error -11: Read timeout\n");
     }
     
-    Serial.println("This may indicate connection issues");
+    LOG_I("This may indicate connection issues\n");
   }
   
-  // Connection cleanup is handled by regularClient.stop() above
-  // Small delay to let cleanup complete
-  delay(50);
+  return httpCode;
 }
+
+// Live batch: readings from all stations, sent when full (count or bytes) or too old.
+// Replay batch: larger, used to drain the backlog after an outage.
+typedef UplinkBatch<UPLINK_BATCH_MAX_COUNT, UPLINK_BATCH_MAX_BYTES> LiveBatch;
+typedef UplinkBatch<UPLINK_REPLAY_MAX_COUNT, UPLINK_REPLAY_MAX_BYTES> ReplayBatch;
+
+// Readings waiting for upload. OnDataRecv pushes, uplinkTask pops.
+SpscRing<uplink_record, UPLINK_QUEUE_LEN> uplinkQueue;
+TaskHandle_t uplinkTaskHandle = NULL;
+
+// Readings that could not be uploaded yet (PSRAM)
+UplinkBacklog uplinkBacklog;
+uint32_t nextReplayMs = 0;  // Rate limit / back-off for backlog replay
+
+// Write-ahead log on flash: every reading the uploader task takes is logged, so what was
+// not uploaded yet survives a reboot (see flash_wal.h)
+LittleFsWalStorage walStorage;
+FlashWal<LittleFsWalStorage> uplinkWal(walStorage);
+bool walReady = false;
+
+// Unix time in seconds, or 0 while the clock is not set (no NTP answer yet)
+uint32_t unixTimeNow() {
+  time_t t = time(NULL);
+  return t > 1600000000 ? (uint32_t)t : 0;
+}
+
+void logToWal(uplink_record& rec) {
+  if (!walReady) return;
+  WalRecord w;
+  memcpy(w.mac, rec.mac, 6);
+  w.rssi = rec.rssi;
+  w.temperature = rec.temperature;
+  w.humidity = rec.humidity;
+  w.co2 = rec.co2;
+  uint32_t now = unixTimeNow();
+  w.unix_s = now ? now - (millis() - rec.rx_ms) / 1000 : 0;
+  rec.seq = uplinkWal.append(w, millis());
+}
+
+// Readings logged before the last reboot get a receive time on the current millis() clock
+// from their unix time (or "now" if either clock is unknown)
+uplink_record recordFromWal(const WalRecord& w) {
+  uplink_record rec;
+  memcpy(rec.mac, w.mac, 6);
+  rec.rssi = w.rssi;
+  rec.temperature = w.temperature;
+  rec.humidity = w.humidity;
+  rec.co2 = w.co2;
+  rec.seq = w.seq;
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+  rec.count = 0;    // The WAL only has the means
+#endif
+  rec.rx_ms = millis();
+  uint32_t now = unixTimeNow();
+  if (now && w.unix_s && w.unix_s <= now) {
+    uint32_t ageMs = (now - w.unix_s) * 1000;
+    rec.rx_ms -= ageMs;
+  }
+  return rec;
+}
+
+// Mount the log and put everything after the upload cursor into the backlog
+void recoverWal() {
+  if (!walStorage.begin()) {
+    LOG_W("WARNING: Could not mount WAL partition, readings are lost on reboot\n");
+    return;
+  }
+  walReady = uplinkWal.begin();
+  uint32_t recovered = uplinkWal.replay(uplinkWal.cursor(), [](const WalRecord& w) {
+    uplinkBacklog.push(recordFromWal(w));
+  });
+  LOG_I("WAL: %u segments, %u / %u KB used, cursor %u, %u readings recovered",
+        uplinkWal.segments(), (unsigned)(walStorage.usedBytes() / 1024),
+        (unsigned)(walStorage.totalBytes() / 1024), uplinkWal.cursor(), recovered);
+  LOG_I(" (%u corrupt pages skipped)\n", uplinkWal.corruptPages);
+}
+
+// Compressed per-station history. Written by the uploader task; queryHistory() may be called
+// from other tasks (local dashboard, backfill), so access goes through a mutex.
+StationHistory<NUM_STATIONS, HISTORY_BLOCK_BYTES> stationHistory;
+SemaphoreHandle_t historyMutex = NULL;
+
+bool startHistory() {
+  size_t bytes = HISTORY_POOL_BYTES;
+  uint8_t* pool = psramFound() ? (uint8_t*)ps_malloc(bytes) : NULL;
+  if (!pool) {
+    LOG_W("WARNING: No PSRAM for station history, local history disabled\n");
+    return false;
+  }
+  historyMutex = xSemaphoreCreateMutex();
+  stationHistory.begin(pool, bytes, (uint32_t)HISTORY_RETENTION_HOURS * 3600);
+  LOG_I("Station history: %u KB in PSRAM, %u hours retention\n",
+        (unsigned)(bytes / 1024), (unsigned)HISTORY_RETENTION_HOURS);
+  return true;
+}
+
+// Reading time in seconds for history and aggregation: unix seconds once NTP has answered,
+// seconds since boot before that
+uint32_t readingTime(uint32_t rxMs) {
+  uint32_t now = unixTimeNow();
+  return now ? now - (millis() - rxMs) / 1000 : rxMs / 1000;
+}
+
+void recordHistory(const uplink_record& rec) {
+  if (!historyMutex) return;
+  HistorySample s;
+  s.t = readingTime(rec.rx_ms);
+  s.temperature = rec.temperature;
+  s.humidity = rec.humidity;
+  s.co2 = rec.co2;
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+  stationHistory.append(rec.mac, s);
+  xSemaphoreGive(historyMutex);
+}
+
+// Readings of one station with t0 <= t <= t1 (seconds, see readingTime), oldest first.
+// fn(const HistorySample&) runs with the history locked, so it should only copy or print.
+template <typename F>
+uint32_t queryHistory(const uint8_t mac[6], uint32_t t0, uint32_t t1, F fn) {
+  if (!historyMutex) return 0;
+  xSemaphoreTake(historyMutex, portMAX_DELAY);
+  uint32_t n = stationHistory.query(mac, t0, t1, fn);
+  xSemaphoreGive(historyMutex);
+  return n;
+}
+
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+// Per-station window accumulators, used by the uploader task only
+ReadingAggregator<NUM_STATIONS> aggregator(AGG_WINDOW_S);
+
+// Upload record for a closed window, received "at" the window end
+uplink_record recordFromSummary(const AggregateSummary& s) {
+  uplink_record rec;
+  memcpy(rec.mac, s.mac, 6);
+  rec.rssi = s.rssi;
+  rec.temperature = s.temperature.mean;
+  rec.humidity = s.humidity.mean;
+  rec.co2 = s.co2Count ? (uint16_t)lroundf(s.co2.mean) : CO2_NONE;
+  rec.seq = 0;
+  rec.count = s.count;
+  rec.window_s = s.length;
+  rec.temperature_min = s.temperature.min;
+  rec.temperature_max = s.temperature.max;
+  rec.temperature_last = s.temperature.last;
+  rec.humidity_min = s.humidity.min;
+  rec.humidity_max = s.humidity.max;
+  rec.humidity_last = s.humidity.last;
+  rec.co2_min = s.co2Count ? (uint16_t)s.co2.min : CO2_NONE;
+  rec.co2_max = s.co2Count ? (uint16_t)s.co2.max : CO2_NONE;
+  rec.co2_last = s.co2Count ? (uint16_t)s.co2.last : CO2_NONE;
+  // A window opened before NTP answered is on the uptime clock; call it "just ended"
+  uint32_t now = readingTime(millis());
+  uint32_t end = s.start + s.length;
+  bool clockJumped = end < 1600000000 && now >= 1600000000;
+  uint32_t ageS = (now > end && !clockJumped) ? now - end : 0;
+  rec.rx_ms = millis() - ageS * 1000;
+  return rec;
+}
+#endif
+
+// Oldest reading not yet confirmed by the server: backlog first, then the live batch
+template <typename Batch>
+uint32_t oldestUnsentSeq(const Batch& batch) {
+  if (uplinkBacklog.size()) return uplinkBacklog.at(0).seq;
+  if (batch.count()) return batch.record(0).seq;
+  return uplinkWal.nextSeq();
+}
+
+// Called with every reading of every upload attempt and the result (HTTP status or UPLINK_ERR_*).
+// Not set on the boards; the native bench (src/native_bench/) times receive -> server ack with it.
+void (*uplinkResultHook)(const uplink_record& rec, int httpCode) = NULL;
+
+// Send a finished batch. Returns UPLINK_RESULT_OK if the server has it (2xx),
+// UPLINK_RESULT_REJECTED if it refused it for good (4xx, resending would not help), and
+// UPLINK_RESULT_FAILED if it should be retried later.
+template <typename Batch>
+UplinkResult uploadBatch(Batch& batch, const char* kind) {
+  uint32_t now = millis();
+  uint32_t age = now - batch.record(0).rx_ms;
+  size_t len = batch.finish(now);
+  LOG_I("Sending %s batch: %u readings, %u bytes (oldest %lu ms)\n",
+        kind, batch.count(), (unsigned)len, (unsigned long)age);
+  int httpCode = sendToServer(batch.data(), len, UPLINK_CONTENT_TYPE);
+  metricInc(gatewayMetrics.uploaded[uplinkResult(httpCode)], batch.count());
+  if (uplinkResultHook) {
+    for (uint16_t i = 0; i < batch.count(); ++i) uplinkResultHook(batch.record(i), httpCode);
+  }
+  UplinkResult result = uplinkResult(httpCode);
+  if (result == UPLINK_RESULT_REJECTED) {
+    LOG_E("✗ Server rejected %u readings (HTTP %d), dropping them\n", batch.count(), httpCode);
+  }
+  return result;
+}
+
+void flushLiveBatch(LiveBatch& batch) {
+  if (batch.count() == 0) return;
+  if (uploadBatch(batch, "live") == UPLINK_RESULT_FAILED) {
+    // Keep the readings: park them in the backlog and hold off replay for a while
+    for (uint16_t i = 0; i < batch.count(); ++i) {
+      uplinkBacklog.push(batch.record(i));
+    }
+    nextReplayMs = millis() + UPLINK_REPLAY_RETRY_MS;
+    LOG_W("Upload failed, %u readings moved to backlog (%u / %u)\n",
+          batch.count(), uplinkBacklog.size(), uplinkBacklog.capacity());
+  }
+  batch.clear();
+}
+
+void addToLiveBatch(LiveBatch& batch, const uplink_record& rec) {
+  if (!batch.add(rec, millis())) {
+    // Batch is full by size: send it and start a new one with this reading
+    flushLiveBatch(batch);
+    batch.add(rec, millis());
+  }
+  if (batch.full()) {
+    flushLiveBatch(batch);
+  }
+}
+
+// Upload the oldest backlog readings in one large batch, at most every UPLINK_REPLAY_INTERVAL_MS
+void replayBacklog(ReplayBatch& batch) {
+  if (uplinkBacklog.size() == 0 || WiFi.status() != WL_CONNECTED) return;
+  if ((int32_t)(millis() - nextReplayMs) < 0) return;
+
+  uint32_t now = millis();
+  for (uint32_t i = 0; i < uplinkBacklog.size(); ++i) {
+    if (!batch.add(uplinkBacklog.at(i), now)) break;
+  }
+  UplinkResult result = uploadBatch(batch, "backlog");
+  if (result != UPLINK_RESULT_FAILED) {
+    uplinkBacklog.drop(batch.count(), result == UPLINK_RESULT_REJECTED);
+    nextReplayMs = millis() + UPLINK_REPLAY_INTERVAL_MS;
+  } else {
+    nextReplayMs = millis() + UPLINK_REPLAY_RETRY_MS;
+  }
+  batch.clear();
+}
+
+// Uploader task: drains the queue and does the (slow, blocking) HTTP work
+// outside of the Wi-Fi/ESP-NOW callback context. Live readings go first; the backlog is
+// replayed in between, rate limited, so a long outage does not delay current data.
+void uplinkTask(void* arg) {
+  (void)arg;
+  uplink_record rec;
+  static LiveBatch batch;      // Static: keeps the body buffers off the task stack
+  static ReplayBatch replay;
+  for (;;) {
+    // Sleep until OnDataRecv signals new data; wake more often while there is pending work
+    bool pending = batch.count() > 0 || uplinkBacklog.size() > 0;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(pending ? 100 : 1000));
+    while (uplinkQueue.pop(rec)) {
+      recordHistory(rec);
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+      // Raw readings only go to the history; the summary of a window is uploaded once the
+      // station's first reading of the next window arrives
+      AggregateSummary closed;
+      if (aggregator.add(rec.mac, readingTime(rec.rx_ms), rec.temperature, rec.humidity, rec.co2,
+                         rec.rssi, closed)) {
+        uplink_record summary = recordFromSummary(closed);
+        logToWal(summary);
+        addToLiveBatch(batch, summary);
+      }
+#else
+      logToWal(rec);
+      addToLiveBatch(batch, rec);
+#endif
+    }
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+    // Stations that went quiet: close their window once it is AGG_GRACE_S past its end
+    aggregator.flushEnded(readingTime(millis()), AGG_GRACE_S, [](const AggregateSummary& s) {   // batch is static: no capture
+      uplink_record summary = recordFromSummary(s);
+      logToWal(summary);
+      addToLiveBatch(batch, summary);
+    });
+#endif
+    if (batch.ageMs(millis()) >= UPLINK_BATCH_MAX_AGE_MS) {
+      flushLiveBatch(batch);
+    }
+    replayBacklog(replay);
+    if (walReady) {
+      uplinkWal.setCursor(oldestUnsentSeq(batch));
+      uplinkWal.tick(millis());
+    }
+  }
+}
+
+void startUplinkTask() {
+  if (uplinkTaskHandle) return;
+  if (uplinkBacklog.begin(UPLINK_BACKLOG_LEN)) {
+    LOG_I("Uplink backlog: %u readings (%u KB) in %s\n", uplinkBacklog.capacity(),
+          (unsigned)(uplinkBacklog.capacity() * sizeof(uplink_record) / 1024),
+          uplinkBacklog.usesPsram() ? "PSRAM" : "internal RAM");
+  } else {
+    LOG_W("WARNING: No memory for uplink backlog, readings are lost during outages\n");
+  }
+  recoverWal();
+  startHistory();
+  xTaskCreatePinnedToCore(uplinkTask, "uplink", UPLINK_TASK_STACK, NULL,
+                          UPLINK_TASK_PRIORITY, &uplinkTaskHandle, UPLINK_TASK_CORE);
+  LOG_I("Uplink task started (queue: %u readings)\n", uplinkQueue.capacity());
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+  LOG_I("Uplink mode: aggregate, one summary per station every %u s\n", (unsigned)AGG_WINDOW_S);
+#endif
+}
+
+// Hand a reading to the uploader task. Called from the ESP-NOW callback, so it
+// only copies a fixed-size record and never blocks. ageMs: how long ago the station took it
+// (readings buffered on the station and sent in a multi-reading frame).
+void queueForUpload(const Station* st, uint32_t ageMs = 0) {
+  uplink_record rec;
+  memcpy(rec.mac, st->mac, 6);
+  rec.rssi = st->rssi;
+  rec.temperature = st->readings.temperature;
+  rec.humidity = st->readings.humidity;
+  rec.co2 = st->readings.co2;
+  rec.rx_ms = millis() - ageMs;
+  rec.seq = 0;
+  if (uplinkQueue.push(rec)) {
+    if (uplinkTaskHandle) xTaskNotifyGive(uplinkTaskHandle);
+  } else {
+    LOG_E("✗ Uplink queue full, reading dropped (drops: %u)\n", uplinkQueue.dropCount());
+  }
+}
+
+void printUplinkQueueStats() {
+  LOG_I("Uplink queue: depth %u / %u, high-water %u, drops %u\n",
+        uplinkQueue.depth(), uplinkQueue.capacity(),
+        uplinkQueue.highWaterMark(), uplinkQueue.dropCount());
+
+  // Replay throughput since the previous call
+  static uint32_t lastReplayed = 0;
+  static uint32_t lastMs = 0;
+  uint32_t now = millis();
+  uint32_t replayed = uplinkBacklog.replayed;
+  float rate = (now != lastMs) ? (replayed - lastReplayed) * 1000.0f / (now - lastMs) : 0.0f;
+  lastReplayed = replayed;
+  lastMs = now;
+  uint32_t cap = uplinkBacklog.capacity();
+  LOG_I("Uplink backlog: %u / %u readings (%.1f%%), replayed %u (%.1f/s), rejected %u, overwritten %u\n",
+        uplinkBacklog.size(), cap, cap ? uplinkBacklog.size() * 100.0f / cap : 0.0f,
+        replayed, rate, uplinkBacklog.rejected, uplinkBacklog.overwritten);
+  if (walReady) {
+    LOG_I("WAL: %u segments, %u readings pending, %u pages written, %u cursor writes, %u lost\n",
+          uplinkWal.segments(), uplinkWal.pending(), uplinkWal.pagesWritten,
+          uplinkWal.cursorWrites, uplinkWal.lostRecords);
+  }
+  if (historyMutex) {
+    uint32_t samples = stationHistory.samples;
+    LOG_I("History: %u stations, %u / %u KB, %u readings (%.1f bytes each), %u blocks evicted, %u late readings dropped\n",
+          stationHistory.stations(), (unsigned)(stationHistory.bytesUsed() / 1024),
+          (unsigned)(stationHistory.blocks() * HISTORY_BLOCK_BYTES / 1024), samples,
+          samples ? (float)stationHistory.bytesUsed() / samples : 0.0f, stationHistory.evicted,
+          stationHistory.late);
+  }
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+  LOG_I("Aggregation: %u windows of %u s closed\n", aggregator.windows, aggregator.windowLength());
+#endif
+}
+#endif
+
+#ifdef ROLE_GATEWAY
+// Acknowledge a frame that was sent to the broadcast address: the station is looking for a
+// gateway and learns our MAC from this. Sent to the broadcast address as well, so no peer
+// per station is needed. Duplicates are acknowledged too (the station did not get the last ACK).
+void sendAck(const uint8_t* station, uint16_t boot, uint32_t seq) {
+  ack_msg ack;
+  memcpy(ack.station, station, 6);
+  ack.boot = boot;
+  ack.seq = seq;
+  uint8_t frame[sizeof(WireAck)];
+  esp_now_send(broadcastAddr, frame, wireEncode(ack, frame, sizeof(frame)));
+}
+
+// Announce our channel to stations that are scanning for us. Call from loop(); sends at most
+// every GATEWAY_BEACON_INTERVAL_MS.
+void sendBeacon() {
+  static uint32_t lastBeaconMs = 0;
+  if (millis() - lastBeaconMs < GATEWAY_BEACON_INTERVAL_MS) return;
+  lastBeaconMs = millis();
+  uint8_t primary = 0;
+  wifi_second_chan_t second;
+  if (esp_wifi_get_channel(&primary, &second) != ESP_OK || primary == 0) return;
+  beacon_msg beacon;
+  beacon.channel = primary;
+  beacon.interval_ms = GATEWAY_BEACON_INTERVAL_MS;
+  uint8_t frame[sizeof(WireBeacon)];
+  esp_now_send(broadcastAddr, frame, wireEncode(beacon, frame, sizeof(frame)));
+}
+#endif
+
+#if RSSI_MODE == RSSI_MODE_RECV_INFO && !(defined(ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32S3))
+#error "RSSI_MODE_RECV_INFO needs the esp_now_recv_info_t callback (ESP32-S3), use RSSI_MODE_PROMISCUOUS"
 #endif
 
 // Callback when data is received
@@ -354,50 +706,118 @@ void sendToServer(const Station* st) {
   void OnDataRecv(const esp_now_recv_info_t *recv_info, const uint8_t* data, int len) {
     const uint8_t* mac_addr = recv_info->src_addr;
     int rssi = recv_info->rx_ctrl->rssi;
+    bool broadcastRx = memcmp(recv_info->des_addr, broadcastAddr, 6) == 0;
 #else
   // Old ESP32 signature: (const uint8_t* mac_addr, const uint8_t* data, int len)
   void OnDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len) {
+    bool broadcastRx = true;  // Destination unknown with this signature: always acknowledge
     int rssi = 0; // RSSI not directly available in old framework callback
-    // RSSI will be updated via promiscuous mode callback
+    // RSSI will be updated via promiscuous mode callback (RSSI_MODE_PROMISCUOUS)
 #endif
-  Serial.printf("\n=== ESP-NOW Packet Received ===\n");
-  Serial.printf("Timestamp: %lu ms\n", millis());
-  Serial.printf("From MAC: ");
-  for (int i = 0; i < 6; ++i) {
-    Serial.printf("%02X", mac_addr[i]);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.printf("\nRSSI: %d dBm\n", rssi);
-  Serial.printf("Data length: %d bytes (expected: %d bytes)\n", len, sizeof(sensor_msg));
-  
-  // Print raw data bytes for debugging
-  Serial.print("Raw data (hex): ");
-  for (int i = 0; i < len && i < 20; ++i) { // Print first 20 bytes
-    Serial.printf("%02X ", data[i]);
+#ifdef ROLE_STATION
+  // Stations only expect ACKs and beacons; an ACK for us tells us which gateway to talk to,
+  // a beacon which channel it is on
+  (void)rssi;
+  (void)broadcastRx;
+  ack_msg ack;
+  beacon_msg beacon;
+  if (wireType(data, len) == MSG_TYPE_ACK && wireDecode(data, len, ack)) {
+    if (memcmp(ack.station, own_mac, 6) == 0) {
+      memcpy(gateway_mac, mac_addr, 6);
+      gateway_known = true;
+      ack_received = true;
+    }
+  } else if (wireType(data, len) == MSG_TYPE_BEACON && wireDecode(data, len, beacon) && !beacon_heard) {
+    memcpy(beacon_mac, mac_addr, 6);
+    beacon_channel = beacon.channel;
+    beacon_heard = true;
   }
-  if (len > 20) Serial.print("...");
-  Serial.println();
+#endif
+#ifdef ROLE_GATEWAY
+  metricInc(gatewayMetrics.frames);
+  // Per-packet detail is LOG_D: compiled out at the default LOG_LEVEL_INFO
+  LOG_D("\n=== ESP-NOW Packet Received ===\n");
+  LOG_D("Timestamp: %lu ms\n", millis());
+  LOG_D("From MAC: " MAC_FMT "\n", MAC_ARGS(mac_addr));
+  LOG_D("RSSI: %d dBm\n", rssi);
+  LOG_D("Data length: %d bytes (type 0x%02X, version %d)\n", len, wireType(data, len), len >= 2 ? data[1] : 0);
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  // Print raw data bytes for debugging (first 20)
+  char hex[3 * 20 + 4];
+  size_t hexLen = 0;
+  for (int i = 0; i < len && i < 20; ++i) {
+    hexLen += snprintf(hex + hexLen, sizeof(hex) - hexLen, "%02X ", data[i]);
+  }
+  snprintf(hex + hexLen, sizeof(hex) - hexLen, "%s", len > 20 ? "..." : "");
+  LOG_D("Raw data (hex): %s\n", hex);
+#endif
   
+  // Decode before registering: only frames from stations (sensor, multi, diag, legacy) get a
+  // registry slot. ACKs and beacons of other gateways on the channel are not station traffic.
+  static multi_msg multi;   // Static: keeps ~350 bytes off the Wi-Fi task stack
+  static diag_msg diag;
+  sensor_msg msg;
+  bool numbered = false;
+  uint8_t type = wireType(data, len);
+  bool isDiag = type == MSG_TYPE_DIAG && wireDecode(data, len, diag);
+  bool isMulti = type == MSG_TYPE_MULTI && wireDecode(data, len, multi);
+  bool isSensor = !isDiag && !isMulti && decodeSensorFrame(data, len, msg, numbered);
+  if (!isDiag && !isMulti && !isSensor) {
+    ack_msg ack;
+    beacon_msg beacon;
+    if ((type == MSG_TYPE_ACK && wireDecode(data, len, ack)) ||
+        (type == MSG_TYPE_BEACON && wireDecode(data, len, beacon))) {
+      LOG_D("Gateway frame (type 0x%02X) from " MAC_FMT " ignored\n", type, MAC_ARGS(mac_addr));
+      return;
+    }
+    metricInc(gatewayMetrics.invalidFrames);
+    LOG_E("✗ ERROR: Unknown frame (type 0x%02X, %d bytes; sensor frames are %d bytes, type 0x%02X, version >= %d)\n",
+          type, len, (int)sizeof(WireSensor), MSG_TYPE_SENSOR, WireCodec<sensor_msg>::VERSION);
+    LOG_E("This might indicate a data format mismatch between station and gateway\n");
+    LOG_D("=== Packet Processing Failed ===\n\n");
+    return;
+  }
+
   Station* st = getOrCreateStation(mac_addr);
-  if (st && len == sizeof(sensor_msg)) {
-    Serial.println("✓ Valid sensor message - processing...");
-    st->handleMessage(data, len);
-#ifdef ROLE_GATEWAY
-    Serial.println("Forwarding to web server...");
-    sendToServer(st);
-    Serial.printf("Total stations registered: %d\n", stationCount);
+  if (!st) {
+    metricInc(gatewayMetrics.registryFull);
+    LOG_E("✗ ERROR: Cannot create station (max stations: %d, current: %d)\n", NUM_STATIONS, stations.size());
+    LOG_D("=== Packet Processing Failed ===\n\n");
+    return;
+  }
+  st->lastSeenMs = millis();
+#if RSSI_MODE == RSSI_MODE_RECV_INFO
+  st->updateRSSI(rssi);
 #endif
-    Serial.println("=== Packet Processing Complete ===\n");
-  } else {
-    if (!st) {
-      Serial.printf("✗ ERROR: Cannot create station (max stations: %d, current: %d)\n", NUM_STATIONS, stationCount);
-      printRegisteredStations();
-    } else {
-      Serial.printf("✗ ERROR: Invalid message length (got %d, expected %d)\n", len, sizeof(sensor_msg));
-      Serial.println("This might indicate a data format mismatch between station and gateway");
+  if (isDiag) {
+    printDiag(mac_addr, diag);
+    LOG_D("=== Packet Processing Complete ===\n\n");
+    return;
+  }
+  if (isMulti) {
+    LOG_D("✓ Multi-reading frame: %u readings (seq %u..%u) - processing...\n",
+          multi.count, multi.seq, multi.seq + multi.count - 1);
+    if (broadcastRx && multi.count) sendAck(mac_addr, multi.boot, multi.seq + multi.count - 1);
+    for (uint8_t i = 0; i < multi.count; ++i) {
+      if (st->handleMessage(multiReadingAt(multi, i), true)) {
+        metricInc(gatewayMetrics.readings);
+        queueForUpload(st, multi.readings[i].age_s * 1000UL);
+      }
     }
-    Serial.println("=== Packet Processing Failed ===\n");
+    LOG_D("Total stations registered: %d\n", stations.size());
+    LOG_D("=== Packet Processing Complete ===\n\n");
+    return;
   }
+  LOG_D("✓ Valid sensor message%s - processing...\n", numbered ? "" : " (legacy layout)");
+  if (broadcastRx && numbered) sendAck(mac_addr, msg.boot, msg.seq);
+  if (st->handleMessage(msg, numbered)) {
+    LOG_D("Queueing for upload...\n");
+    metricInc(gatewayMetrics.readings);
+    queueForUpload(st);
+    LOG_D("Total stations registered: %d\n", stations.size());
+  }
+  LOG_D("=== Packet Processing Complete ===\n\n");
+#endif
 }
 
 void addBroadcastPeer() {
@@ -410,39 +830,180 @@ void addBroadcastPeer() {
   }
 }
 
+#ifdef ROLE_STATION
+void setRadioChannel(uint8_t channel) {
+  // Arduino-ESP32 1.x only changes the channel of a disconnected STA in promiscuous mode
+  esp_wifi_set_promiscuous(true);
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+  esp_wifi_set_promiscuous(false);
+}
+
+// Listen on each channel for a gateway beacon. Takes up to
+// ESPNOW_SCAN_CHANNELS * ESPNOW_SCAN_DWELL_MS (~2 s), so it only runs on a cold boot and after
+// ESPNOW_RESCAN_AFTER undelivered frames (the gateway's AP may have changed channel).
+bool scanForGateway() {
+  LOG_I("  Scanning channels 1-%u for a gateway beacon...\n", ESPNOW_SCAN_CHANNELS);
+  unsigned long scanStart = millis();
+  beacon_heard = false;
+  for (uint8_t ch = 1; ch <= ESPNOW_SCAN_CHANNELS && !beacon_heard; ++ch) {
+    setRadioChannel(ch);
+    unsigned long start = millis();
+    while (!beacon_heard && millis() - start < ESPNOW_SCAN_DWELL_MS) {
+      delay(1);
+    }
+  }
+  if (!beacon_heard) {
+    LOG_W("  ✗ No gateway beacon found (%lu ms)\n", millis() - scanStart);
+    return false;
+  }
+  // The beacon may have leaked over from an adjacent channel: trust its channel field
+  gateway_channel = beacon_channel;
+  memcpy(gateway_mac, beacon_mac, 6);
+  gateway_known = true;
+  failed_sends = 0;
+  setRadioChannel(gateway_channel);
+  LOG_I("  ✓ Gateway " MAC_FMT " on channel %u (scan took %lu ms)\n",
+        MAC_ARGS(gateway_mac), gateway_channel, millis() - scanStart);
+  return true;
+}
+
+// Put the radio on the gateway's channel: the cached one after a timer wake, else scan
+bool tuneToGateway() {
+  if (gateway_channel) {
+    setRadioChannel(gateway_channel);
+    return true;
+  }
+  return scanForGateway();
+}
+
+// Send a frame to the gateway and return true once it has it.
+// With a known gateway the frame goes unicast to its MAC: the MAC layer acknowledges it, so
+// OnDataSent reports real delivery within a few ms. Without one the frame is broadcast and
+// we wait for the gateway's ACK, which also tells us its MAC (cached in RTC memory).
+// Failed attempts are retried after an exponential backoff with jitter, so stations that
+// collided do not retry in lockstep. After ESPNOW_PEER_LOST_AFTER undelivered frames in a
+// row the gateway is forgotten and discovery starts over, after ESPNOW_RESCAN_AFTER its
+// channel as well. Returns false without sending if no gateway channel is known or found.
+bool sendToGateway(const uint8_t* frame, size_t len) {
+  WiFi.macAddress(own_mac);
+  uint32_t t0 = micros();
+  bool tuned = tuneToGateway();
+  last_tune_us = micros() - t0;
+  last_send_us = 0;
+  last_ack_wait_us = 0;
+  if (!tuned) return false;
+  bool unicast = gateway_known;
+  if (unicast && !esp_now_is_peer_exist(gateway_mac)) {
+    esp_now_peer_info_t peerInfo = {};
+    memcpy(peerInfo.peer_addr, gateway_mac, 6);
+    peerInfo.channel = 0;
+    peerInfo.encrypt = false;
+    esp_now_add_peer(&peerInfo);
+  }
+
+  t0 = micros();
+  for (uint8_t attempt = 0; attempt < ESPNOW_SEND_ATTEMPTS; ++attempt) {
+    if (attempt) {
+      uint32_t backoff = (uint32_t)ESPNOW_RETRY_BASE_MS << (attempt - 1);
+      if (backoff > ESPNOW_RETRY_MAX_MS) backoff = ESPNOW_RETRY_MAX_MS;
+      delay(backoff + esp_random() % ESPNOW_RETRY_BASE_MS);
+    }
+    send_done = false;
+    ack_received = false;
+    if (esp_now_send(unicast ? gateway_mac : broadcastAddr, frame, len) != ESP_OK) continue;
+
+    unsigned long start = millis();
+    while (!send_done && millis() - start < ESPNOW_SEND_TIMEOUT_MS) {
+      delay(1);
+    }
+    if (!unicast) {
+      uint32_t ackStart = micros();
+      while (!ack_received && millis() - start < ESPNOW_ACK_TIMEOUT_MS) {
+        delay(1);
+      }
+      last_ack_wait_us += micros() - ackStart;
+    }
+    if (unicast ? (send_done && send_ok) : ack_received) {
+      last_send_us = micros() - t0 - last_ack_wait_us;
+      LOG_I("  ✓ Delivered to gateway " MAC_FMT " (%s, attempt %u, %lu ms)\n",
+            MAC_ARGS(gateway_mac), unicast ? "unicast" : "discovered by broadcast", attempt + 1,
+            millis() - start);
+      failed_sends = 0;
+      return true;
+    }
+  }
+
+  last_send_us = micros() - t0 - last_ack_wait_us;
+  LOG_W("  ✗ Not delivered after %u attempts (%s)\n", ESPNOW_SEND_ATTEMPTS,
+        unicast ? "no MAC-layer ACK" : "no gateway ACK");
+  if (++failed_sends >= ESPNOW_PEER_LOST_AFTER && gateway_known) {
+    LOG_I("  Gateway lost, falling back to broadcast discovery\n");
+    gateway_known = false;
+    esp_now_del_peer(gateway_mac);
+  }
+  if (failed_sends >= ESPNOW_RESCAN_AFTER && gateway_channel) {
+    LOG_I("  Nothing delivered on channel %u, scanning again on the next send\n", gateway_channel);
+    gateway_channel = 0;
+  }
+  return false;
+}
+
+// Power-on counter for sensor_msg.boot, kept in NVS. Call once per power-on, when the
+// sequence counter in RTC memory starts over, so the gateway can tell a restart from loss.
+uint16_t nextBootCount() {
+  Preferences prefs;
+  prefs.begin("espnow", false);
+  uint16_t boot = prefs.getUShort("boot", 0) + 1;
+  prefs.putUShort("boot", boot);
+  prefs.end();
+  return boot;
+}
+#endif
+
 void ESPNOWSetup(){
 #ifdef ROLE_GATEWAY
     // For gateway: WiFi is already connected in STA mode for web server access
     // ESP-NOW works alongside WiFi STA mode
-    Serial.println("ESP-NOW: Gateway mode - WiFi STA already active");
+    LOG_I("ESP-NOW: Gateway mode - WiFi STA already active\n");
 #else
     // For stations, we only use Wi-Fi as a transport for ESP-NOW
     WiFi.mode(WIFI_STA);
     WiFi.disconnect();
-    Serial.println("ESP-NOW: Station mode - WiFi STA for ESP-NOW transport only");
+    LOG_I("ESP-NOW: Station mode - WiFi STA for ESP-NOW transport only\n");
 #endif
     
     // Init ESP-NOW
-    Serial.println("Initializing ESP-NOW...");
+    LOG_I("Initializing ESP-NOW...\n");
     if (esp_now_init() != ESP_OK) {
-        Serial.println("ERROR: ESP-NOW Init Failed. Rebooting...");
+        LOG_E("ERROR: ESP-NOW Init Failed. Rebooting...\n");
         delay(2000);
         ESP.restart();
     }
-    Serial.println("ESP-NOW initialized successfully");
+    LOG_I("ESP-NOW initialized successfully\n");
 
     // Register callbacks
     esp_now_register_send_cb(OnDataSent);
     esp_now_register_recv_cb(OnDataRecv);
-    Serial.println("ESP-NOW callbacks registered");
+    LOG_I("ESP-NOW callbacks registered\n");
     
-    // Enable promiscuous mode for RSSI tracking
-    esp_wifi_set_promiscuous(true);
+#if RSSI_MODE == RSSI_MODE_PROMISCUOUS
+    // Enable promiscuous mode for RSSI tracking; the filter keeps data and control
+    // frames from ever reaching the callback
+    wifi_promiscuous_filter_t filter = {};
+    filter.filter_mask = WIFI_PROMIS_FILTER_MASK_MGMT;
+    esp_wifi_set_promiscuous_filter(&filter);
     esp_wifi_set_promiscuous_rx_cb(&promiscuous_rx_cb);
-    Serial.println("Promiscuous mode enabled for RSSI tracking");
+    esp_wifi_set_promiscuous(true);
+    LOG_I("Promiscuous mode enabled for RSSI tracking (management frames only)\n");
+#elif RSSI_MODE == RSSI_MODE_RECV_INFO
+    LOG_I("RSSI taken from ESP-NOW receive info (promiscuous mode off)\n");
+#else
+    LOG_I("RSSI tracking off (promiscuous mode off)\n");
+#endif
     
 #ifdef ROLE_GATEWAY
-    Serial.println("Gateway ready to receive ESP-NOW packets from stations");
-    Serial.println("Received data will be automatically forwarded to web server");
+    addBroadcastPeer();   // ACKs to stations that are still looking for a gateway
+    LOG_I("Gateway ready to receive ESP-NOW packets from stations\n");
+    LOG_I("Received data will be automatically forwarded to web server\n");
 #endif
 }
\ No newline at end of file
@@ -0,0 +1,465 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "uplink_binary.h"  // uplinkToCenti / uplinkToCentiU
+
+// ESP-NOW wire protocol between stations and the gateway.
+// Plain C++ with no Arduino dependencies, so host tools can build and parse frames too.
+//
+// Every frame starts with a 2-byte header: message type, then the layout version of that type.
+// Frames are packed structs in little-endian byte order (the ESP32's own), with fixed-point
+// fields instead of floats; the layouts are pinned with static_asserts below, so a compiler or
+// struct change fails the build instead of silently breaking every node in the field.
+//
+// Versioning: a newer version of a type only appends fields. A decoder accepts any version and
+// reads the prefix it understands; fields an older (shorter) frame lacks read as 0. So the gateway
+// can be updated before or after the stations, and stations can be reflashed one at a time.
+//
+// Adding a message type: a packed Wire* struct starting with WireHeader, a MSG_TYPE_* id and a
+// WireCodec<> specialization mapping it to the in-memory struct. wireEncode / wireDecode do the rest.
+// Variable-length types put a count of fixed-size entries after the Wire struct (see multi_msg).
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "espnow_proto.h assumes a little-endian target"
+#endif
+
+// Message types
+#define MSG_TYPE_SENSOR 0x01   // One reading (sensor_msg)
+#define MSG_TYPE_MULTI  0x02   // Several readings in one frame (multi_msg)
+#define MSG_TYPE_CONFIG 0x03   // Reserved: gateway -> station configuration
+#define MSG_TYPE_ACK    0x04   // Gateway -> station acknowledgement (ack_msg)
+#define MSG_TYPE_BEACON 0x05   // Gateway -> all: channel announcement for scanning stations (beacon_msg)
+#define MSG_TYPE_DIAG   0x06   // Station -> gateway: awake-time profile per phase (diag_msg)
+
+#define ESPNOW_MAX_FRAME 250   // ESP_NOW_MAX_DATA_LEN
+
+// Length of the raw sensor struct sent by stations that predate this protocol
+// ({float temperature; uint16_t co2; float humidity;}, padded to 12 bytes). The gateway still
+// accepts it, without duplicate suppression or loss accounting; no typed frame may have this length.
+#define SENSOR_MSG_V0_LEN 12
+
+// Reading flags on air (WireSensor / WireMultiEntry version 2)
+#define READING_FLAG_NO_CO2 0x01   // T/RH-only measurement: no CO2 value, co2 is 0 (CO2_NONE in memory)
+
+// Message structure for sensor values (in memory; on air it is WireSensor)
+typedef struct sensor_msg {
+  float temperature;
+  uint16_t co2;       // ppm, CO2_NONE if not measured this time
+  float humidity;
+  uint16_t boot;      // Station boot counter (NVS), bumped on every power-on
+  uint32_t seq;       // Message counter (RTC memory), restarts from 0 when boot changes
+  uint32_t uptime_s;  // Station clock: seconds since power-on (RTC timer, runs through deep sleep)
+} sensor_msg;
+
+// Several readings of one station, buffered on the station and sent in one frame. Readings are
+// numbered consecutively from `seq`; each has its age relative to the frame's uptime_s.
+#define MULTI_MAX_READINGS 26   // (ESPNOW_MAX_FRAME - 14-byte header) / 9-byte entries
+
+typedef struct multi_reading {
+  float temperature;
+  uint16_t co2;       // ppm, CO2_NONE if not measured
+  float humidity;
+  uint16_t age_s;     // Seconds between the reading and uptime_s (clamped to 65535)
+} multi_reading;
+
+typedef struct multi_msg {
+  uint16_t boot;
+  uint32_t seq;       // Sequence number of readings[0]
+  uint32_t uptime_s;  // Station clock when the frame was built
+  uint8_t count;
+  multi_reading readings[MULTI_MAX_READINGS];
+} multi_msg;
+
+// Gateway -> station: "got your frame up to seq". Sent to the broadcast address (the gateway
+// keeps no peer per station), so it names the station it is meant for.
+typedef struct ack_msg {
+  uint8_t station[6];
+  uint16_t boot;
+  uint32_t seq;       // Last sequence number of the acknowledged frame
+} ack_msg;
+
+// Gateway -> all, every GATEWAY_BEACON_INTERVAL_MS: the channel the gateway listens on (its
+// AP's channel). Carried in the frame because a scanning station may hear it on an adjacent channel.
+typedef struct beacon_msg {
+  uint8_t channel;
+  uint16_t interval_ms;  // Beacon period
+} beacon_msg;
+
+// Station -> gateway, every DIAG_INTERVAL_S: how long each phase of a wake took since the last
+// diagnostics frame (see phase_profiler.h). Histogram bucket b counts phases that took
+// [DIAG_BUCKET0_US << (b-1), DIAG_BUCKET0_US << b) us; bucket 0 everything shorter, the last
+// bucket everything longer.
+#define DIAG_MAX_PHASES 8
+#define DIAG_BUCKETS 16
+#define DIAG_BUCKET0_US 128
+
+typedef struct diag_phase {
+  uint8_t phase;        // PHASE_* id
+  uint16_t count;       // Times the phase ran
+  uint32_t mean_us;
+  uint32_t max_us;
+  uint8_t hist[DIAG_BUCKETS];   // Saturates at 255
+} diag_phase;
+
+typedef struct diag_msg {
+  uint16_t boot;
+  uint32_t uptime_s;    // Station clock when the frame was built
+  uint32_t window_s;    // Time covered by this profile
+  uint16_t wakes;
+  uint32_t awake_ms;    // Total awake time in the window (all phases and everything in between)
+  uint8_t count;
+  diag_phase phases[DIAG_MAX_PHASES];
+} diag_msg;
+
+struct __attribute__((packed)) WireHeader {
+  uint8_t type;
+  uint8_t version;
+};
+
+// MSG_TYPE_SENSOR, version 2: 19 bytes (version 1: 18, without flags)
+#define WIRE_SENSOR_V1_LEN 18
+
+struct __attribute__((packed)) WireSensor {
+  WireHeader hdr;
+  uint16_t boot;
+  uint32_t seq;
+  uint32_t uptime_s;
+  int16_t temperature;   // 0.01 degC
+  uint16_t humidity;     // 0.01 %RH
+  uint16_t co2;          // ppm
+  uint8_t flags;         // READING_FLAG_* (version 2)
+};
+
+// MSG_TYPE_MULTI, version 2: 14 bytes, then `count` entries of `entry_len` bytes (WireMultiEntry;
+// newer versions may append fields to the entries, older decoders skip them). Version 1 entries
+// are 8 bytes, without flags.
+#define WIRE_MULTI_ENTRY_V1_LEN 8
+
+struct __attribute__((packed)) WireMulti {
+  WireHeader hdr;
+  uint16_t boot;
+  uint32_t seq;
+  uint32_t uptime_s;
+  uint8_t count;
+  uint8_t entry_len;
+};
+
+struct __attribute__((packed)) WireMultiEntry {
+  uint16_t age_s;
+  int16_t temperature;   // 0.01 degC
+  uint16_t humidity;     // 0.01 %RH
+  uint16_t co2;          // ppm
+  uint8_t flags;         // READING_FLAG_* (version 2)
+};
+
+// MSG_TYPE_ACK, version 1: 14 bytes
+struct __attribute__((packed)) WireAck {
+  WireHeader hdr;
+  uint8_t station[6];
+  uint16_t boot;
+  uint32_t seq;
+};
+
+// MSG_TYPE_BEACON, version 1: 5 bytes
+struct __attribute__((packed)) WireBeacon {
+  WireHeader hdr;
+  uint8_t channel;
+  uint16_t interval_ms;
+};
+
+// MSG_TYPE_DIAG, version 1: 20 bytes, then `count` entries of `entry_len` bytes (WireDiagEntry)
+struct __attribute__((packed)) WireDiag {
+  WireHeader hdr;
+  uint16_t boot;
+  uint32_t uptime_s;
+  uint32_t window_s;
+  uint16_t wakes;
+  uint32_t awake_ms;
+  uint8_t count;
+  uint8_t entry_len;
+};
+
+struct __attribute__((packed)) WireDiagEntry {
+  uint8_t phase;
+  uint16_t count;
+  uint32_t mean_us;
+  uint32_t max_us;
+  uint8_t hist[DIAG_BUCKETS];
+};
+
+static_assert(sizeof(WireHeader) == 2, "WireHeader layout changed");
+static_assert(sizeof(WireSensor) == 19, "WireSensor layout changed");
+static_assert(offsetof(WireSensor, boot) == 2 && offsetof(WireSensor, seq) == 4 &&
+              offsetof(WireSensor, uptime_s) == 8 && offsetof(WireSensor, temperature) == 12 &&
+              offsetof(WireSensor, humidity) == 14 && offsetof(WireSensor, co2) == 16 &&
+              offsetof(WireSensor, flags) == WIRE_SENSOR_V1_LEN,
+              "WireSensor field offsets changed");
+static_assert(sizeof(WireSensor) != SENSOR_MSG_V0_LEN && WIRE_SENSOR_V1_LEN != SENSOR_MSG_V0_LEN,
+              "Typed frames must not look like legacy frames");
+static_assert(sizeof(WireSensor) <= ESPNOW_MAX_FRAME, "WireSensor does not fit in one ESP-NOW frame");
+static_assert(sizeof(WireMulti) == 14 && sizeof(WireMultiEntry) == 9 &&
+              offsetof(WireMultiEntry, flags) == WIRE_MULTI_ENTRY_V1_LEN, "WireMulti layout changed");
+static_assert(offsetof(WireMulti, seq) == 4 && offsetof(WireMulti, uptime_s) == 8 &&
+              offsetof(WireMulti, count) == 12 && offsetof(WireMulti, entry_len) == 13,
+              "WireMulti field offsets changed");
+static_assert(sizeof(WireAck) == 14 && offsetof(WireAck, boot) == 8 && offsetof(WireAck, seq) == 10,
+              "WireAck layout changed");
+static_assert(sizeof(WireBeacon) == 5 && offsetof(WireBeacon, interval_ms) == 3, "WireBeacon layout changed");
+static_assert(sizeof(WireDiag) == 20 && sizeof(WireDiagEntry) == 27 && offsetof(WireDiag, awake_ms) == 14,
+              "WireDiag layout changed");
+static_assert(sizeof(WireDiag) + DIAG_MAX_PHASES * sizeof(WireDiagEntry) <= ESPNOW_MAX_FRAME,
+              "DIAG_MAX_PHASES phases do not fit in one ESP-NOW frame");
+static_assert(sizeof(WireMulti) + MULTI_MAX_READINGS * sizeof(WireMultiEntry) <= ESPNOW_MAX_FRAME,
+              "MULTI_MAX_READINGS readings do not fit in one ESP-NOW frame");
+
+// Fixed-size types: nothing after the Wire struct
+struct WireFixed {
+  static const size_t MIN_LEN = 0;   // 0: sizeof(Wire), the type has only one length
+  template <typename Msg> static size_t tailSize(const Msg&) { return 0; }
+  template <typename Msg> static void encodeTail(const Msg&, uint8_t*) {}
+  template <typename Wire, typename Msg> static bool decodeTail(const Wire&, const uint8_t*, size_t, Msg&) { return true; }
+};
+
+// Maps an in-memory message to its wire layout: Wire, TYPE, VERSION, encode(), decode(), and
+// for variable-length types tailSize(), encodeTail() and decodeTail() (else inherit WireFixed).
+// MIN_LEN: length of the type's version 1 where later versions appended fields (0: sizeof(Wire))
+template <typename Msg>
+struct WireCodec;
+
+template <>
+struct WireCodec<sensor_msg> : WireFixed {
+  typedef WireSensor Wire;
+  static const uint8_t TYPE = MSG_TYPE_SENSOR;
+  static const uint8_t VERSION = 2;
+  static const size_t MIN_LEN = WIRE_SENSOR_V1_LEN;
+
+  static void encode(const sensor_msg& m, Wire& w) {
+    w.boot = m.boot;
+    w.seq = m.seq;
+    w.uptime_s = m.uptime_s;
+    w.temperature = uplinkToCenti(m.temperature);
+    w.humidity = uplinkToCentiU(m.humidity);
+    w.co2 = m.co2 == CO2_NONE ? 0 : m.co2;
+    w.flags = m.co2 == CO2_NONE ? READING_FLAG_NO_CO2 : 0;
+  }
+
+  static void decode(const Wire& w, sensor_msg& m) {
+    m.boot = w.boot;
+    m.seq = w.seq;
+    m.uptime_s = w.uptime_s;
+    m.temperature = w.temperature / 100.0f;
+    m.humidity = w.humidity / 100.0f;
+    m.co2 = (w.flags & READING_FLAG_NO_CO2) ? CO2_NONE : w.co2;
+  }
+};
+
+template <>
+struct WireCodec<multi_msg> {
+  typedef WireMulti Wire;
+  static const uint8_t TYPE = MSG_TYPE_MULTI;
+  static const uint8_t VERSION = 2;
+  static const size_t MIN_LEN = 0;
+
+  static void encode(const multi_msg& m, Wire& w) {
+    w.boot = m.boot;
+    w.seq = m.seq;
+    w.uptime_s = m.uptime_s;
+    w.count = m.count;
+    w.entry_len = sizeof(WireMultiEntry);
+  }
+
+  static void decode(const Wire& w, multi_msg& m) {
+    m.boot = w.boot;
+    m.seq = w.seq;
+    m.uptime_s = w.uptime_s;
+    m.count = w.count;
+  }
+
+  static size_t tailSize(const multi_msg& m) { return m.count * sizeof(WireMultiEntry); }
+
+  static void encodeTail(const multi_msg& m, uint8_t* p) {
+    for (uint8_t i = 0; i < m.count; ++i, p += sizeof(WireMultiEntry)) {
+      WireMultiEntry e;
+      e.age_s = m.readings[i].age_s;
+      e.temperature = uplinkToCenti(m.readings[i].temperature);
+      e.humidity = uplinkToCentiU(m.readings[i].humidity);
+      e.co2 = m.readings[i].co2 == CO2_NONE ? 0 : m.readings[i].co2;
+      e.flags = m.readings[i].co2 == CO2_NONE ? READING_FLAG_NO_CO2 : 0;
+      memcpy(p, &e, sizeof(e));
+    }
+  }
+
+  // p, len: the bytes after the Wire struct
+  static bool decodeTail(const Wire& w, const uint8_t* p, size_t len, multi_msg& m) {
+    if (m.count > MULTI_MAX_READINGS || w.entry_len < WIRE_MULTI_ENTRY_V1_LEN ||
+        len < (size_t)m.count * w.entry_len) return false;
+    size_t known = w.entry_len < sizeof(WireMultiEntry) ? w.entry_len : sizeof(WireMultiEntry);
+    for (uint8_t i = 0; i < m.count; ++i, p += w.entry_len) {
+      WireMultiEntry e;
+      memset(&e, 0, sizeof(e));
+      memcpy(&e, p, known);
+      m.readings[i].age_s = e.age_s;
+      m.readings[i].temperature = e.temperature / 100.0f;
+      m.readings[i].humidity = e.humidity / 100.0f;
+      m.readings[i].co2 = (e.flags & READING_FLAG_NO_CO2) ? CO2_NONE : e.co2;
+    }
+    return true;
+  }
+};
+
+template <>
+struct WireCodec<ack_msg> : WireFixed {
+  typedef WireAck Wire;
+  static const uint8_t TYPE = MSG_TYPE_ACK;
+  static const uint8_t VERSION = 1;
+
+  static void encode(const ack_msg& m, Wire& w) {
+    memcpy(w.station, m.station, 6);
+    w.boot = m.boot;
+    w.seq = m.seq;
+  }
+
+  static void decode(const Wire& w, ack_msg& m) {
+    memcpy(m.station, w.station, 6);
+    m.boot = w.boot;
+    m.seq = w.seq;
+  }
+};
+
+template <>
+struct WireCodec<beacon_msg> : WireFixed {
+  typedef WireBeacon Wire;
+  static const uint8_t TYPE = MSG_TYPE_BEACON;
+  static const uint8_t VERSION = 1;
+
+  static void encode(const beacon_msg& m, Wire& w) {
+    w.channel = m.channel;
+    w.interval_ms = m.interval_ms;
+  }
+
+  static void decode(const Wire& w, beacon_msg& m) {
+    m.channel = w.channel;
+    m.interval_ms = w.interval_ms;
+  }
+};
+
+template <>
+struct WireCodec<diag_msg> {
+  typedef WireDiag Wire;
+  static const uint8_t TYPE = MSG_TYPE_DIAG;
+  static const uint8_t VERSION = 1;
+  static const size_t MIN_LEN = 0;
+
+  static void encode(const diag_msg& m, Wire& w) {
+    w.boot = m.boot;
+    w.uptime_s = m.uptime_s;
+    w.window_s = m.window_s;
+    w.wakes = m.wakes;
+    w.awake_ms = m.awake_ms;
+    w.count = m.count;
+    w.entry_len = sizeof(WireDiagEntry);
+  }
+
+  static void decode(const Wire& w, diag_msg& m) {
+    m.boot = w.boot;
+    m.uptime_s = w.uptime_s;
+    m.window_s = w.window_s;
+    m.wakes = w.wakes;
+    m.awake_ms = w.awake_ms;
+    m.count = w.count;
+  }
+
+  static size_t tailSize(const diag_msg& m) { return m.count * sizeof(WireDiagEntry); }
+
+  static void encodeTail(const diag_msg& m, uint8_t* p) {
+    for (uint8_t i = 0; i < m.count; ++i, p += sizeof(WireDiagEntry)) {
+      WireDiagEntry e;
+      e.phase = m.phases[i].phase;
+      e.count = m.phases[i].count;
+      e.mean_us = m.phases[i].mean_us;
+      e.max_us = m.phases[i].max_us;
+      memcpy(e.hist, m.phases[i].hist, DIAG_BUCKETS);
+      memcpy(p, &e, sizeof(e));
+    }
+  }
+
+  static bool decodeTail(const Wire& w, const uint8_t* p, size_t len, diag_msg& m) {
+    if (m.count > DIAG_MAX_PHASES || w.entry_len < sizeof(WireDiagEntry) ||
+        len < (size_t)m.count * w.entry_len) return false;
+    for (uint8_t i = 0; i < m.count; ++i, p += w.entry_len) {
+      WireDiagEntry e;
+      memcpy(&e, p, sizeof(e));
+      m.phases[i].phase = e.phase;
+      m.phases[i].count = e.count;
+      m.phases[i].mean_us = e.mean_us;
+      m.phases[i].max_us = e.max_us;
+      memcpy(m.phases[i].hist, e.hist, DIAG_BUCKETS);
+    }
+    return true;
+  }
+};
+
+// Build a frame. Returns its length, or 0 if the buffer is too small.
+template <typename Msg>
+size_t wireEncode(const Msg& m, uint8_t* buf, size_t cap) {
+  typedef WireCodec<Msg> Codec;
+  typename Codec::Wire w;
+  size_t len = sizeof(w) + Codec::tailSize(m);
+  if (cap < len) return 0;
+  memset(&w, 0, sizeof(w));
+  w.hdr.type = Codec::TYPE;
+  w.hdr.version = Codec::VERSION;
+  Codec::encode(m, w);
+  memcpy(buf, &w, sizeof(w));
+  Codec::encodeTail(m, buf + sizeof(w));
+  return len;
+}
+
+// Type of a typed frame, 0 if it is too short to have a header
+inline uint8_t wireType(const uint8_t* buf, size_t len) {
+  return len >= sizeof(WireHeader) ? buf[0] : 0;
+}
+
+// Parse a frame of type Msg. Newer versions (longer frames) are read up to the known layout,
+// older ones down to MIN_LEN with the missing fields as 0.
+template <typename Msg>
+bool wireDecode(const uint8_t* buf, size_t len, Msg& out) {
+  typedef WireCodec<Msg> Codec;
+  typename Codec::Wire w;
+  size_t minLen = Codec::MIN_LEN ? Codec::MIN_LEN : sizeof(w);
+  if (len < minLen || buf[0] != Codec::TYPE || buf[1] < 1) return false;
+  memset(&w, 0, sizeof(w));
+  memcpy(&w, buf, len < sizeof(w) ? len : sizeof(w));
+  Codec::decode(w, out);
+  if (len < sizeof(w)) return true;   // Shorter older version of a fixed-size type: no tail
+  return Codec::decodeTail(w, buf + sizeof(w), len - sizeof(w), out);
+}
+
+// Reading i of a multi-reading frame as a single numbered message
+inline sensor_msg multiReadingAt(const multi_msg& m, uint8_t i) {
+  sensor_msg r;
+  r.temperature = m.readings[i].temperature;
+  r.co2 = m.readings[i].co2;
+  r.humidity = m.readings[i].humidity;
+  r.boot = m.boot;
+  r.seq = m.seq + i;
+  r.uptime_s = m.uptime_s - m.readings[i].age_s;
+  return r;
+}
+
+// Sensor reading from any frame the gateway understands: a typed MSG_TYPE_SENSOR frame, or the
+// legacy raw struct. `numbered` tells whether boot/seq are valid.
+inline bool decodeSensorFrame(const uint8_t* buf, size_t len, sensor_msg& out, bool& numbered) {
+  if (len == SENSOR_MSG_V0_LEN) {
+    memset(&out, 0, sizeof(out));
+    memcpy(&out.temperature, buf, 4);
+    memcpy(&out.co2, buf + 4, 2);
+    memcpy(&out.humidity, buf + 8, 4);
+    numbered = false;
+    return true;
+  }
+  numbered = true;
+  return wireDecode(buf, len, out);
+}
@@ -0,0 +1,335 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "uplink_binary.h"  // uplinkCrc32 and the little-endian helpers
+
+// Write-ahead log for gateway readings, so a reboot (crash, brown-out, ESP.restart()) does not
+// lose what was waiting for upload. Plain C++ with no Arduino dependencies: the storage is a
+// template parameter (LittleFS on the gateway, see flash_wal_littlefs.h; files or RAM in
+// tools/wal_reader.cpp).
+//
+// The log is a numbered series of segment files. A segment is a sequence of fixed-size pages,
+// each page is written once, in one piece, at a page-aligned offset:
+//
+//   offset  size  field
+//   0       2     magic "WL"
+//   2       1     record count (1..WAL_RECORDS_PER_PAGE)
+//   3       1     reserved (0)
+//   4       4     sequence number of the first record
+//   8       4     CRC-32 over bytes 0..7 and 12..end of page
+//   12      22*n  records, rest of the page is 0xFF
+//
+//   record: MAC (6), rssi (i16), temperature (float), humidity (float), co2 (u16),
+//           receive time (u32, unix seconds, 0 if the gateway had no time yet)
+//
+// Records are group-committed: they collect in a RAM page that is written when it is full or
+// when its oldest record is WAL_COMMIT_INTERVAL_MS old. A page with a bad CRC (torn write on
+// power loss) is skipped, and every boot starts a new segment, so nothing is ever appended
+// behind a damaged page.
+//
+// The upload cursor (first sequence number not yet confirmed by the server) is stored in a
+// separate small record and written at most every WAL_CURSOR_INTERVAL_MS. After a reboot,
+// everything from the cursor on is uploaded again; the server may see a few readings twice.
+//
+// Storage backend interface:
+//   bool segmentRange(uint32_t& first, uint32_t& last)  oldest / newest segment number, false if none
+//   uint32_t segmentPages(uint32_t seg)                 whole pages in the segment (0 if missing)
+//   bool readPage(uint32_t seg, uint32_t page, uint8_t* buf)
+//   bool appendPage(uint32_t seg, const uint8_t* buf)   creates the segment; durable once it returns
+//   void removeSegment(uint32_t seg)
+//   bool loadCursor(uint8_t* buf, size_t len)
+//   bool saveCursor(const uint8_t* buf, size_t len)     must replace the old cursor atomically
+
+#ifndef WAL_SEGMENT_PAGES
+#define WAL_SEGMENT_PAGES 64            // Pages per segment file (16 KB)
+#endif
+#ifndef WAL_MAX_SEGMENTS
+#define WAL_MAX_SEGMENTS 64             // Oldest segment is dropped beyond this, uploaded or not
+#endif
+#ifndef WAL_COMMIT_INTERVAL_MS
+#define WAL_COMMIT_INTERVAL_MS 5000     // Max time a reading waits in RAM before it is written
+#endif
+#ifndef WAL_CURSOR_INTERVAL_MS
+#define WAL_CURSOR_INTERVAL_MS 10000    // Min time between cursor writes
+#endif
+
+#define WAL_PAGE_SIZE 256               // LittleFS program size on the ESP32
+#define WAL_PAGE_MAGIC0 'W'
+#define WAL_PAGE_MAGIC1 'L'
+#define WAL_PAGE_HEADER_LEN 12
+#define WAL_RECORD_LEN 22
+#define WAL_RECORDS_PER_PAGE ((WAL_PAGE_SIZE - WAL_PAGE_HEADER_LEN) / WAL_RECORD_LEN)
+#define WAL_CURSOR_MAGIC 0x52435357     // "WSCR"
+#define WAL_CURSOR_LEN 12
+
+struct WalRecord {
+  uint32_t seq;
+  uint8_t mac[6];
+  int16_t rssi;
+  float temperature;
+  float humidity;
+  uint16_t co2;
+  uint32_t unix_s;
+};
+
+inline uint32_t walPageCrc(const uint8_t* page) {
+  uint32_t crc = uplinkCrc32(page, 8);
+  return uplinkCrc32(page + WAL_PAGE_HEADER_LEN, WAL_PAGE_SIZE - WAL_PAGE_HEADER_LEN, crc);
+}
+
+// Number of records in a page, or 0 if it is not a valid page
+inline uint8_t walPageValid(const uint8_t* page) {
+  if (page[0] != WAL_PAGE_MAGIC0 || page[1] != WAL_PAGE_MAGIC1) return 0;
+  if (page[2] == 0 || page[2] > WAL_RECORDS_PER_PAGE) return 0;
+  if (uplinkGetU32(page + 8) != walPageCrc(page)) return 0;
+  return page[2];
+}
+
+inline uint32_t walPageFirstSeq(const uint8_t* page) { return uplinkGetU32(page + 4); }
+
+inline void walPutRecord(uint8_t* p, const WalRecord& r) {
+  uint32_t bits;
+  memcpy(p, r.mac, 6);
+  uplinkPutU16(p + 6, (uint16_t)r.rssi);
+  memcpy(&bits, &r.temperature, 4);
+  uplinkPutU32(p + 8, bits);
+  memcpy(&bits, &r.humidity, 4);
+  uplinkPutU32(p + 12, bits);
+  uplinkPutU16(p + 16, r.co2);
+  uplinkPutU32(p + 18, r.unix_s);
+}
+
+// i-th record of a valid page
+inline void walGetRecord(const uint8_t* page, uint8_t i, WalRecord& r) {
+  const uint8_t* p = page + WAL_PAGE_HEADER_LEN + (size_t)i * WAL_RECORD_LEN;
+  uint32_t bits;
+  r.seq = walPageFirstSeq(page) + i;
+  memcpy(r.mac, p, 6);
+  r.rssi = (int16_t)uplinkGetU16(p + 6);
+  bits = uplinkGetU32(p + 8);
+  memcpy(&r.temperature, &bits, 4);
+  bits = uplinkGetU32(p + 12);
+  memcpy(&r.humidity, &bits, 4);
+  r.co2 = uplinkGetU16(p + 16);
+  r.unix_s = uplinkGetU32(p + 18);
+}
+
+template <typename Storage>
+class FlashWal {
+public:
+  explicit FlashWal(Storage& storage)
+      : pagesWritten(0), commits(0), cursorWrites(0), corruptPages(0), lostRecords(0),
+        store(storage), firstSeg(0), curSeg(0), curSegPages(0), next(1), committed(1),
+        cur(1), savedCur(1), pageCount(0), pageOpenMs(0), cursorSaveMs(0) {}
+
+  // Recover the log after boot: find the end of the log and the saved cursor, and open a
+  // fresh segment for new records. Call once before anything else.
+  bool begin() {
+    uint32_t first, last;
+    uint32_t end = 1;
+    if (store.segmentRange(first, last)) {
+      firstSeg = first;
+      curSeg = last + 1;
+      // End of the log: newest segment with at least one valid page
+      for (uint32_t seg = last + 1; seg-- > first;) {
+        if (lastSeqIn(seg, end)) break;
+      }
+    }
+
+    uint8_t buf[WAL_CURSOR_LEN];
+    uint32_t saved = 0;
+    if (store.loadCursor(buf, sizeof(buf)) && uplinkGetU32(buf) == WAL_CURSOR_MAGIC &&
+        uplinkGetU32(buf + 8) == uplinkCrc32(buf, 8)) {
+      saved = uplinkGetU32(buf + 4);
+    } else if (curSeg > firstSeg) {
+      // No cursor yet (or it is damaged): upload everything that is still in the log
+      saved = end;
+      for (uint32_t seg = firstSeg; seg < curSeg; ++seg) {
+        if (firstSeqIn(seg, saved)) break;
+      }
+    }
+    // Never reuse sequence numbers, even if the newest pages were lost
+    next = committed = saved > end ? saved : end;
+    cur = savedCur = saved ? saved : next;
+    return true;
+  }
+
+  uint32_t nextSeq() const { return next; }
+  uint32_t cursor() const { return cur; }
+  uint32_t pending() const { return next - cur; }      // Readings not confirmed by the server
+  uint32_t segments() const { return curSeg - firstSeg + (curSegPages ? 1 : 0); }
+
+  // Add a record to the open page and return its sequence number. The page is written when
+  // it is full; otherwise tick() writes it once it is old enough.
+  uint32_t append(const WalRecord& rec, uint32_t nowMs) {
+    if (pageCount == 0) {
+      memset(page, 0xFF, sizeof(page));
+      pageOpenMs = nowMs;
+    }
+    WalRecord r = rec;
+    r.seq = next++;
+    walPutRecord(page + WAL_PAGE_HEADER_LEN + (size_t)pageCount * WAL_RECORD_LEN, r);
+    if (++pageCount == WAL_RECORDS_PER_PAGE) commit();
+    return r.seq;
+  }
+
+  // Everything below seq has been uploaded
+  void setCursor(uint32_t seq) {
+    if (seq > next) seq = next;
+    if (seq > cur) cur = seq;
+  }
+
+  // Group commit and cursor persistence; call regularly from the uploader task
+  void tick(uint32_t nowMs) {
+    if (pageCount && nowMs - pageOpenMs >= WAL_COMMIT_INTERVAL_MS) commit();
+    if (cur != savedCur && nowMs - cursorSaveMs >= WAL_CURSOR_INTERVAL_MS) {
+      saveCursor();
+      cursorSaveMs = nowMs;
+      dropUploadedSegments();
+    }
+  }
+
+  // Write the open page now (padded to a full page)
+  bool commit() {
+    if (pageCount == 0) return true;
+    page[0] = WAL_PAGE_MAGIC0;
+    page[1] = WAL_PAGE_MAGIC1;
+    page[2] = pageCount;
+    page[3] = 0;
+    uplinkPutU32(page + 4, committed);
+    uplinkPutU32(page + 8, walPageCrc(page));
+
+    if (curSegPages == WAL_SEGMENT_PAGES) {
+      curSeg++;
+      curSegPages = 0;
+    }
+    bool ok = store.appendPage(curSeg, page);
+    if (ok) {
+      curSegPages++;
+      pagesWritten++;
+    } else {
+      lostRecords += pageCount;  // Flash full or failing: the readings are still in RAM
+    }
+    commits++;
+    committed += pageCount;
+    pageCount = 0;
+
+    // Bound the space used: beyond WAL_MAX_SEGMENTS the oldest segment goes, uploaded or not
+    while (curSeg - firstSeg >= WAL_MAX_SEGMENTS) {
+      uint32_t nextFirst = firstSeqAfter(firstSeg);
+      if (cur < nextFirst) {
+        lostRecords += nextFirst - cur;
+        cur = nextFirst;
+      }
+      store.removeSegment(firstSeg++);
+    }
+    return ok;
+  }
+
+  // Call fn(const WalRecord&) for every committed record with seq >= fromSeq, oldest first.
+  // Returns the number of records visited.
+  template <typename F>
+  uint32_t replay(uint32_t fromSeq, F fn) {
+    uint8_t buf[WAL_PAGE_SIZE];
+    uint32_t count = 0;
+    uint32_t endSeg = curSeg + (curSegPages ? 1 : 0);
+    for (uint32_t seg = firstSeg; seg < endSeg; ++seg) {
+      uint32_t pages = store.segmentPages(seg);
+      for (uint32_t p = 0; p < pages; ++p) {
+        uint8_t n = store.readPage(seg, p, buf) ? walPageValid(buf) : 0;
+        if (n == 0) {
+          corruptPages++;
+          continue;
+        }
+        if (walPageFirstSeq(buf) + n <= fromSeq) continue;
+        for (uint8_t i = 0; i < n; ++i) {
+          WalRecord r;
+          walGetRecord(buf, i, r);
+          if (r.seq < fromSeq) continue;
+          fn(r);
+          count++;
+        }
+      }
+    }
+    return count;
+  }
+
+  uint32_t pagesWritten;   // Pages written since boot
+  uint32_t commits;        // Page writes attempted (full pages and timed commits)
+  uint32_t cursorWrites;   // Cursor records written
+  uint32_t corruptPages;   // Pages skipped during replay because of a bad CRC
+  uint32_t lostRecords;    // Records dropped before upload (write failed or log full)
+
+private:
+  // Sequence number after the last valid record of a segment
+  bool lastSeqIn(uint32_t seg, uint32_t& end) {
+    uint8_t buf[WAL_PAGE_SIZE];
+    bool found = false;
+    uint32_t pages = store.segmentPages(seg);
+    for (uint32_t p = 0; p < pages; ++p) {
+      uint8_t n = store.readPage(seg, p, buf) ? walPageValid(buf) : 0;
+      if (n && walPageFirstSeq(buf) + n > end) {
+        end = walPageFirstSeq(buf) + n;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  // Sequence number of the first valid record of a segment
+  bool firstSeqIn(uint32_t seg, uint32_t& first) {
+    uint8_t buf[WAL_PAGE_SIZE];
+    uint32_t pages = store.segmentPages(seg);
+    for (uint32_t p = 0; p < pages; ++p) {
+      if (store.readPage(seg, p, buf) && walPageValid(buf)) {
+        first = walPageFirstSeq(buf);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // First sequence number stored after segment seg (segments without valid pages are skipped)
+  uint32_t firstSeqAfter(uint32_t seg) {
+    uint32_t first = committed;
+    uint32_t endSeg = curSeg + (curSegPages ? 1 : 0);
+    for (uint32_t s = seg + 1; s < endSeg; ++s) {
+      if (firstSeqIn(s, first)) break;
+    }
+    return first;
+  }
+
+  void saveCursor() {
+    uint8_t buf[WAL_CURSOR_LEN];
+    uplinkPutU32(buf, WAL_CURSOR_MAGIC);
+    uplinkPutU32(buf + 4, cur);
+    uplinkPutU32(buf + 8, uplinkCrc32(buf, 8));
+    if (store.saveCursor(buf, sizeof(buf))) {
+      savedCur = cur;
+      cursorWrites++;
+    }
+  }
+
+  // Remove old segments whose records have all been uploaded
+  void dropUploadedSegments() {
+    while (firstSeg < curSeg) {
+      if (firstSeqAfter(firstSeg) > savedCur) break;
+      store.removeSegment(firstSeg++);
+    }
+  }
+
+  Storage& store;
+  uint32_t firstSeg;       // Oldest segment still on flash
+  uint32_t curSeg;         // Segment new pages go to
+  uint32_t curSegPages;    // Pages already in curSeg
+  uint32_t next;           // Sequence number of the next record
+  uint32_t committed;      // Sequence number of the first record in the open page
+  uint32_t cur;            // Upload cursor
+  uint32_t savedCur;       // Cursor as last written to flash
+  uint8_t page[WAL_PAGE_SIZE];
+  uint8_t pageCount;
+  uint32_t pageOpenMs;
+  uint32_t cursorSaveMs;
+};
@@ -0,0 +1,98 @@
+#include <Arduino.h>
+#pragma once
+#include <FS.h>
+#include <LittleFS.h>
+#include <inttypes.h>
+
+#include "flash_wal.h"
+
+// LittleFS backend for FlashWal, on the "wal" partition (partitions_gateway.csv).
+// Segments are files "/seg00000012.wal", the cursor is "/cursor". LittleFS is copy-on-write:
+// an append or a rewrite only becomes visible when the file is closed, so a power loss leaves
+// either the old or the new file content, never a half-written page.
+#define WAL_PARTITION_LABEL "wal"
+#define WAL_BASE_PATH "/wal"
+
+class LittleFsWalStorage {
+public:
+  bool begin() {
+    // Format on first use (fresh partition)
+    return LittleFS.begin(true, WAL_BASE_PATH, 4, WAL_PARTITION_LABEL);
+  }
+
+  size_t usedBytes() { return LittleFS.usedBytes(); }
+  size_t totalBytes() { return LittleFS.totalBytes(); }
+
+  bool segmentRange(uint32_t& first, uint32_t& last) {
+    bool found = false;
+    File root = LittleFS.open("/");
+    if (!root) return false;
+    for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+      uint32_t seg;
+      if (parseName(f.name(), seg)) {
+        if (!found || seg < first) first = seg;
+        if (!found || seg > last) last = seg;
+        found = true;
+      }
+    }
+    return found;
+  }
+
+  uint32_t segmentPages(uint32_t seg) {
+    char path[24];
+    segmentPath(seg, path);
+    File f = LittleFS.open(path, "r");
+    if (!f) return 0;
+    return f.size() / WAL_PAGE_SIZE;
+  }
+
+  bool readPage(uint32_t seg, uint32_t page, uint8_t* buf) {
+    char path[24];
+    segmentPath(seg, path);
+    File f = LittleFS.open(path, "r");
+    if (!f || !f.seek((size_t)page * WAL_PAGE_SIZE)) return false;
+    return f.read(buf, WAL_PAGE_SIZE) == WAL_PAGE_SIZE;
+  }
+
+  bool appendPage(uint32_t seg, const uint8_t* buf) {
+    char path[24];
+    segmentPath(seg, path);
+    File f = LittleFS.open(path, "a");
+    if (!f) return false;
+    bool ok = f.write(buf, WAL_PAGE_SIZE) == WAL_PAGE_SIZE;
+    f.close();  // Commits the page
+    return ok;
+  }
+
+  void removeSegment(uint32_t seg) {
+    char path[24];
+    segmentPath(seg, path);
+    LittleFS.remove(path);
+  }
+
+  bool loadCursor(uint8_t* buf, size_t len) {
+    File f = LittleFS.open("/cursor", "r");
+    return f && f.read(buf, len) == len;
+  }
+
+  bool saveCursor(const uint8_t* buf, size_t len) {
+    File f = LittleFS.open("/cursor", "w");
+    if (!f) return false;
+    bool ok = f.write(buf, len) == len;
+    f.close();
+    return ok;
+  }
+
+private:
+  static void segmentPath(uint32_t seg, char* path) {
+    snprintf(path, 24, "/seg%08" PRIu32 ".wal", seg);   // At most 10 digits: 19 bytes
+  }
+
+  static bool parseName(const char* name, uint32_t& seg) {
+    const char* base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    if (strncmp(base, "seg", 3) != 0 || strlen(base) != 15 || strcmp(base + 11, ".wal") != 0) return false;
+    seg = strtoul(base + 3, NULL, 10);
+    return true;
+  }
+};
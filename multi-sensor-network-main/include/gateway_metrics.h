@@ -0,0 +1,123 @@
+#pragma once
+
+// Gateway counters for the /metrics endpoint (metrics_server.h) and a writer for the Prometheus
+// text format they are served in. Plain C++ with no Arduino dependencies.
+//
+// Counters are relaxed atomics: the ESP-NOW callback and the uplink task bump them without a
+// lock or a critical section, the HTTP server task reads them whenever it is scraped. They only
+// ever go up (and wrap at 2^32, which Prometheus treats as a counter reset).
+
+#include <atomic>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+inline void metricInc(std::atomic<uint32_t>& c, uint32_t n = 1) {
+  c.fetch_add(n, std::memory_order_relaxed);
+}
+
+inline uint32_t metricGet(const std::atomic<uint32_t>& c) {
+  return c.load(std::memory_order_relaxed);
+}
+
+// Fixed buckets in milliseconds; written in seconds, cumulative, as Prometheus expects
+#define METRICS_LATENCY_BUCKETS 11
+static const uint32_t metricsLatencyBucketsMs[METRICS_LATENCY_BUCKETS] = {
+  10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 30000
+};
+
+struct LatencyHistogram {
+  std::atomic<uint32_t> counts[METRICS_LATENCY_BUCKETS + 1];  // Last: above the largest bucket
+  std::atomic<uint32_t> sumMs;
+
+  void observe(uint32_t ms) {
+    uint8_t i = 0;
+    while (i < METRICS_LATENCY_BUCKETS && ms > metricsLatencyBucketsMs[i]) ++i;
+    metricInc(counts[i]);
+    metricInc(sumMs, ms);
+  }
+};
+
+// Uplink POST outcome, as counted per request and per reading
+enum UplinkResult { UPLINK_RESULT_OK = 0, UPLINK_RESULT_REJECTED, UPLINK_RESULT_FAILED, UPLINK_RESULTS };
+
+inline UplinkResult uplinkResult(int httpCode) {
+  if (httpCode >= 200 && httpCode < 300) return UPLINK_RESULT_OK;
+  if (httpCode >= 400 && httpCode < 500) return UPLINK_RESULT_REJECTED;   // Dropped, not retried
+  return UPLINK_RESULT_FAILED;                                            // Kept in the backlog
+}
+
+inline const char* uplinkResultName(uint8_t r) {
+  return r == UPLINK_RESULT_OK ? "ok" : r == UPLINK_RESULT_REJECTED ? "rejected" : "failed";
+}
+
+// Everything the hot paths count. Zero-initialised as a global.
+struct GatewayMetrics {
+  std::atomic<uint32_t> frames;         // ESP-NOW frames received, any type
+  std::atomic<uint32_t> invalidFrames;  // Length, type or version matches no known message
+  std::atomic<uint32_t> registryFull;   // From a new station while NUM_STATIONS are registered
+  std::atomic<uint32_t> readings;       // Readings accepted and queued for upload
+  std::atomic<uint32_t> duplicates;     // Readings dropped as duplicate or stale (seq_tracker.h)
+  std::atomic<uint32_t> posts[UPLINK_RESULTS];
+  std::atomic<uint32_t> uploaded[UPLINK_RESULTS];  // Readings, by the result of their POST
+  LatencyHistogram postLatency;                    // Time per POST, connection setup included
+};
+
+// Prometheus text exposition format (version 0.0.4). Output goes to `sink` in pieces of up to
+// sizeof(buf) bytes (the HTTP server sends each as one chunk), so a scrape with hundreds of
+// stations needs no large buffer.
+class PromWriter {
+public:
+  typedef void (*Sink)(void* ctx, const char* data, size_t len);
+
+  PromWriter(Sink sink, void* ctx) : sink(sink), ctx(ctx), len(0) {}
+
+  // # HELP / # TYPE lines that start a metric family
+  void family(const char* name, const char* type, const char* help) {
+    line("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  }
+
+  // One line (or a few), printf-style. Lines longer than the buffer are cut.
+  void line(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      va_list ap;
+      va_start(ap, fmt);
+      int n = vsnprintf(buf + len, sizeof(buf) - len, fmt, ap);
+      va_end(ap);
+      if (n < 0) return;
+      if (len + n < sizeof(buf)) {
+        len += n;
+        return;
+      }
+      if (len == 0) {
+        len = sizeof(buf) - 1;
+        return;
+      }
+      flush();   // Did not fit: send what is there and try again in the empty buffer
+    }
+  }
+
+  void histogram(const char* name, const char* help, const LatencyHistogram& h) {
+    family(name, "histogram", help);
+    uint32_t cumulative = 0;
+    for (uint8_t i = 0; i < METRICS_LATENCY_BUCKETS; ++i) {
+      cumulative += metricGet(h.counts[i]);
+      line("%s_bucket{le=\"%g\"} %u\n", name, metricsLatencyBucketsMs[i] / 1000.0, cumulative);
+    }
+    cumulative += metricGet(h.counts[METRICS_LATENCY_BUCKETS]);
+    line("%s_bucket{le=\"+Inf\"} %u\n%s_sum %.3f\n%s_count %u\n", name, cumulative,
+         name, metricGet(h.sumMs) / 1000.0, name, cumulative);
+  }
+
+  void flush() {
+    if (len) sink(ctx, buf, len);
+    len = 0;
+  }
+
+private:
+  Sink sink;
+  void* ctx;
+  char buf[512];
+  size_t len;
+};
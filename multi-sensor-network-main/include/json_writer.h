@@ -0,0 +1,201 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "uplink_binary.h"  // CO2_NONE
+
+// Minimal JSON writer over a caller-provided buffer: no heap, no printf.
+// Used on the gateway upload path instead of String concatenation, so long uptimes
+// don't fragment the heap. Plain C++, so the host benchmark in tools/ can use it too.
+//
+// Writes stop (and overflow() turns true) once the buffer is full; the output is always
+// NUL-terminated.
+class JsonWriter {
+public:
+  JsonWriter(char* buffer, size_t capacity) : buf(buffer), cap(capacity), len(0), full(false) {
+    if (cap) buf[0] = '\0';
+  }
+
+  size_t length() const { return len; }
+  bool overflow() const { return full; }
+  const char* c_str() const { return buf; }
+
+  // Drop everything after `mark` (a previous length()), e.g. to undo a record that did not fit
+  void truncate(size_t mark) {
+    if (mark < len) len = mark;
+    full = false;
+    if (cap) buf[len] = '\0';
+  }
+
+  void raw(char c) {
+    if (len + 1 >= cap) { full = true; return; }
+    buf[len++] = c;
+    buf[len] = '\0';
+  }
+
+  void raw(const char* s) {
+    size_t n = strlen(s);
+    if (len + n >= cap) { full = true; return; }
+    memcpy(buf + len, s, n + 1);
+    len += n;
+  }
+
+  // "key":
+  void key(const char* k) {
+    raw('"');
+    raw(k);
+    raw("\":");
+  }
+
+  // Quoted string; the gateway only writes MACs and fixed keys, so no escaping is done
+  void str(const char* s) {
+    raw('"');
+    raw(s);
+    raw('"');
+  }
+
+  void u32(uint32_t v) {
+    char tmp[11];
+    int n = 0;
+    do {
+      tmp[n++] = '0' + (v % 10);
+      v /= 10;
+    } while (v);
+    if (len + n >= cap) { full = true; return; }
+    while (n) buf[len++] = tmp[--n];
+    buf[len] = '\0';
+  }
+
+  void i32(int32_t v) {
+    if (v < 0) {
+      raw('-');
+      u32((uint32_t)(-(int64_t)v));
+    } else {
+      u32((uint32_t)v);
+    }
+  }
+
+  // Fixed-point float with `decimals` digits (0..6), rounded half away from zero, like
+  // String(value, decimals). NaN/inf are not valid JSON and are written as null, as are values
+  // whose integer part does not fit in 32 bits. Float and integer math only: the ESP32-S3 has
+  // no double-precision FPU.
+  void fixed(float v, uint8_t decimals) {
+    if (decimals > 6) decimals = 6;
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+
+    bool negative = v < 0;
+    float scaled = (negative ? -v : v) * (float)scale;
+    if (!(scaled < 9.0e18f)) {   // Also NaN and inf
+      raw("null");
+      return;
+    }
+    uint64_t units = (uint64_t)llroundf(scaled);
+    uint64_t whole = units / scale;
+    if (whole > 0xFFFFFFFFull) {
+      raw("null");
+      return;
+    }
+    uint32_t frac = (uint32_t)(units - whole * scale);
+
+    if (negative && units != 0) raw('-');
+    u32((uint32_t)whole);
+    if (decimals) {
+      raw('.');
+      char digits[6];
+      for (int i = decimals - 1; i >= 0; --i) {
+        digits[i] = '0' + (frac % 10);
+        frac /= 10;
+      }
+      if (len + decimals >= cap) { full = true; return; }
+      memcpy(buf + len, digits, decimals);
+      len += decimals;
+      buf[len] = '\0';
+    }
+  }
+
+  // Room for a u32 that is only known later: U32_SLOT_LEN spaces now, fillU32() writes the digits
+  // into them. The unused rest stays blank, which JSON allows after a value. Returns the offset.
+  static const size_t U32_SLOT_LEN = 10;
+
+  size_t u32Slot() {
+    size_t at = len;
+    if (len + U32_SLOT_LEN >= cap) { full = true; return at; }
+    memset(buf + len, ' ', U32_SLOT_LEN);
+    len += U32_SLOT_LEN;
+    buf[len] = '\0';
+    return at;
+  }
+
+  void fillU32(size_t at, uint32_t v) {
+    if (at + U32_SLOT_LEN > len) return;
+    char tmp[U32_SLOT_LEN];
+    int n = 0;
+    do {
+      tmp[n++] = '0' + (v % 10);
+      v /= 10;
+    } while (v);
+    memset(buf + at, ' ', U32_SLOT_LEN);
+    for (int i = 0; i < n; ++i) buf[at + i] = tmp[n - 1 - i];
+  }
+
+  // "AA:BB:CC:DD:EE:FF" (quoted)
+  void mac(const uint8_t m[6]) {
+    static const char hex[] = "0123456789ABCDEF";
+    if (len + 19 >= cap) { full = true; return; }
+    buf[len++] = '"';
+    for (int i = 0; i < 6; ++i) {
+      buf[len++] = hex[m[i] >> 4];
+      buf[len++] = hex[m[i] & 0x0F];
+      if (i < 5) buf[len++] = ':';
+    }
+    buf[len++] = '"';
+    buf[len] = '\0';
+  }
+
+private:
+  char* buf;
+  size_t cap;
+  size_t len;
+  bool full;
+};
+
+// CO2 in ppm, or null for a reading without a CO2 value (CO2_NONE)
+inline void writeCo2(JsonWriter& w, uint16_t co2) {
+  if (co2 == CO2_NONE) w.raw("null");
+  else w.u32(co2);
+}
+
+// One reading in the schema the ingest endpoints have always accepted:
+// {"mac":"..","device_id":"..","temperature":21.50,"humidity":40.25,"co2":400} ("co2":null
+// when the station measured temperature and humidity only)
+inline void writeReadingFields(JsonWriter& w, const uint8_t mac[6], float temperature, float humidity, uint16_t co2) {
+  w.raw("{\"mac\":");
+  w.mac(mac);
+  w.raw(",\"device_id\":");
+  w.mac(mac);
+  w.raw(",\"temperature\":");
+  w.fixed(temperature, 2);
+  w.raw(",\"humidity\":");
+  w.fixed(humidity, 2);
+  w.raw(",\"co2\":");
+  writeCo2(w, co2);
+}
+
+inline void writeReadingJson(JsonWriter& w, const uint8_t mac[6], float temperature, float humidity, uint16_t co2) {
+  writeReadingFields(w, mac, temperature, humidity, co2);
+  w.raw('}');
+}
+
+// Same, plus "age_ms": how long ago the gateway received the reading. The server uses it to
+// timestamp readings that were uploaded late (backlog replay after an outage). The age is only
+// known when the body is sent, so it is left as a slot: returns its offset for fillU32().
+inline size_t writeReadingJsonAgeSlot(JsonWriter& w, const uint8_t mac[6], float temperature, float humidity, uint16_t co2) {
+  writeReadingFields(w, mac, temperature, humidity, co2);
+  w.raw(",\"age_ms\":");
+  size_t ageAt = w.u32Slot();
+  w.raw('}');
+  return ageAt;
+}
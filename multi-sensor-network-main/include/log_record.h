@@ -0,0 +1,381 @@
+#pragma once
+
+// Deferred log records (serial_log.h): what a LOG_E / LOG_W / LOG_I / LOG_D call leaves in the
+// log ring instead of a formatted line, the ring itself, the printf-style formatter the log task
+// and the host decoder (tools/log_decode.cpp) share, and the frames of binary log output
+// (LOG_BINARY). Plain C++ with no Arduino dependencies.
+//
+// Record: format string pointer, micros() timestamp, level, then the arguments, each as a tag
+// byte (kind in the high nibble, size in the low one) and its bytes in machine order. Strings
+// are copied (tag, length byte, characters), so buffers may be reused right after the call.
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#define LOG_MAX_RECORD 160      // Bytes per record, arguments included (the rest are dropped)
+#define LOG_MAX_STR 64          // String arguments are cut to this many characters
+#define LOG_RECORD_HEADER (sizeof(const char*) + 5)
+
+#define LOG_ARG_INT   0x10
+#define LOG_ARG_UINT  0x20
+#define LOG_ARG_FLOAT 0x30
+#define LOG_ARG_STR   0x40
+
+// Appends tagged arguments to a record; arguments that do not fit are left out
+struct LogArgWriter {
+  uint8_t* p;
+  uint8_t* end;
+  bool full;
+
+  LogArgWriter(uint8_t* buf, size_t cap) : p(buf), end(buf + cap), full(false) {}
+
+  void put(uint8_t tag, const void* v, size_t n) {
+    if (full || p + 1 + n > end) {
+      full = true;
+      return;
+    }
+    *p++ = tag;
+    memcpy(p, v, n);
+    p += n;
+  }
+
+  // Cut to what is left of the record if need be; later arguments are then left out
+  void str(const char* s) {
+    if (full || p + 2 > end) {
+      full = true;
+      return;
+    }
+    if (!s) s = "(null)";
+    size_t room = end - p - 2;
+    if (room > LOG_MAX_STR) room = LOG_MAX_STR;
+    uint8_t* len = p + 1;
+    *p = LOG_ARG_STR;
+    p += 2;
+    size_t n = 0;
+    while (n < room && s[n]) *p++ = (uint8_t)s[n++];
+    if (s[n] && n < LOG_MAX_STR) full = true;   // Out of record space, not just a long string
+    *len = (uint8_t)n;
+  }
+};
+
+inline void logPut(LogArgWriter& w, const char* s) { w.str(s); }
+inline void logPut(LogArgWriter& w, char* s) { w.str(s); }
+inline void logPut(LogArgWriter& w, float v) { w.put(LOG_ARG_FLOAT | 4, &v, 4); }
+inline void logPut(LogArgWriter& w, double v) { w.put(LOG_ARG_FLOAT | 8, &v, 8); }
+inline void logPut(LogArgWriter& w, const void* v) {
+  uintptr_t u = (uintptr_t)v;
+  w.put(LOG_ARG_UINT | sizeof(u), &u, sizeof(u));
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value>::type logPut(LogArgWriter& w, T v) {
+  w.put((std::is_signed<T>::value ? LOG_ARG_INT : LOG_ARG_UINT) | sizeof(T), &v, sizeof(T));
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value>::type logPut(LogArgWriter& w, T v) {
+  logPut(w, (typename std::underlying_type<T>::type)v);
+}
+
+inline void logPutAll(LogArgWriter&) {}
+
+template <typename T, typename... Rest>
+inline void logPutAll(LogArgWriter& w, T v, Rest... rest) {
+  logPut(w, v);
+  logPutAll(w, rest...);
+}
+
+// Fill rec (at most cap bytes) with one record. Returns its length.
+template <typename... Args>
+inline size_t logEncode(uint8_t* rec, size_t cap, uint8_t level, uint32_t t_us, const char* fmt, Args... args) {
+  memcpy(rec, &fmt, sizeof(fmt));
+  memcpy(rec + sizeof(fmt), &t_us, 4);
+  rec[sizeof(fmt) + 4] = level;
+  LogArgWriter w(rec + LOG_RECORD_HEADER, cap - LOG_RECORD_HEADER);
+  logPutAll(w, args...);
+  return w.p - rec;
+}
+
+struct LogRecordView {
+  const char* fmt;
+  uint32_t t_us;
+  uint8_t level;
+  const uint8_t* args;
+  size_t argLen;
+};
+
+inline bool logParseRecord(const uint8_t* rec, size_t len, LogRecordView& r) {
+  if (len < LOG_RECORD_HEADER) return false;
+  memcpy(&r.fmt, rec, sizeof(r.fmt));
+  memcpy(&r.t_us, rec + sizeof(r.fmt), 4);
+  r.level = rec[sizeof(r.fmt) + 4];
+  r.args = rec + LOG_RECORD_HEADER;
+  r.argLen = len - LOG_RECORD_HEADER;
+  return true;
+}
+
+// One decoded argument. Integers are sign- or zero-extended into u.
+struct LogArg {
+  uint8_t kind;
+  uint8_t size;
+  uint64_t u;
+  double d;
+  const char* s;
+};
+
+struct LogArgReader {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  LogArgReader(const uint8_t* args, size_t len) : p(args), end(args + len) {}
+
+  bool next(LogArg& a) {
+    if (p >= end) return false;
+    a.kind = *p & 0xF0;
+    a.size = *p & 0x0F;
+    p++;
+    if (a.kind == LOG_ARG_STR) {
+      if (p >= end || p + 1 + *p > end) return false;
+      a.size = *p++;
+      a.s = (const char*)p;
+      p += a.size;
+      return true;
+    }
+    if (a.size == 0 || a.size > 8 || p + a.size > end) return false;
+    if (a.kind == LOG_ARG_FLOAT) {
+      if (a.size == 4) {
+        float f;
+        memcpy(&f, p, 4);
+        a.d = f;
+      } else {
+        memcpy(&a.d, p, 8);
+      }
+      a.u = (uint64_t)(int64_t)a.d;
+    } else {
+      a.u = 0;
+      memcpy(&a.u, p, a.size);   // Little endian on the ESP32 and the host
+      if (a.kind == LOG_ARG_INT && a.size < 8 && (a.u >> (a.size * 8 - 1)) & 1) {
+        a.u |= ~0ULL << (a.size * 8);
+      }
+      a.d = a.kind == LOG_ARG_INT ? (double)(int64_t)a.u : (double)a.u;
+    }
+    p += a.size;
+    return true;
+  }
+};
+
+template <typename T>
+inline int logSnprintf(char* out, size_t room, const char* spec, int stars, const int* star, T v) {
+  if (stars == 0) return snprintf(out, room, spec, v);
+  if (stars == 1) return snprintf(out, room, spec, star[0], v);
+  return snprintf(out, room, spec, star[0], star[1], v);
+}
+
+// printf with the arguments of a record. Length modifiers in fmt are ignored, the stored
+// argument decides (ints print as the 32-bit value printf would have seen, unless they are
+// 64-bit). Missing or mismatched arguments print as "?". Returns the length, out is always
+// terminated.
+inline size_t logFormatArgs(char* out, size_t cap, const char* fmt, const uint8_t* args, size_t argLen) {
+  if (cap == 0) return 0;
+  LogArgReader r(args, argLen);
+  size_t n = 0;
+  const char* f = fmt;
+  while (*f && n + 1 < cap) {
+    if (*f != '%') {
+      out[n++] = *f++;
+      continue;
+    }
+    if (f[1] == '%') {
+      out[n++] = '%';
+      f += 2;
+      continue;
+    }
+    // Flags, width and precision are kept; '*' takes an int argument
+    char spec[24];
+    size_t sl = 0;
+    spec[sl++] = *f++;
+    int star[2] = {0, 0};
+    int stars = 0;
+    while (*f && strchr("-+ #0123456789.*", *f)) {
+      if (*f == '*') {
+        LogArg a;
+        int v = r.next(a) ? (int)(int64_t)a.u : 0;
+        if (stars < 2) star[stars++] = v;
+      }
+      if (sl < sizeof(spec) - 4) spec[sl++] = *f;
+      f++;
+    }
+    while (*f && strchr("hlLqjzt", *f)) f++;
+    char conv = *f;
+    if (!conv) break;
+    f++;
+
+    char* dst = out + n;
+    size_t room = cap - n;
+    int w;
+    LogArg a;
+    if (!r.next(a)) {
+      w = snprintf(dst, room, "?");
+    } else if (strchr("di", conv) && a.kind != LOG_ARG_STR) {
+      memcpy(spec + sl, "lld", 4);
+      long long v = a.size == 8 ? (long long)a.u : (long long)(int32_t)(uint32_t)a.u;
+      w = logSnprintf(dst, room, spec, stars, star, v);
+    } else if (strchr("uxXo", conv) && a.kind != LOG_ARG_STR) {
+      spec[sl] = 'l';
+      spec[sl + 1] = 'l';
+      spec[sl + 2] = conv;
+      spec[sl + 3] = '\0';
+      unsigned long long v = a.size == 8 ? a.u : (uint32_t)a.u;
+      w = logSnprintf(dst, room, spec, stars, star, v);
+    } else if (conv == 'c' && a.kind != LOG_ARG_STR) {
+      memcpy(spec + sl, "c", 2);
+      w = logSnprintf(dst, room, spec, stars, star, (int)a.u);
+    } else if (strchr("fFeEgGaA", conv) && a.kind != LOG_ARG_STR) {
+      spec[sl] = conv;
+      spec[sl + 1] = '\0';
+      w = logSnprintf(dst, room, spec, stars, star, a.d);
+    } else if (conv == 's' && a.kind == LOG_ARG_STR) {
+      char s[LOG_MAX_STR + 1];
+      memcpy(s, a.s, a.size);
+      s[a.size] = '\0';
+      memcpy(spec + sl, "s", 2);
+      w = logSnprintf(dst, room, spec, stars, star, (const char*)s);
+    } else if (conv == 'p' && a.kind != LOG_ARG_STR) {
+      w = snprintf(dst, room, "0x%llx", (unsigned long long)a.u);
+    } else {
+      w = snprintf(dst, room, "?");
+    }
+    if (w > 0) n += (size_t)w < room ? (size_t)w : room - 1;
+  }
+  out[n] = '\0';
+  return n;
+}
+
+// Multi-producer / single-consumer ring of variable-size records, lock-free on the producer
+// side: any task or callback may write, one task drains. A record is a 32-bit header word
+// (length, commit bit) and the record bytes, padded to 4. Writers reserve space with a CAS on
+// head, copy, then set the commit bit; the reader stops at the first uncommitted record and
+// zeroes what it consumed, so free space always reads as "not committed".
+template <uint32_t N>
+class LogRing {
+  static_assert(N >= 256 && (N & (N - 1)) == 0, "LogRing size must be a power of two, at least 256");
+
+public:
+  LogRing() : head(0), tail(0), drops(0) { memset(words, 0, sizeof(words)); }
+
+  // Any task. Returns false (and counts a drop) when the ring is full.
+  bool write(const uint8_t* rec, uint32_t len) {
+    if (len == 0 || len > LOG_MAX_RECORD) return false;
+    uint32_t size = 4 + ((len + 3) & ~3u);
+    uint32_t h = head.load(std::memory_order_relaxed);
+    do {
+      if (h + size - tail.load(std::memory_order_acquire) > N) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    } while (!head.compare_exchange_weak(h, h + size, std::memory_order_relaxed));
+
+    copyIn(h + 4, rec, len);
+    __atomic_store_n(&words[(h & (N - 1)) >> 2], len | COMMIT, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  // Single consumer: fn(const uint8_t* rec, uint32_t len) for every committed record, in order.
+  template <typename F>
+  uint32_t drain(F fn) {
+    uint8_t rec[LOG_MAX_RECORD];
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t count = 0;
+    for (;;) {
+      uint32_t w = __atomic_load_n(&words[(t & (N - 1)) >> 2], __ATOMIC_ACQUIRE);
+      if (!(w & COMMIT)) break;
+      uint32_t len = w & 0xFFFF;
+      uint32_t size = 4 + ((len + 3) & ~3u);
+      copyOut(t + 4, rec, len);
+      for (uint32_t i = 0; i < size; i += 4) {
+        __atomic_store_n(&words[((t + i) & (N - 1)) >> 2], 0u, __ATOMIC_RELAXED);
+      }
+      t += size;
+      tail.store(t, std::memory_order_release);
+      fn((const uint8_t*)rec, len);
+      count++;
+    }
+    return count;
+  }
+
+  uint32_t used() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  uint32_t capacity() const { return N; }
+  uint32_t dropCount() const { return drops.load(std::memory_order_relaxed); }
+
+private:
+  static const uint32_t COMMIT = 0x80000000u;
+
+  void copyIn(uint32_t pos, const uint8_t* src, uint32_t len) {
+    uint8_t* bytes = (uint8_t*)words;
+    uint32_t off = pos & (N - 1);
+    uint32_t first = len < N - off ? len : N - off;
+    memcpy(bytes + off, src, first);
+    memcpy(bytes, src + first, len - first);
+  }
+
+  void copyOut(uint32_t pos, uint8_t* dst, uint32_t len) {
+    const uint8_t* bytes = (const uint8_t*)words;
+    uint32_t off = pos & (N - 1);
+    uint32_t first = len < N - off ? len : N - off;
+    memcpy(dst, bytes + off, first);
+    memcpy(dst + first, bytes, len - first);
+  }
+
+  uint32_t words[N / 4];
+  std::atomic<uint32_t> head;    // Reserved up to here (producers)
+  std::atomic<uint32_t> tail;    // Consumed up to here (consumer)
+  std::atomic<uint32_t> drops;   // Records lost because the ring was full
+};
+
+// Binary log output (LOG_BINARY): frames between plain text (boot ROM output, panics, direct
+// Serial prints), so a decoder can pick them out of a raw serial capture:
+//   LOG_FRAME_SYNC, type, payload length, payload, CRC-8 of type, length and payload
+// Types:
+//   'F'  u16 format id, format string         (sent the first time an id is used, and again
+//                                              every LOG_FMT_RESEND_MS for late listeners)
+//   'L'  u16 format id, u32 t_us, u8 level, arguments as in the record
+//   'D'  u32 records dropped so far (ring full)
+#define LOG_FRAME_SYNC 0x1E
+#define LOG_FRAME_FORMAT 'F'
+#define LOG_FRAME_RECORD 'L'
+#define LOG_FRAME_DROPS  'D'
+#define LOG_FRAME_MAX_PAYLOAD 255
+
+inline uint8_t logCrc8(const uint8_t* p, size_t n, uint8_t crc = 0) {
+  while (n--) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; ++i) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+// out needs len + 4 bytes. Returns the frame length.
+inline size_t logFrame(uint8_t* out, uint8_t type, const uint8_t* payload, uint8_t len) {
+  out[0] = LOG_FRAME_SYNC;
+  out[1] = type;
+  out[2] = len;
+  memcpy(out + 3, payload, len);
+  out[3 + len] = logCrc8(out + 1, 2 + (size_t)len);
+  return 4 + (size_t)len;
+}
+
+inline char logLevelChar(uint8_t level) {
+  return level <= LOG_LEVEL_DEBUG ? "-EWID"[level] : '?';
+}
@@ -0,0 +1,138 @@
+#include <Arduino.h>
+#pragma once
+#include <WiFi.h>
+#include <esp_http_server.h>
+
+#include "config.h"
+#include "gateway_metrics.h"
+
+// GET /metrics on METRICS_PORT: gateway health in the Prometheus text format, so the fleet can be
+// scraped (Prometheus, or just curl) without a serial cable. Runs in the ESP-IDF HTTP server's
+// own task; include after espnow_comm.h (stations, uplink queue, backlog and WAL).
+//
+// The handler reads state other tasks write without locking: the counters are atomics, the rest
+// are single words, so a scrape may mix values from a few microseconds apart but never blocks
+// the radio or the uplink task.
+
+httpd_handle_t metricsServer = NULL;
+
+void metricsSink(void* ctx, const char* data, size_t len) {
+  httpd_resp_send_chunk((httpd_req_t*)ctx, data, len);
+}
+
+void writeMetrics(PromWriter& w) {
+  const GatewayMetrics& m = gatewayMetrics;
+  w.family("gateway_espnow_frames_total", "counter", "ESP-NOW frames received, any type");
+  w.line("gateway_espnow_frames_total %u\n", metricGet(m.frames));
+  w.family("gateway_espnow_invalid_frames_total", "counter", "Frames whose length, type or version matches no known message");
+  w.line("gateway_espnow_invalid_frames_total %u\n", metricGet(m.invalidFrames));
+  w.family("gateway_espnow_registry_full_total", "counter", "Frames from new stations dropped because NUM_STATIONS are registered");
+  w.line("gateway_espnow_registry_full_total %u\n", metricGet(m.registryFull));
+  w.family("gateway_readings_total", "counter", "Readings accepted and queued for upload");
+  w.line("gateway_readings_total %u\n", metricGet(m.readings));
+  w.family("gateway_duplicate_readings_total", "counter", "Readings dropped as duplicate or stale");
+  w.line("gateway_duplicate_readings_total %u\n", metricGet(m.duplicates));
+
+  w.family("gateway_stations_registered", "gauge", "Stations in the registry");
+  w.line("gateway_stations_registered %u\n", stations.size());
+  w.family("gateway_stations_capacity", "gauge", "Registry size (NUM_STATIONS)");
+  w.line("gateway_stations_capacity %u\n", stations.capacity());
+
+  // Per station. The count is read once (acquire, station_registry.h); entries below it are complete.
+  uint16_t n = stations.size();
+  uint32_t now = millis();
+  w.family("gateway_station_last_seen_seconds", "gauge", "Seconds since the last frame from the station");
+  for (uint16_t i = 0; i < n; ++i) {
+    w.line("gateway_station_last_seen_seconds{mac=\"" MAC_FMT "\"} %.1f\n", MAC_ARGS(stations[i].mac),
+           (now - stations[i].lastSeenMs) / 1000.0);
+  }
+  w.family("gateway_station_rssi_dbm", "gauge", "Smoothed RSSI of the station's frames");
+  for (uint16_t i = 0; i < n; ++i) {
+    w.line("gateway_station_rssi_dbm{mac=\"" MAC_FMT "\"} %d\n", MAC_ARGS(stations[i].mac), stations[i].rssi);
+  }
+  w.family("gateway_station_readings_received_total", "counter", "Numbered readings received from the station");
+  for (uint16_t i = 0; i < n; ++i) {
+    w.line("gateway_station_readings_received_total{mac=\"" MAC_FMT "\"} %u\n", MAC_ARGS(stations[i].mac),
+           stations[i].link.received);
+  }
+  w.family("gateway_station_readings_lost_total", "counter", "Readings missing from the station's sequence");
+  for (uint16_t i = 0; i < n; ++i) {
+    w.line("gateway_station_readings_lost_total{mac=\"" MAC_FMT "\"} %u\n", MAC_ARGS(stations[i].mac),
+           stations[i].link.lost);
+  }
+
+  w.family("gateway_uplink_requests_total", "counter", "Upload POSTs by result (ok: 2xx, rejected: 4xx, failed: other or no response)");
+  for (uint8_t r = 0; r < UPLINK_RESULTS; ++r) {
+    w.line("gateway_uplink_requests_total{result=\"%s\"} %u\n", uplinkResultName(r), metricGet(m.posts[r]));
+  }
+  w.family("gateway_uplink_readings_total", "counter", "Readings in upload POSTs, by the POST's result");
+  for (uint8_t r = 0; r < UPLINK_RESULTS; ++r) {
+    w.line("gateway_uplink_readings_total{result=\"%s\"} %u\n", uplinkResultName(r), metricGet(m.uploaded[r]));
+  }
+  w.histogram("gateway_uplink_request_duration_seconds", "Time per upload POST, connection setup included",
+              m.postLatency);
+  w.family("gateway_uplink_connections_total", "counter", "TCP connections opened to the ingest endpoint");
+  w.line("gateway_uplink_connections_total %u\n", uplinkClient.connects);
+
+  w.family("gateway_uplink_queue_depth", "gauge", "Readings waiting between the ESP-NOW callback and the uplink task");
+  w.line("gateway_uplink_queue_depth %u\n", uplinkQueue.depth());
+  w.family("gateway_uplink_queue_capacity", "gauge", "Uplink queue size (UPLINK_QUEUE_LEN)");
+  w.line("gateway_uplink_queue_capacity %u\n", uplinkQueue.capacity());
+  w.family("gateway_uplink_queue_high_water", "gauge", "Deepest the uplink queue has been");
+  w.line("gateway_uplink_queue_high_water %u\n", uplinkQueue.highWaterMark());
+  w.family("gateway_uplink_queue_drops_total", "counter", "Readings dropped because the uplink queue was full");
+  w.line("gateway_uplink_queue_drops_total %u\n", uplinkQueue.dropCount());
+  w.family("gateway_backlog_readings", "gauge", "Readings in the store-and-forward backlog");
+  w.line("gateway_backlog_readings %u\n", uplinkBacklog.size());
+  w.family("gateway_backlog_overwritten_total", "counter", "Backlog readings overwritten by newer ones (backlog full)");
+  w.line("gateway_backlog_overwritten_total %u\n", uplinkBacklog.overwritten);
+  w.family("gateway_backlog_replayed_total", "counter", "Backlog readings uploaded on replay");
+  w.line("gateway_backlog_replayed_total %u\n", uplinkBacklog.replayed);
+  w.family("gateway_backlog_rejected_total", "counter", "Backlog readings the server refused on replay (4xx), dropped");
+  w.line("gateway_backlog_rejected_total %u\n", uplinkBacklog.rejected);
+  if (walReady) {
+    w.family("gateway_wal_pending_readings", "gauge", "Readings in the write-ahead log that are not uploaded yet");
+    w.line("gateway_wal_pending_readings %u\n", uplinkWal.pending());
+  }
+
+  w.family("gateway_heap_free_bytes", "gauge", "Free internal heap");
+  w.line("gateway_heap_free_bytes %u\n", ESP.getFreeHeap());
+  w.family("gateway_heap_min_free_bytes", "gauge", "Lowest free internal heap since boot");
+  w.line("gateway_heap_min_free_bytes %u\n", ESP.getMinFreeHeap());
+  w.family("gateway_heap_largest_free_block_bytes", "gauge", "Largest allocatable internal heap block");
+  w.line("gateway_heap_largest_free_block_bytes %u\n", ESP.getMaxAllocHeap());
+  w.family("gateway_psram_free_bytes", "gauge", "Free PSRAM");
+  w.line("gateway_psram_free_bytes %u\n", ESP.getFreePsram());
+  w.family("gateway_psram_largest_free_block_bytes", "gauge", "Largest allocatable PSRAM block");
+  w.line("gateway_psram_largest_free_block_bytes %u\n", ESP.getMaxAllocPsram());
+  w.family("gateway_uptime_seconds", "gauge", "Time since boot (wraps after ~49 days)");
+  w.line("gateway_uptime_seconds %.1f\n", now / 1000.0);
+}
+
+static esp_err_t metricsHandler(httpd_req_t* req) {
+  httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+  PromWriter w(metricsSink, req);
+  writeMetrics(w);
+  w.flush();
+  httpd_resp_send_chunk(req, NULL, 0);
+  return ESP_OK;
+}
+
+static const httpd_uri_t metricsUri = { "/metrics", HTTP_GET, metricsHandler, NULL };
+
+// Start the HTTP server (once Wi-Fi is up). Returns false if METRICS_PORT is 0 or it fails to start.
+bool startMetricsServer() {
+  if (METRICS_PORT == 0 || metricsServer) return metricsServer != NULL;
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = METRICS_PORT;
+  config.stack_size = METRICS_TASK_STACK;
+  config.task_priority = METRICS_TASK_PRIORITY;
+  if (httpd_start(&metricsServer, &config) != ESP_OK) {
+    LOG_E("✗ Could not start the metrics server on port %u\n", (unsigned)METRICS_PORT);
+    metricsServer = NULL;
+    return false;
+  }
+  httpd_register_uri_handler(metricsServer, &metricsUri);
+  LOG_PRINTF("Metrics: http://%s:%u/metrics\n", WiFi.localIP().toString().c_str(), (unsigned)METRICS_PORT);
+  return true;
+}
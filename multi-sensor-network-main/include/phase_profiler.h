@@ -0,0 +1,137 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#include "espnow_proto.h"   // diag_msg, DIAG_BUCKETS
+
+// Awake-time profile of a battery station, per phase of a wake. Plain C++ with no Arduino
+// dependencies; the caller passes durations in microseconds.
+//
+// The station keeps a PhaseProfile in RTC memory (it must stay a plain struct: RTC_DATA_ATTR
+// variables are zeroed on power-on, not constructed), adds every timed phase to it, and sends
+// it to the gateway in a diagnostics frame every DIAG_INTERVAL_S; then it starts over. Per phase
+// it keeps count, total, max and a log2 histogram, so a rare slow send shows up next to the mean.
+
+enum Phase {
+  PHASE_BOOT,           // Reset to setup() (startup code; the ROM bootloader runs before the clock starts)
+  PHASE_SENSOR_INIT,    // I2C bus and SCD41 driver
+  PHASE_MEASURE_START,  // Measurement command
+  PHASE_READ,           // Data-ready poll and read
+  PHASE_RADIO_INIT,     // Wi-Fi + ESP-NOW start
+  PHASE_CHANNEL_SCAN,   // Tuning to the gateway channel (a full scan on cold boots)
+  PHASE_SEND,           // esp_now_send until the send callback, retries and backoff included
+  PHASE_ACK_WAIT,       // Waiting for the gateway's ACK to a broadcast frame
+  PHASE_COUNT
+};
+
+static_assert(PHASE_COUNT <= DIAG_MAX_PHASES, "More phases than a diagnostics frame carries");
+
+inline const char* phaseName(uint8_t phase) {
+  static const char* const names[PHASE_COUNT] = {
+    "boot", "sensor init", "measure start", "read", "radio init", "channel", "send", "ack wait"
+  };
+  return phase < PHASE_COUNT ? names[phase] : "?";
+}
+
+// Typical ESP32 supply current per phase (mA), for the gateway's charge estimate: CPU only
+// ~40 mA, radio receiving ~100 mA, sending a bit more (TX bursts are high but short). Rough
+// figures, not measured on our boards.
+#define PHASE_OTHER_CURRENT_MA 40   // Awake time outside the timed phases (logging, state logic)
+inline float phaseCurrentMa(uint8_t phase) {
+  static const float ma[PHASE_COUNT] = { 40, 40, 40, 40, 100, 100, 120, 100 };
+  return phase < PHASE_COUNT ? ma[phase] : PHASE_OTHER_CURRENT_MA;
+}
+
+// Histogram bucket of a duration (see diag_msg)
+inline uint8_t phaseBucket(uint32_t us) {
+  uint8_t b = 0;
+  while (b < DIAG_BUCKETS - 1 && us >= ((uint32_t)DIAG_BUCKET0_US << b)) b++;
+  return b;
+}
+
+struct PhaseStats {
+  uint32_t count;
+  uint64_t total_us;
+  uint32_t max_us;
+  uint16_t hist[DIAG_BUCKETS];
+
+  void add(uint32_t us) {
+    count++;
+    total_us += us;
+    if (us > max_us) max_us = us;
+    uint16_t& h = hist[phaseBucket(us)];
+    if (h != 0xFFFF) h++;
+  }
+};
+
+struct PhaseProfile {
+  PhaseStats phases[PHASE_COUNT];
+  uint32_t wakes;
+  uint64_t awake_us;
+  uint32_t start_s;     // Station clock when this profile was started
+
+  void add(uint8_t phase, uint32_t us) {
+    if (phase < PHASE_COUNT) phases[phase].add(us);
+  }
+
+  // One whole wake, from setup() to the sleep call
+  void addWake(uint32_t us) {
+    wakes++;
+    awake_us += us;
+  }
+
+  void reset(uint32_t now_s) {
+    memset(this, 0, sizeof(*this));
+    start_s = now_s;
+  }
+
+  // Diagnostics frame contents; phases that did not run in the window are left out
+  void toDiag(diag_msg& m, uint16_t boot, uint32_t now_s) const {
+    m.boot = boot;
+    m.uptime_s = now_s;
+    m.window_s = now_s - start_s;
+    m.wakes = wakes > 0xFFFF ? 0xFFFF : wakes;
+    m.awake_ms = (uint32_t)(awake_us / 1000);
+    m.count = 0;
+    for (uint8_t p = 0; p < PHASE_COUNT; ++p) {
+      const PhaseStats& s = phases[p];
+      if (!s.count) continue;
+      diag_phase& d = m.phases[m.count++];
+      d.phase = p;
+      d.count = s.count > 0xFFFF ? 0xFFFF : s.count;
+      d.mean_us = (uint32_t)(s.total_us / s.count);
+      d.max_us = s.max_us;
+      for (uint8_t b = 0; b < DIAG_BUCKETS; ++b) {
+        d.hist[b] = s.hist[b] > 0xFF ? 0xFF : s.hist[b];
+      }
+    }
+  }
+};
+
+// Upper bound of the histogram bucket holding quantile q of a phase's durations (the last bucket
+// has no bound: max_us then)
+inline uint32_t diagQuantileUs(const diag_phase& d, float q) {
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < DIAG_BUCKETS; ++b) total += d.hist[b];
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < DIAG_BUCKETS - 1; ++b) {
+    seen += d.hist[b];
+    if (seen >= q * total) return (uint32_t)DIAG_BUCKET0_US << b;
+  }
+  return d.max_us;
+}
+
+// Estimated charge the ESP32 spends awake per day (mAh), from a diagnostics frame: each phase at
+// its typical current, the rest of the awake time at PHASE_OTHER_CURRENT_MA. Sleep current and the
+// sensor's own supply are not included.
+inline float diagAwakeMahPerDay(const diag_msg& m) {
+  if (!m.window_s) return 0;
+  float phaseMs = 0, uAh = 0;   // mA * us / 3600 = nAh; / 1000 = uAh
+  for (uint8_t i = 0; i < m.count; ++i) {
+    float totalUs = (float)m.phases[i].mean_us * m.phases[i].count;
+    phaseMs += totalUs / 1000.0f;
+    uAh += phaseCurrentMa(m.phases[i].phase) * totalUs / 3600.0f / 1000.0f;
+  }
+  if (m.awake_ms > phaseMs) uAh += PHASE_OTHER_CURRENT_MA * (m.awake_ms - phaseMs) / 3600.0f;
+  return uAh / 1000.0f * 86400.0f / m.window_s;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "station_registry.h"
+#include "uplink_binary.h"  // CO2_NONE
+
+// Per-station tumbling-window aggregation: count, min, max, mean and last of temperature,
+// humidity and CO2 over fixed windows of `windowSeconds` (aligned to the clock, so windows of
+// different stations line up). Constant memory per station, no sample buffers.
+// Readings without CO2 (CO2_NONE) count for temperature and humidity only.
+// Plain C++ with no Arduino dependencies.
+
+struct AggregateMetric {
+  float min, max, mean, last;
+
+  void reset(float v) {
+    min = max = mean = last = v;
+  }
+
+  void add(float v, uint16_t count) {   // count: samples including this one
+    if (v < min) min = v;
+    if (v > max) max = v;
+    mean += (v - mean) / count;
+    last = v;
+  }
+};
+
+// One closed window of one station
+struct AggregateSummary {
+  uint8_t mac[6];
+  uint32_t start;      // Window start (seconds, same clock as the readings)
+  uint32_t length;     // Window length in seconds
+  uint16_t count;      // Readings in the window
+  uint16_t co2Count;   // Readings with CO2; co2 is undefined if 0
+  int16_t rssi;        // Mean RSSI
+  AggregateMetric temperature, humidity, co2;
+};
+
+template <uint16_t MAX_STATIONS>
+class ReadingAggregator {
+  struct Window {
+    uint8_t mac[6];
+    uint32_t index;        // Window number (start / length)
+    uint16_t count;        // 0: no open window
+    uint16_t co2Count;
+    float rssi;
+    AggregateMetric temperature, humidity, co2;
+    Window() : index(0), count(0), co2Count(0), rssi(0) { memset(mac, 0, 6); }
+    Window(const uint8_t* m) : index(0), count(0), co2Count(0), rssi(0) { memcpy(mac, m, 6); }
+  };
+
+public:
+  explicit ReadingAggregator(uint32_t windowSeconds) : windows(0), length(windowSeconds ? windowSeconds : 1) {}
+
+  // Add a reading taken at time t (seconds). If it belongs to a later window than the station's
+  // open one, the open window is closed into `closed` first and true is returned.
+  bool add(const uint8_t mac[6], uint32_t t, float temperature, float humidity, uint16_t co2,
+           int16_t rssi, AggregateSummary& closed) {
+    Window* w = stations.findOrInsert(mac);
+    if (!w) return false;
+    uint32_t index = t / length;
+    bool emitted = false;
+    if (w->count && index != w->index) {
+      summarize(*w, closed);
+      emitted = true;
+    }
+    if (w->count == 0) {
+      w->index = index;
+      w->count = 1;
+      w->rssi = rssi;
+      w->co2Count = 0;
+      w->temperature.reset(temperature);
+      w->humidity.reset(humidity);
+    } else if (w->count < 0xFFFF) {
+      w->count++;
+      w->rssi += (rssi - w->rssi) / w->count;
+      w->temperature.add(temperature, w->count);
+      w->humidity.add(humidity, w->count);
+    } else {
+      return emitted;
+    }
+    if (co2 != CO2_NONE) {
+      if (w->co2Count++ == 0) w->co2.reset(co2);
+      else w->co2.add(co2, w->co2Count);
+    }
+    return emitted;
+  }
+
+  // Close the windows of stations that went quiet: every open window that ended at least
+  // `graceS` seconds before `now`. Calls fn(const AggregateSummary&) for each.
+  template <typename F>
+  void flushEnded(uint32_t now, uint32_t graceS, F fn) {
+    for (uint16_t i = 0; i < stations.size(); ++i) {
+      Window& w = stations[i];
+      if (w.count && (uint64_t)(w.index + 1) * length + graceS <= now) {
+        AggregateSummary s;
+        summarize(w, s);
+        fn(s);
+      }
+    }
+  }
+
+  uint32_t windowLength() const { return length; }
+  uint32_t windows;   // Windows closed so far
+
+private:
+  void summarize(Window& w, AggregateSummary& s) {
+    memcpy(s.mac, w.mac, 6);
+    s.start = w.index * length;
+    s.length = length;
+    s.count = w.count;
+    s.co2Count = w.co2Count;
+    s.rssi = (int16_t)(w.rssi < 0 ? w.rssi - 0.5f : w.rssi + 0.5f);
+    s.temperature = w.temperature;
+    s.humidity = w.humidity;
+    s.co2 = w.co2;
+    w.count = 0;
+    windows++;
+  }
+
+  StationRegistry<Window, MAX_STATIONS> stations;
+  uint32_t length;
+};
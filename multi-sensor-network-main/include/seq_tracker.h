@@ -0,0 +1,103 @@
+#pragma once
+#include <stdint.h>
+
+// Per-station sequence tracking on the gateway: duplicate suppression and loss accounting.
+// Plain C++ with no Arduino dependencies.
+//
+// Stations number their messages (sensor_msg.seq) and bump a boot counter on every power-on
+// (sensor_msg.boot), since the sequence counter lives in RTC memory and restarts from 0 then.
+// The tracker keeps the highest sequence number seen in the current boot and a bitmap of the
+// SEQ_WINDOW numbers below it, like an IPsec anti-replay window:
+//   - above the highest: new; the numbers skipped over count as lost (for now)
+//   - inside the window, bit clear: arrived late (reordered); no longer lost
+//   - inside the window, bit set: duplicate (retransmission, or heard through a second gateway)
+//   - below the window: too old to tell, dropped
+// A later boot counter, or a counter that starts over from 0, begins a new sequence (counted
+// as a restart, not as loss). Frames from an earlier boot (late retransmissions, or heard
+// through a second gateway after the station rebooted) are stale. Boot counters are compared
+// as serial numbers, so the 16-bit counter may wrap.
+
+#define SEQ_WINDOW 64
+
+enum SeqResult {
+  SEQ_NEW,        // In order (possibly after a gap)
+  SEQ_REORDERED,  // Late, but not seen before
+  SEQ_DUPLICATE,  // Seen before: drop
+  SEQ_STALE,      // Older than the window, or from an earlier boot: drop
+};
+
+class SeqTracker {
+public:
+  SeqTracker() : received(0), lost(0), duplicates(0), reordered(0), stale(0), restarts(0),
+                 started(false), boot(0), highest(0), window(0) {}
+
+  SeqResult accept(uint16_t msgBoot, uint32_t seq) {
+    if (started && (int16_t)(msgBoot - boot) < 0) {
+      stale++;
+      return SEQ_STALE;
+    }
+    if (!started || msgBoot != boot) {
+      if (started) restarts++;
+      started = true;
+      boot = msgBoot;
+      highest = seq;
+      window = 1;
+      received++;
+      return SEQ_NEW;
+    }
+    if (seq > highest) {
+      uint32_t d = seq - highest;
+      lost += d - 1;
+      window = d >= SEQ_WINDOW ? 0 : window << d;
+      window |= 1;
+      highest = seq;
+      received++;
+      return SEQ_NEW;
+    }
+    uint32_t d = highest - seq;
+    if (d >= SEQ_WINDOW && seq < SEQ_WINDOW) {
+      // Counter started over without a new boot number (boot counter could not be saved)
+      restarts++;
+      highest = seq;
+      window = 1;
+      received++;
+      return SEQ_NEW;
+    }
+    if (d >= SEQ_WINDOW) {
+      stale++;
+      return SEQ_STALE;
+    }
+    uint64_t bit = 1ULL << d;
+    if (window & bit) {
+      duplicates++;
+      return SEQ_DUPLICATE;
+    }
+    window |= bit;
+    if (lost) lost--;   // Was counted as lost when the gap opened
+    reordered++;
+    received++;
+    return SEQ_REORDERED;
+  }
+
+  // Share of messages that never arrived: lost / (received + lost)
+  float lossRate() const {
+    uint32_t expected = received + lost;
+    return expected ? (float)lost / expected : 0.0f;
+  }
+
+  uint16_t currentBoot() const { return boot; }
+  uint32_t highestSeq() const { return highest; }
+
+  uint32_t received;    // Distinct messages accepted
+  uint32_t lost;        // Sequence numbers skipped and not (yet) received
+  uint32_t duplicates;
+  uint32_t reordered;
+  uint32_t stale;
+  uint32_t restarts;    // Boot counter changes
+
+private:
+  bool started;
+  uint16_t boot;
+  uint32_t highest;
+  uint64_t window;      // Bit i: highest - i was received
+};
@@ -0,0 +1,207 @@
+#include <Arduino.h>
+#pragma once
+#include <atomic>
+
+#include "log_record.h"
+
+// Serial log that can be compiled out. Battery stations spend a large part of each wake on
+// Serial (waiting for the port, formatting, pushing bytes out at 115200 baud), so low-power
+// builds set -DSERIAL_LOG=0 and the calls below disappear, arguments included.
+#ifndef SERIAL_LOG
+#define SERIAL_LOG 1
+#endif
+
+// Levelled log, printf-style: LOG_E (errors), LOG_W, LOG_I, LOG_D (per-packet detail). Levels
+// above LOG_LEVEL generate no code at all. Override per env, e.g. -DLOG_LEVEL=LOG_LEVEL_DEBUG.
+#ifndef LOG_LEVEL
+  #if SERIAL_LOG
+    #define LOG_LEVEL LOG_LEVEL_INFO
+  #else
+    #define LOG_LEVEL LOG_LEVEL_NONE
+  #endif
+#endif
+
+// Deferred (default): LOG_E..LOG_D only copy the format pointer, a timestamp and the arguments
+// into a lock-free ring (log_record.h), a few microseconds; the low-priority log task formats
+// and prints them. So they are fine in the ESP-NOW callbacks, where Serial.printf at 115200 baud
+// blocks for milliseconds. LOG_DEFERRED=0 prints at the call site instead.
+#ifndef LOG_DEFERRED
+#define LOG_DEFERRED 1
+#endif
+
+// LOG_BINARY=1: the log task writes binary frames (a few bytes per line instead of ~50) instead
+// of text. Capture the raw serial output and format it with tools/log_decode.cpp.
+#ifndef LOG_BINARY
+#define LOG_BINARY 0
+#endif
+
+#ifndef LOG_RING_BYTES
+#define LOG_RING_BYTES 4096         // Ring size (power of two); records are ~20-80 bytes
+#endif
+#define LOG_TASK_STACK 4096
+#define LOG_TASK_PRIORITY 1         // Lowest above idle: logging never delays the radio or uploads
+#define LOG_DRAIN_INTERVAL_MS 20
+#define LOG_LINE_MAX 256            // Longest formatted line
+#define LOG_FMT_TABLE 256           // LOG_BINARY: format ids (slots of a pointer hash table)
+#define LOG_FMT_RESEND_MS 10000     // LOG_BINARY: send all format strings again this often
+
+#define LOG_USE_RING (SERIAL_LOG && LOG_DEFERRED && LOG_LEVEL > LOG_LEVEL_NONE)
+
+#if LOG_BINARY && !LOG_USE_RING
+#error "LOG_BINARY needs the deferred log (SERIAL_LOG=1, LOG_DEFERRED=1, LOG_LEVEL above NONE)"
+#endif
+
+// Never called: lets the compiler check log arguments against the format, and keeps variables
+// that are only logged "used" in builds where the call is compiled out
+static inline void logCheckFormat(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void logCheckFormat(const char* fmt, ...) { (void)fmt; }
+#define LOG_OFF(...) do { if (0) logCheckFormat(__VA_ARGS__); } while (0)
+
+#if LOG_USE_RING
+LogRing<LOG_RING_BYTES> logRing;
+std::atomic<bool> logDraining(false);   // One drainer at a time: the log task or a flush
+uint32_t logDropsReported = 0;
+
+#if LOG_BINARY
+const char* logFormats[LOG_FMT_TABLE];  // Format string per id, NULL = not sent yet
+uint32_t logFormatsSentMs = 0;
+
+void logSendFrame(uint8_t type, const uint8_t* payload, size_t len) {
+  uint8_t frame[LOG_FRAME_MAX_PAYLOAD + 4];
+  if (len > LOG_FRAME_MAX_PAYLOAD) len = LOG_FRAME_MAX_PAYLOAD;
+  Serial.write(frame, logFrame(frame, type, payload, (uint8_t)len));
+}
+
+// Id of a format string: its slot in logFormats, sending the string the first time
+uint16_t logFormatId(const char* fmt) {
+  if (millis() - logFormatsSentMs >= LOG_FMT_RESEND_MS) {
+    memset(logFormats, 0, sizeof(logFormats));
+    logFormatsSentMs = millis();
+  }
+  uint32_t h = (uint32_t)(uintptr_t)fmt;
+  h = (h ^ (h >> 7) ^ (h >> 15)) * 0x9E3779B1u;
+  uint16_t id = (uint16_t)(h >> 24) % LOG_FMT_TABLE;
+  for (uint16_t probes = 0; probes < LOG_FMT_TABLE; ++probes, id = (id + 1) % LOG_FMT_TABLE) {
+    if (logFormats[id] == fmt) return id;
+    if (logFormats[id] == NULL) break;
+  }
+  if (logFormats[id] != NULL) {
+    // Table full: start over, the strings are sent again as they come up
+    memset(logFormats, 0, sizeof(logFormats));
+  }
+  logFormats[id] = fmt;
+  uint8_t payload[LOG_FRAME_MAX_PAYLOAD];
+  size_t len = strnlen(fmt, LOG_FRAME_MAX_PAYLOAD - 2);
+  memcpy(payload, &id, 2);
+  memcpy(payload + 2, fmt, len);
+  logSendFrame(LOG_FRAME_FORMAT, payload, 2 + len);
+  return id;
+}
+#endif
+
+void logPrintRecord(const uint8_t* rec, uint32_t len) {
+  LogRecordView r;
+  if (!logParseRecord(rec, len, r)) return;
+#if LOG_BINARY
+  uint8_t payload[LOG_FRAME_MAX_PAYLOAD];
+  uint16_t id = logFormatId(r.fmt);
+  memcpy(payload, &id, 2);
+  memcpy(payload + 2, &r.t_us, 4);
+  payload[6] = r.level;
+  size_t n = r.argLen < LOG_FRAME_MAX_PAYLOAD - 7 ? r.argLen : LOG_FRAME_MAX_PAYLOAD - 7;
+  memcpy(payload + 7, r.args, n);
+  logSendFrame(LOG_FRAME_RECORD, payload, 7 + n);
+#else
+  char line[LOG_LINE_MAX];
+  size_t n = logFormatArgs(line, sizeof(line), r.fmt, r.args, r.argLen);
+  Serial.write((const uint8_t*)line, n);
+#endif
+}
+
+// Format and print everything in the ring. wait = false returns at once if another task is
+// draining; wait = true (flush, direct prints) waits for it so nothing is printed out of order.
+void logDrain(bool wait) {
+  while (logDraining.exchange(true, std::memory_order_acquire)) {
+    if (!wait) return;
+    delay(1);
+  }
+  logRing.drain(logPrintRecord);
+  uint32_t drops = logRing.dropCount();
+  if (drops != logDropsReported) {
+#if LOG_BINARY
+    logSendFrame(LOG_FRAME_DROPS, (const uint8_t*)&drops, 4);
+#else
+    Serial.printf("[log] %u lines dropped, log ring full\n", drops - logDropsReported);
+#endif
+    logDropsReported = drops;
+  }
+  logDraining.store(false, std::memory_order_release);
+}
+
+void logTask(void* arg) {
+  (void)arg;
+  for (;;) {
+    logDrain(false);
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+  }
+}
+
+void logBegin() {
+  static TaskHandle_t logTaskHandle = NULL;
+  if (logTaskHandle) return;
+  xTaskCreate(logTask, "log", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, &logTaskHandle);
+}
+
+template <typename... Args>
+void logWrite(uint8_t level, const char* fmt, Args... args) {
+  uint8_t rec[LOG_MAX_RECORD];
+  logRing.write(rec, logEncode(rec, sizeof(rec), level, (uint32_t)micros(), fmt, args...));
+}
+
+  #define LOG_AT(level, ...) do { if (0) logCheckFormat(__VA_ARGS__); logWrite(level, __VA_ARGS__); } while (0)
+  #define LOG_DRAIN()        logDrain(true)
+  #define LOG_BEGIN(baud)    do { Serial.begin(baud); logBegin(); } while (0)
+#elif SERIAL_LOG
+  #define LOG_AT(level, ...) Serial.printf(__VA_ARGS__)
+  #define LOG_DRAIN()        do {} while (0)
+  #define LOG_BEGIN(baud)    Serial.begin(baud)
+#else
+  #define LOG_AT(level, ...) LOG_OFF(__VA_ARGS__)
+  #define LOG_DRAIN()        do {} while (0)
+#endif
+
+// Direct, blocking output for setup code and bulk dumps, never from the radio callbacks
+// (in deferred builds they print what is still in the ring first, to keep the order)
+#if SERIAL_LOG
+  #define LOG_PRINT(...)    do { LOG_DRAIN(); Serial.print(__VA_ARGS__); } while (0)
+  #define LOG_PRINTLN(...)  do { LOG_DRAIN(); Serial.println(__VA_ARGS__); } while (0)
+  #define LOG_PRINTF(...)   do { LOG_DRAIN(); Serial.printf(__VA_ARGS__); } while (0)
+  #define LOG_FLUSH()       do { LOG_DRAIN(); Serial.flush(); } while (0)
+#else
+  #define LOG_BEGIN(baud)   do {} while (0)
+  #define LOG_PRINT(...)    do { if (0) Serial.print(__VA_ARGS__); } while (0)
+  #define LOG_PRINTLN(...)  do { if (0) Serial.println(__VA_ARGS__); } while (0)
+  #define LOG_PRINTF(...)   LOG_OFF(__VA_ARGS__)
+  #define LOG_FLUSH()       do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+  #define LOG_E(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+  #define LOG_E(...) LOG_OFF(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+  #define LOG_W(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+  #define LOG_W(...) LOG_OFF(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  #define LOG_I(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+  #define LOG_I(...) LOG_OFF(__VA_ARGS__)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  #define LOG_D(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+  #define LOG_D(...) LOG_OFF(__VA_ARGS__)
+#endif
@@ -0,0 +1,426 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "station_registry.h"
+#include "uplink_binary.h"  // CO2_NONE
+
+// Compressed per-station reading history, in one memory pool (PSRAM on the gateway).
+// Plain C++ with no Arduino dependencies.
+//
+// The pool is split into fixed-size blocks; each station owns a chain of blocks, oldest first.
+// Inside a block, samples are a bit stream in the style of Facebook's Gorilla TSDB:
+//   - first sample of a block: timestamp (32 bits), temperature and humidity (raw float bits),
+//     co2 (16 bits)
+//   - timestamp: delta-of-delta, '0' for "same interval as before", else a 2-4 bit prefix
+//     and a 7/9/12/32-bit signed value
+//   - temperature, humidity: XOR with the previous value; '0' if equal, else '1' plus either
+//     '0' and the meaningful bits in the previous leading/trailing-zero window, or '1', 5 bits
+//     leading zeros, 5 bits length-1 and the meaningful bits
+//   - co2: change against the previous CO2 value, zigzag + 1 as a varint (7 bits + continuation
+//     bit per group); 0 for a reading without CO2 (CO2_NONE), which leaves the previous value
+// At a steady interval with sensor noise this is about 5-6 bytes per reading instead of 14.
+//
+// Old blocks are dropped once their newest sample is older than the retention window; if the
+// pool runs out, the oldest block of any station is reused.
+
+#define HISTORY_BLOCK_HEADER_LEN 16
+#define HISTORY_NO_BLOCK 0xFFFFFFFF
+
+struct HistorySample {
+  uint32_t t;          // Seconds (unix time when the gateway clock is set)
+  float temperature;
+  float humidity;
+  uint16_t co2;        // CO2_NONE: not measured
+};
+
+// Bit stream writer / reader, most significant bit first
+class HistoryBitWriter {
+public:
+  HistoryBitWriter(uint8_t* buf, uint32_t capBits, uint32_t pos) : buf(buf), cap(capBits), pos(pos) {}
+  bool ok() const { return pos <= cap; }
+  uint32_t position() const { return pos; }
+
+  void put(uint32_t value, uint8_t bits) {
+    if (pos + bits > cap) {
+      pos = cap + 1;
+      return;
+    }
+    while (bits--) {
+      uint8_t mask = 0x80 >> (pos & 7);
+      if ((value >> bits) & 1) buf[pos >> 3] |= mask;
+      else buf[pos >> 3] &= ~mask;
+      pos++;
+    }
+  }
+
+  void putVarint(uint32_t v) {
+    while (v >= 0x80) {
+      put((v & 0x7F) | 0x80, 8);
+      v >>= 7;
+    }
+    put(v, 8);
+  }
+
+private:
+  uint8_t* buf;
+  uint32_t cap;
+  uint32_t pos;
+};
+
+class HistoryBitReader {
+public:
+  HistoryBitReader(const uint8_t* buf, uint32_t pos) : buf(buf), pos(pos) {}
+
+  uint32_t get(uint8_t bits) {
+    uint32_t v = 0;
+    while (bits--) {
+      v = (v << 1) | ((buf[pos >> 3] >> (7 - (pos & 7))) & 1);
+      pos++;
+    }
+    return v;
+  }
+
+  uint32_t getVarint() {
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+      uint32_t b = get(8);
+      v |= (b & 0x7F) << shift;
+      if (!(b & 0x80)) break;
+    }
+    return v;
+  }
+
+private:
+  const uint8_t* buf;
+  uint32_t pos;
+};
+
+// Previous-sample state, used both when appending and when decoding a block
+struct HistoryCodecState {
+  uint32_t t;
+  int32_t delta;
+  uint32_t tempBits, humBits;
+  uint8_t tempLead, tempTrail, humLead, humTrail;   // Last XOR window (lead 0xFF: none yet)
+  uint16_t co2;   // Last CO2 value (readings without one do not change it)
+};
+
+inline uint32_t historyFloatBits(float f) {
+  uint32_t b;
+  memcpy(&b, &f, 4);
+  return b;
+}
+
+inline float historyBitsFloat(uint32_t b) {
+  float f;
+  memcpy(&f, &b, 4);
+  return f;
+}
+
+inline uint8_t historyLeadingZeros(uint32_t v) {
+  uint8_t n = 0;
+  while (n < 32 && !(v & (0x80000000UL >> n))) n++;
+  return n;
+}
+
+inline uint8_t historyTrailingZeros(uint32_t v) {
+  uint8_t n = 0;
+  while (n < 32 && !(v & (1UL << n))) n++;
+  return n;
+}
+
+inline void historyPutXor(HistoryBitWriter& w, uint32_t value, uint32_t& prev, uint8_t& lead, uint8_t& trail) {
+  uint32_t x = value ^ prev;
+  prev = value;
+  if (x == 0) {
+    w.put(0, 1);
+    return;
+  }
+  uint8_t l = historyLeadingZeros(x);
+  uint8_t t = historyTrailingZeros(x);
+  if (l > 31) l = 31;
+  if (lead != 0xFF && l >= lead && t >= trail) {
+    w.put(2, 2);                              // '10': same window
+    w.put(x >> trail, 32 - lead - trail);
+    return;
+  }
+  uint8_t len = 32 - l - t;
+  w.put(3, 2);                                // '11': new window
+  w.put(l, 5);
+  w.put(len - 1, 5);
+  w.put(x >> t, len);
+  lead = l;
+  trail = t;
+}
+
+inline void historyGetXor(HistoryBitReader& r, uint32_t& prev, uint8_t& lead, uint8_t& trail) {
+  if (r.get(1) == 0) return;
+  if (r.get(1) == 1) {
+    lead = r.get(5);
+    uint8_t len = r.get(5) + 1;
+    trail = 32 - lead - len;
+  }
+  prev ^= r.get(32 - lead - trail) << trail;
+}
+
+template <uint16_t MAX_STATIONS, uint16_t BLOCK_BYTES>
+class StationHistory {
+  static_assert(BLOCK_BYTES > HISTORY_BLOCK_HEADER_LEN + 16, "History blocks are too small");
+
+  // Block header (little endian in the pool):
+  //   0 next block of the same station (u32), 4 first timestamp, 8 last timestamp,
+  //   12 sample count (u16), 14 bits used (u16)
+  struct Chain {
+    uint8_t mac[6];
+    uint32_t head, tail;        // Oldest / newest block
+    HistoryCodecState state;    // Last sample appended to the tail block
+    Chain() : head(HISTORY_NO_BLOCK), tail(HISTORY_NO_BLOCK) { memset(mac, 0, 6); }
+    Chain(const uint8_t* m) : head(HISTORY_NO_BLOCK), tail(HISTORY_NO_BLOCK) { memcpy(mac, m, 6); }
+  };
+
+public:
+  StationHistory() : samples(0), evicted(0), late(0), pool(NULL), blockCount(0), usedBlocks(0),
+                     freeList(HISTORY_NO_BLOCK), retentionS(0) {}
+
+  // Use `bytes` of memory at `mem` for the blocks; keep samples for `retentionSeconds`.
+  // Calling it again starts over with no stations and no samples.
+  void begin(uint8_t* mem, size_t bytes, uint32_t retentionSeconds) {
+    chains.clear();
+    samples = 0;
+    evicted = 0;
+    late = 0;
+    pool = mem;
+    blockCount = bytes / BLOCK_BYTES;
+    retentionS = retentionSeconds;
+    usedBlocks = 0;
+    freeList = HISTORY_NO_BLOCK;
+    for (uint32_t b = blockCount; b-- > 0;) {
+      setU32(block(b), freeList);
+      freeList = b;
+    }
+  }
+
+  uint32_t blocks() const { return blockCount; }
+  uint32_t blocksUsed() const { return usedBlocks; }
+  uint16_t stations() const { return chains.size(); }
+  size_t bytesUsed() const { return (size_t)usedBlocks * BLOCK_BYTES; }
+
+  // Add a reading. Timestamps must not go backwards for a station: a reading older than the
+  // station's last one is dropped and counted in `late`, so blocks stay in time order.
+  bool append(const uint8_t mac[6], const HistorySample& s) {
+    if (!pool) return false;
+    Chain* c = chains.findOrInsert(mac);
+    if (!c) return false;
+    if (c->tail != HISTORY_NO_BLOCK && s.t < c->state.t) {
+      late++;
+      return false;
+    }
+    dropExpired(*c, s.t);
+
+    if (c->tail != HISTORY_NO_BLOCK && appendTo(*c, s)) {
+      samples++;
+      return true;
+    }
+    // Start a new block with the sample stored raw
+    uint32_t b = allocBlock();
+    if (b == HISTORY_NO_BLOCK) return false;
+    uint8_t* p = block(b);
+    setU32(p, HISTORY_NO_BLOCK);
+    setU32(p + 4, s.t);
+    setU32(p + 8, s.t);
+    setU16(p + 12, 1);
+    HistoryBitWriter w(p + HISTORY_BLOCK_HEADER_LEN, dataBits(), 0);
+    w.put(s.t, 32);
+    w.put(historyFloatBits(s.temperature), 32);
+    w.put(historyFloatBits(s.humidity), 32);
+    w.put(s.co2, 16);
+    setU16(p + 14, w.position());
+    c->state.t = s.t;
+    c->state.delta = 0;
+    c->state.tempBits = historyFloatBits(s.temperature);
+    c->state.humBits = historyFloatBits(s.humidity);
+    c->state.tempLead = c->state.humLead = 0xFF;
+    c->state.tempTrail = c->state.humTrail = 0;
+    c->state.co2 = s.co2;
+
+    if (c->tail == HISTORY_NO_BLOCK) c->head = b;
+    else setU32(block(c->tail), b);
+    c->tail = b;
+    samples++;
+    return true;
+  }
+
+  // Call fn(const HistorySample&) for every stored sample of a station with t0 <= t <= t1,
+  // oldest first. Returns the number of samples passed to fn.
+  template <typename F>
+  uint32_t query(const uint8_t mac[6], uint32_t t0, uint32_t t1, F fn) {
+    const Chain* c = chains.find(mac);
+    if (!c) return 0;
+    uint32_t n = 0;
+    for (uint32_t b = c->head; b != HISTORY_NO_BLOCK; b = getU32(block(b))) {
+      const uint8_t* p = block(b);
+      if (getU32(p + 8) < t0) continue;
+      if (getU32(p + 4) > t1) break;   // Blocks are in time order: append() drops late readings
+      n += decodeBlock(p, t0, t1, fn);
+    }
+    return n;
+  }
+
+  uint32_t samples;   // Readings appended since start
+  uint32_t evicted;   // Blocks reused before their retention ran out (pool too small)
+  uint32_t late;      // Readings dropped because they were older than the station's last one
+
+private:
+  uint8_t* block(uint32_t b) const { return pool + (size_t)b * BLOCK_BYTES; }
+  static uint32_t dataBits() { return (BLOCK_BYTES - HISTORY_BLOCK_HEADER_LEN) * 8; }
+
+  static void setU32(uint8_t* p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+  static void setU16(uint8_t* p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+  static uint32_t getU32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+  static uint16_t getU16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+  // Encode a sample at the end of the tail block; false (block unchanged) if it does not fit
+  bool appendTo(Chain& c, const HistorySample& s) {
+    uint8_t* p = block(c.tail);
+    HistoryCodecState st = c.state;
+    HistoryBitWriter w(p + HISTORY_BLOCK_HEADER_LEN, dataBits(), getU16(p + 14));
+
+    int32_t delta = (int32_t)(s.t - st.t);
+    int32_t dod = delta - st.delta;
+    if (dod == 0) {
+      w.put(0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+      w.put(2, 2);
+      w.put((uint32_t)dod & 0x7F, 7);
+    } else if (dod >= -256 && dod <= 255) {
+      w.put(6, 3);
+      w.put((uint32_t)dod & 0x1FF, 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+      w.put(14, 4);
+      w.put((uint32_t)dod & 0xFFF, 12);
+    } else {
+      w.put(15, 4);
+      w.put((uint32_t)dod, 32);
+    }
+    st.t = s.t;
+    st.delta = delta;
+
+    historyPutXor(w, historyFloatBits(s.temperature), st.tempBits, st.tempLead, st.tempTrail);
+    historyPutXor(w, historyFloatBits(s.humidity), st.humBits, st.humLead, st.humTrail);
+    if (s.co2 == CO2_NONE) {
+      w.putVarint(0);
+    } else {
+      int32_t d = (int32_t)s.co2 - (int32_t)st.co2;
+      w.putVarint((((uint32_t)d << 1) ^ (uint32_t)(d >> 31)) + 1);
+      st.co2 = s.co2;
+    }
+
+    if (!w.ok()) return false;
+    c.state = st;
+    setU32(p + 8, s.t);
+    setU16(p + 12, getU16(p + 12) + 1);
+    setU16(p + 14, w.position());
+    return true;
+  }
+
+  template <typename F>
+  static uint32_t decodeBlock(const uint8_t* p, uint32_t t0, uint32_t t1, F& fn) {
+    uint16_t count = getU16(p + 12);
+    HistoryBitReader r(p + HISTORY_BLOCK_HEADER_LEN, 0);
+    HistoryCodecState st;
+    st.t = r.get(32);
+    st.delta = 0;
+    st.tempBits = r.get(32);
+    st.humBits = r.get(32);
+    st.co2 = r.get(16);
+    uint16_t co2 = st.co2;
+    st.tempLead = st.humLead = 0;
+    st.tempTrail = st.humTrail = 0;
+    uint32_t n = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+      if (i > 0) {
+        int32_t dod;
+        if (r.get(1) == 0) dod = 0;
+        else if (r.get(1) == 0) dod = signExtend(r.get(7), 7);
+        else if (r.get(1) == 0) dod = signExtend(r.get(9), 9);
+        else if (r.get(1) == 0) dod = signExtend(r.get(12), 12);
+        else dod = (int32_t)r.get(32);
+        st.delta += dod;
+        st.t += st.delta;
+        historyGetXor(r, st.tempBits, st.tempLead, st.tempTrail);
+        historyGetXor(r, st.humBits, st.humLead, st.humTrail);
+        uint32_t z = r.getVarint();
+        if (z == 0) {
+          co2 = CO2_NONE;
+        } else {
+          z--;
+          st.co2 = (uint16_t)((int32_t)st.co2 + (int32_t)((z >> 1) ^ (0U - (z & 1))));
+          co2 = st.co2;
+        }
+      }
+      if (st.t > t1) break;
+      if (st.t >= t0) {
+        HistorySample s;
+        s.t = st.t;
+        s.temperature = historyBitsFloat(st.tempBits);
+        s.humidity = historyBitsFloat(st.humBits);
+        s.co2 = co2;
+        fn(s);
+        n++;
+      }
+    }
+    return n;
+  }
+
+  static int32_t signExtend(uint32_t v, uint8_t bits) {
+    return (v & (1UL << (bits - 1))) ? (int32_t)(v | (~0UL << bits)) : (int32_t)v;
+  }
+
+  // Free the station's oldest blocks that are entirely outside the retention window
+  void dropExpired(Chain& c, uint32_t now) {
+    while (c.head != HISTORY_NO_BLOCK && c.head != c.tail && now - getU32(block(c.head) + 8) > retentionS) {
+      freeHead(c);
+    }
+  }
+
+  void freeHead(Chain& c) {
+    uint32_t b = c.head;
+    c.head = getU32(block(b));
+    if (c.head == HISTORY_NO_BLOCK) c.tail = HISTORY_NO_BLOCK;
+    setU32(block(b), freeList);
+    freeList = b;
+    usedBlocks--;
+  }
+
+  uint32_t allocBlock() {
+    if (freeList == HISTORY_NO_BLOCK) {
+      // Pool full: reuse the block with the oldest data (only from stations with more than one)
+      Chain* oldest = NULL;
+      uint32_t oldestT = 0;
+      for (uint16_t i = 0; i < chains.size(); ++i) {
+        Chain& c = chains[i];
+        if (c.head == HISTORY_NO_BLOCK || c.head == c.tail) continue;
+        uint32_t t = getU32(block(c.head) + 8);
+        if (!oldest || t < oldestT) {
+          oldest = &c;
+          oldestT = t;
+        }
+      }
+      if (!oldest) return HISTORY_NO_BLOCK;
+      freeHead(*oldest);
+      evicted++;
+    }
+    uint32_t b = freeList;
+    freeList = getU32(block(b));
+    usedBlocks++;
+    return b;
+  }
+
+  StationRegistry<Chain, MAX_STATIONS> chains;
+  uint8_t* pool;
+  uint32_t blockCount;
+  uint32_t usedBlocks;
+  uint32_t freeList;
+  uint32_t retentionS;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Fixed-capacity station table keyed on the MAC address.
+// Plain C++ with no Arduino dependencies, so tools/bench_station_lookup.cpp can use it too.
+//
+// Entries live inline in a preallocated array, in registration order (index = station number
+// in logs). Lookups go through an open-addressing hash index over the MAC packed into a
+// uint64_t: at most half of the index slots are used, so a lookup (hit or miss) is a hash and
+// one or two probes, however many stations are registered. Stations are never removed.
+//
+// One writer (the ESP-NOW receive callback) registers stations; other tasks (metrics server,
+// dashboard) may read while it does. A new entry is written in full before `count` is raised
+// with release order, and size() loads it with acquire, so entries below size() are complete.
+//
+// T must be default constructible, constructible from a MAC and have a `uint8_t mac[6]` member.
+
+// 48-bit MAC in the low bits, bit 48 set so that no valid key is 0 (0 marks an empty slot)
+inline uint64_t macKey(const uint8_t mac[6]) {
+  return ((uint64_t)mac[0] << 40) | ((uint64_t)mac[1] << 32) | ((uint64_t)mac[2] << 24) |
+         ((uint64_t)mac[3] << 16) | ((uint64_t)mac[4] << 8) | (uint64_t)mac[5] | (1ULL << 48);
+}
+
+// Hash index size in bits: smallest power of two >= 2 * n slots (at least 16)
+constexpr uint32_t stationIndexBits(uint32_t n, uint32_t bits = 4) {
+  return (1UL << bits) >= 2UL * n ? bits : stationIndexBits(n, bits + 1);
+}
+
+template <typename T, uint16_t CAPACITY>
+class StationRegistry {
+  static const uint32_t SLOT_BITS = stationIndexBits(CAPACITY);
+  static const uint32_t SLOTS = 1UL << SLOT_BITS;
+  static_assert(CAPACITY >= 1 && CAPACITY <= 32767, "StationRegistry capacity out of range");
+
+public:
+  StationRegistry() : count(0) { clear(); }
+
+  // Forget all stations. Not safe while other tasks read the table.
+  void clear() {
+    count.store(0, std::memory_order_relaxed);
+    memset(slots, 0, sizeof(slots));
+    memset(filter, 0, sizeof(filter));
+  }
+
+  uint16_t size() const { return count.load(std::memory_order_acquire); }
+  uint16_t capacity() const { return CAPACITY; }
+  T& operator[](uint16_t i) { return entries[i]; }
+  const T& operator[](uint16_t i) const { return entries[i]; }
+
+  // Cheap prefilter for callbacks that see many foreign MACs: false means "certainly not
+  // registered" without touching the index. One bit per value of the low 10 MAC bits.
+  bool mayContain(const uint8_t mac[6]) const {
+    uint32_t bit = filterBit(mac);
+    return (filter[bit >> 5] >> (bit & 31)) & 1;
+  }
+
+  T* find(const uint8_t mac[6]) {
+    uint64_t key = macKey(mac);
+    for (uint32_t i = hash(key);; i = (i + 1) & (SLOTS - 1)) {
+      if (slots[i].key == key) return &entries[slots[i].entry];
+      if (slots[i].key == 0) return NULL;
+    }
+  }
+
+  // Existing entry for this MAC, or a new one; NULL when the table is full
+  T* findOrInsert(const uint8_t mac[6]) {
+    uint64_t key = macKey(mac);
+    uint32_t i = hash(key);
+    for (; slots[i].key != 0; i = (i + 1) & (SLOTS - 1)) {
+      if (slots[i].key == key) return &entries[slots[i].entry];
+    }
+    uint16_t n = count.load(std::memory_order_relaxed);   // Only the writer changes it
+    if (n >= CAPACITY) return NULL;
+    entries[n] = T(mac);
+    slots[i].entry = n;
+    slots[i].key = key;
+    filter[filterBit(mac) >> 5] |= 1UL << (filterBit(mac) & 31);
+    count.store(n + 1, std::memory_order_release);
+    return &entries[n];
+  }
+
+private:
+  // Fibonacci hashing: multiply and keep the top bits, which mixes all MAC bytes into the index
+  static uint32_t hash(uint64_t key) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - SLOT_BITS));
+  }
+
+  static uint32_t filterBit(const uint8_t mac[6]) {
+    return ((uint32_t)(mac[4] & 0x03) << 8) | mac[5];
+  }
+
+  struct Slot {
+    uint64_t key;
+    uint16_t entry;
+  };
+
+  Slot slots[SLOTS];
+  T entries[CAPACITY];
+  uint32_t filter[32];  // 1024-bit presence filter for mayContain()
+  std::atomic<uint16_t> count;
+};
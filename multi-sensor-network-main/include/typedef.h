@@ -7,12 +7,8 @@ typedef struct mymsg {
   char c;
 } mymsg;
 
-// Message structure for sensor values
-typedef struct sensor_msg {
-  float temperature;
-  uint16_t co2;
-  float humidity;
-} sensor_msg;
+// Message structure for sensor values (sensor_msg) and its wire format
+#include "espnow_proto.h"
 
 // Structs for RSSI
 typedef struct {
@@ -0,0 +1,72 @@
+#include <Arduino.h>
+#pragma once
+
+#include "uplink_queue.h"
+
+// Store-and-forward backlog for readings that could not be uploaded (Wi-Fi down, server errors).
+// Circular buffer in PSRAM; when it is full the oldest readings are overwritten, so after a long
+// outage we keep the most recent UPLINK_BACKLOG_LEN readings.
+// Only the uploader task touches it; the counters may be read from elsewhere for stats.
+class UplinkBacklog {
+public:
+  UplinkBacklog() : stored(0), overwritten(0), replayed(0), rejected(0),
+                    slots(NULL), cap(0), head(0), count(0), inPsram(false) {}
+
+  // Allocate room for `wanted` readings, in PSRAM if available. If that much memory is not
+  // free the size is halved until the allocation succeeds.
+  bool begin(uint32_t wanted) {
+    if (slots) return true;
+    for (uint32_t n = wanted; n >= 64 && !slots; n /= 2) {
+      if (psramFound()) {
+        slots = (uplink_record*)ps_malloc((size_t)n * sizeof(uplink_record));
+        inPsram = slots != NULL;
+      }
+      if (!slots && n <= 1024) {
+        slots = (uplink_record*)malloc((size_t)n * sizeof(uplink_record));  // No PSRAM: small backlog in RAM
+      }
+      if (slots) cap = n;
+    }
+    return slots != NULL;
+  }
+
+  uint32_t size() const { return count; }
+  uint32_t capacity() const { return cap; }
+  bool usesPsram() const { return inPsram; }
+
+  // Append a reading; overwrites the oldest one when full
+  void push(const uplink_record& rec) {
+    if (!cap) return;
+    slots[(head + count) % cap] = rec;
+    stored++;
+    if (count < cap) {
+      count++;
+    } else {
+      head = (head + 1) % cap;
+      overwritten++;
+    }
+  }
+
+  // i-th oldest reading (0 = oldest)
+  const uplink_record& at(uint32_t i) const { return slots[(head + i) % cap]; }
+
+  // Remove the n oldest readings after they were uploaded, or refused by the server for good
+  void drop(uint32_t n, bool refused = false) {
+    if (n > count) n = count;
+    head = (head + n) % cap;
+    count -= n;
+    if (refused) rejected += n;
+    else replayed += n;
+  }
+
+  uint32_t stored;       // readings ever parked in the backlog
+  uint32_t overwritten;  // readings lost because the backlog was full
+  uint32_t replayed;     // readings uploaded from the backlog
+  uint32_t rejected;     // readings from the backlog the server refused (4xx), dropped
+
+private:
+  uplink_record* slots;
+  uint32_t cap;
+  uint32_t head;      // index of the oldest reading
+  uint32_t count;
+  bool inPsram;
+};
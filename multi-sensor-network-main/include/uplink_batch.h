@@ -0,0 +1,144 @@
+#include <Arduino.h>
+#pragma once
+
+#include "config.h"
+#include "uplink_queue.h"
+#include "uplink_binary.h"
+#include "json_writer.h"
+
+// Body format of one uplink POST, chosen with UPLINK_FORMAT (config.h / platformio.ini).
+// JSON array: "[{...},{...}]", NDJSON: one object per line, JSON: single object (no batching),
+// binary: see uplink_binary.h (in aggregate mode it carries only the window means).
+#if UPLINK_FORMAT == UPLINK_FORMAT_JSON
+  #define UPLINK_CONTENT_TYPE "application/json"
+#elif UPLINK_FORMAT == UPLINK_FORMAT_NDJSON
+  #define UPLINK_CONTENT_TYPE "application/x-ndjson"
+#elif UPLINK_FORMAT == UPLINK_FORMAT_BINARY
+  #define UPLINK_CONTENT_TYPE "application/octet-stream"
+#else
+  #define UPLINK_CONTENT_TYPE "application/json"
+#endif
+
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+// Window summary: the usual reading fields carry the means (so existing consumers keep working),
+// plus "count", "window_s" and "<field>_min" / "_max" / "_last". age_ms is counted from the
+// window end (a slot, as in writeReadingJsonAgeSlot; returns its offset). The co2 fields are null
+// if no reading in the window had CO2.
+inline size_t writeAggregateJson(JsonWriter& w, const uplink_record& rec) {
+  writeReadingFields(w, rec.mac, rec.temperature, rec.humidity, rec.co2);
+  w.raw(",\"age_ms\":");
+  size_t ageAt = w.u32Slot();
+  w.raw(",\"count\":");
+  w.u32(rec.count);
+  w.raw(",\"window_s\":");
+  w.u32(rec.window_s);
+  w.raw(",\"temperature_min\":");
+  w.fixed(rec.temperature_min, 2);
+  w.raw(",\"temperature_max\":");
+  w.fixed(rec.temperature_max, 2);
+  w.raw(",\"temperature_last\":");
+  w.fixed(rec.temperature_last, 2);
+  w.raw(",\"humidity_min\":");
+  w.fixed(rec.humidity_min, 2);
+  w.raw(",\"humidity_max\":");
+  w.fixed(rec.humidity_max, 2);
+  w.raw(",\"humidity_last\":");
+  w.fixed(rec.humidity_last, 2);
+  w.raw(",\"co2_min\":");
+  writeCo2(w, rec.co2_min);
+  w.raw(",\"co2_max\":");
+  writeCo2(w, rec.co2_max);
+  w.raw(",\"co2_last\":");
+  writeCo2(w, rec.co2_last);
+  w.raw('}');
+  return ageAt;
+}
+#endif
+
+// One upload body under construction, written in place into a fixed buffer (no heap).
+// The batch also keeps a copy of its records, so a failed upload can be parked in the
+// backlog and sent again later. Record ages are filled in by finish(), when the body is sent,
+// not when the record is added (a reading may wait up to UPLINK_BATCH_MAX_AGE_MS in the batch).
+template <uint16_t MAX_COUNT, size_t MAX_BYTES>
+class UplinkBatch {
+public:
+#if UPLINK_FORMAT == UPLINK_FORMAT_JSON
+  static const uint16_t LIMIT = 1;
+#else
+  static const uint16_t LIMIT = MAX_COUNT;
+#endif
+
+  UplinkBatch() : json((char*)body, MAX_BYTES), n(0), startMs(0) {}
+
+  uint16_t count() const { return n; }
+  bool full() const { return n >= LIMIT; }
+  uint32_t ageMs(uint32_t nowMs) const { return n ? nowMs - startMs : 0; }
+  const uplink_record& record(uint16_t i) const { return records[i]; }
+  const uint8_t* data() const { return body; }
+
+  // Add a reading. Returns false, leaving the batch unchanged, if it does not fit.
+  bool add(const uplink_record& rec, uint32_t nowMs) {
+    if (full()) return false;
+#if UPLINK_FORMAT == UPLINK_FORMAT_BINARY
+    if (n == 0) encoder.begin(body, MAX_BYTES);
+    if (encoder.sizeIfAdded(rec.mac) > MAX_BYTES) return false;
+    if (!encoder.add(rec.mac, rec.temperature, rec.humidity, rec.co2, rec.rssi, rec.rx_ms)) return false;
+#else
+    size_t mark = json.length();
+  #if UPLINK_FORMAT == UPLINK_FORMAT_JSON_ARRAY
+    json.raw(n == 0 ? '[' : ',');
+  #elif UPLINK_FORMAT == UPLINK_FORMAT_NDJSON
+    if (n > 0) json.raw('\n');
+  #endif
+  #if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+    if (rec.count) {
+      ageAt[n] = writeAggregateJson(json, rec);
+    } else {
+      ageAt[n] = writeReadingJsonAgeSlot(json, rec.mac, rec.temperature, rec.humidity, rec.co2);
+    }
+  #else
+    ageAt[n] = writeReadingJsonAgeSlot(json, rec.mac, rec.temperature, rec.humidity, rec.co2);
+  #endif
+    // Keep room for the closing ']' / '\n'
+    if (json.overflow() || json.length() + 2 > MAX_BYTES) {
+      json.truncate(mark);
+      return false;
+    }
+#endif
+    if (n == 0) startMs = nowMs;
+    records[n++] = rec;
+    return true;
+  }
+
+  // Close the body, with every record's age as of nowMs. Returns its length; the body is data().
+  size_t finish(uint32_t nowMs) {
+#if UPLINK_FORMAT == UPLINK_FORMAT_BINARY
+    return encoder.finish(nowMs);
+#else
+    for (uint16_t i = 0; i < n; ++i) json.fillU32(ageAt[i], nowMs - records[i].rx_ms);
+  #if UPLINK_FORMAT == UPLINK_FORMAT_JSON_ARRAY
+    json.raw(']');
+  #elif UPLINK_FORMAT == UPLINK_FORMAT_NDJSON
+    json.raw('\n');
+  #endif
+    return json.length();
+#endif
+  }
+
+  void clear() {
+    json.truncate(0);
+    n = 0;
+  }
+
+private:
+  uint8_t body[MAX_BYTES];
+  uplink_record records[MAX_COUNT];
+#if UPLINK_FORMAT == UPLINK_FORMAT_BINARY
+  UplinkBinaryEncoder<MAX_COUNT> encoder;  // A batch never has more stations than readings
+#else
+  size_t ageAt[MAX_COUNT];                 // Offset of each record's age_ms slot in body
+#endif
+  JsonWriter json;
+  uint16_t n;
+  uint32_t startMs;   // millis() when the oldest reading was added
+};
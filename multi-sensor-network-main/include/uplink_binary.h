@@ -0,0 +1,151 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// Compact binary uplink format (Content-Type: application/octet-stream).
+// Plain C++ with no Arduino dependencies, so host tools can encode/decode it too.
+//
+// All multi-byte fields are little endian.
+//
+//   offset  size  field
+//   0       2     magic "MS"
+//   2       1     version (UPLINK_BIN_VERSION)
+//   3       1     flags (reserved, 0)
+//   4       2     station count S
+//   6       2     record count R
+//   8       13*R  records
+//           6*S   station table: MACs, in order of first appearance in the batch
+//           4     CRC-32 (IEEE 802.3) over everything before it
+//
+//   record: station index (u16), temperature (i16, 0.01 degC), humidity (u16, 0.01 %RH),
+//           co2 (u16, ppm; 0xFFFF: not measured), rssi (i8, dBm), age (u32, ms between
+//           reception and encoding)
+//
+// The station table comes after the records so the encoder can stream records into the
+// buffer as they arrive and only append the table (each MAC once) when the batch is closed.
+
+#define UPLINK_BIN_MAGIC0 'M'
+#define UPLINK_BIN_MAGIC1 'S'
+#define UPLINK_BIN_VERSION 1
+#define UPLINK_BIN_HEADER_LEN 8
+#define UPLINK_BIN_RECORD_LEN 13
+#define UPLINK_BIN_MAC_LEN 6
+#define UPLINK_BIN_CRC_LEN 4
+
+// co2 of a reading without a CO2 value (SCD41 T/RH-only shot), everywhere from the ESP-NOW
+// decoder to the uplink: in history, aggregation, WAL and both upload formats it means "absent"
+#define CO2_NONE 0xFFFF
+
+// CRC-32 (reflected, polynomial 0xEDB88320) with a 16-entry nibble table
+inline uint32_t uplinkCrc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+inline void uplinkPutU16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+inline void uplinkPutU32(uint8_t* p, uint32_t v) { p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = v >> 24; }
+inline uint16_t uplinkGetU16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+inline uint32_t uplinkGetU32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+// Float -> fixed point with rounding and clamping to the field range
+inline int16_t uplinkToCenti(float v) {
+  long c = lroundf(v * 100.0f);
+  return c > INT16_MAX ? INT16_MAX : (c < INT16_MIN ? INT16_MIN : (int16_t)c);
+}
+inline uint16_t uplinkToCentiU(float v) {
+  long c = lroundf(v * 100.0f);
+  return c > UINT16_MAX ? UINT16_MAX : (c < 0 ? 0 : (uint16_t)c);
+}
+
+// Streams records into a caller-provided buffer. MAX_STATIONS bounds the per-batch station table.
+template <uint16_t MAX_STATIONS>
+class UplinkBinaryEncoder {
+public:
+  void begin(uint8_t* buffer, size_t capacity) {
+    buf = buffer;
+    cap = capacity;
+    len = UPLINK_BIN_HEADER_LEN;
+    stationCount = 0;
+    recordCount = 0;
+  }
+
+  uint16_t records() const { return recordCount; }
+
+  // Size of the finished batch if a record from this MAC were added now
+  size_t sizeIfAdded(const uint8_t mac[6]) const {
+    size_t tableLen = (size_t)stationCount * UPLINK_BIN_MAC_LEN;
+    if (findStation(mac) < 0) tableLen += UPLINK_BIN_MAC_LEN;
+    return len + UPLINK_BIN_RECORD_LEN + tableLen + UPLINK_BIN_CRC_LEN;
+  }
+
+  // Returns false if the record does not fit (buffer or station table full).
+  // rxMs is the receive time in the caller's millisecond clock; finish() turns it into an age.
+  bool add(const uint8_t mac[6], float temperature, float humidity, uint16_t co2, int16_t rssi, uint32_t rxMs) {
+    int idx = findStation(mac);
+    if (idx < 0) {
+      if (stationCount >= MAX_STATIONS) return false;
+      idx = stationCount;
+    }
+    if (sizeIfAdded(mac) > cap) return false;
+    if (idx == stationCount) {
+      memcpy(macs[stationCount++], mac, UPLINK_BIN_MAC_LEN);
+    }
+
+    uint8_t* p = buf + len;
+    uplinkPutU16(p, (uint16_t)idx);
+    uplinkPutU16(p + 2, (uint16_t)uplinkToCenti(temperature));
+    uplinkPutU16(p + 4, uplinkToCentiU(humidity));
+    uplinkPutU16(p + 6, co2);
+    p[8] = (uint8_t)(int8_t)(rssi < -128 ? -128 : (rssi > 127 ? 127 : rssi));
+    uplinkPutU32(p + 9, rxMs);
+    len += UPLINK_BIN_RECORD_LEN;
+    recordCount++;
+    return true;
+  }
+
+  // Write header, record ages, station table and CRC. Returns the total length in bytes.
+  size_t finish(uint32_t nowMs) {
+    buf[0] = UPLINK_BIN_MAGIC0;
+    buf[1] = UPLINK_BIN_MAGIC1;
+    buf[2] = UPLINK_BIN_VERSION;
+    buf[3] = 0;
+    uplinkPutU16(buf + 4, stationCount);
+    uplinkPutU16(buf + 6, recordCount);
+    for (uint16_t i = 0; i < recordCount; ++i) {
+      uint8_t* age = buf + UPLINK_BIN_HEADER_LEN + (size_t)i * UPLINK_BIN_RECORD_LEN + 9;
+      uplinkPutU32(age, nowMs - uplinkGetU32(age));
+    }
+    for (uint16_t i = 0; i < stationCount; ++i) {
+      memcpy(buf + len, macs[i], UPLINK_BIN_MAC_LEN);
+      len += UPLINK_BIN_MAC_LEN;
+    }
+    uplinkPutU32(buf + len, uplinkCrc32(buf, len));
+    len += UPLINK_BIN_CRC_LEN;
+    return len;
+  }
+
+private:
+  int findStation(const uint8_t mac[6]) const {
+    for (uint16_t i = 0; i < stationCount; ++i) {
+      if (memcmp(macs[i], mac, UPLINK_BIN_MAC_LEN) == 0) return i;
+    }
+    return -1;
+  }
+
+  uint8_t* buf;
+  size_t cap;
+  size_t len;
+  uint16_t stationCount;
+  uint16_t recordCount;
+  uint8_t macs[MAX_STATIONS][UPLINK_BIN_MAC_LEN];
+};
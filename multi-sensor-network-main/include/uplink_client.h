@@ -0,0 +1,235 @@
+#include <Arduino.h>
+#pragma once
+#include <WiFi.h>
+#include <WiFiClient.h>
+#include <string.h>
+
+// Error codes returned by UplinkClient::post() (same numbering the gateway always printed)
+#define UPLINK_ERR_CONNECT       -1   // TCP connection refused / failed
+#define UPLINK_ERR_SEND_HEADER   -2   // Writing the request header failed
+#define UPLINK_ERR_SEND_PAYLOAD  -3   // Writing the request body failed
+#define UPLINK_ERR_NOT_CONNECTED -4   // Wi-Fi not connected
+#define UPLINK_ERR_CONN_LOST     -5   // Server closed the connection before a status line arrived
+#define UPLINK_ERR_NO_HTTP       -7   // Response did not start with a valid HTTP status line
+#define UPLINK_ERR_READ_TIMEOUT  -11  // No (complete) response header within the timeout
+
+#ifndef UPLINK_CONNECT_TIMEOUT_MS
+#define UPLINK_CONNECT_TIMEOUT_MS 5000
+#endif
+#ifndef UPLINK_RESPONSE_TIMEOUT_MS
+#define UPLINK_RESPONSE_TIMEOUT_MS 10000
+#endif
+
+// Ingest endpoint, split into host / port / path once at startup
+struct UplinkEndpoint {
+  char host[64];
+  char path[128];
+  uint16_t port;
+  bool https;
+  bool valid;
+};
+
+// Parse "http://host[:port]/path" without allocating. Returns false if the URL does not fit.
+inline bool parseEndpointUrl(const char* url, UplinkEndpoint& ep) {
+  memset(&ep, 0, sizeof(ep));
+  const char* p = url;
+  ep.https = strncmp(p, "https://", 8) == 0;
+  const char* sep = strstr(p, "://");
+  if (sep) p = sep + 3;
+
+  const char* hostEnd = p;
+  while (*hostEnd && *hostEnd != '/' && *hostEnd != ':') hostEnd++;
+  size_t hostLen = hostEnd - p;
+  if (hostLen == 0 || hostLen >= sizeof(ep.host)) return false;
+  memcpy(ep.host, p, hostLen);
+
+  ep.port = ep.https ? 443 : 80;
+  p = hostEnd;
+  if (*p == ':') {
+    ep.port = (uint16_t)strtoul(p + 1, (char**)&p, 10);
+  }
+
+  const char* path = *p ? p : "/";
+  if (strlen(path) >= sizeof(ep.path)) return false;
+  strcpy(ep.path, path);
+  ep.valid = true;
+  return true;
+}
+
+// Reusable HTTP/1.1 client for the ingest endpoint.
+// Keeps one keep-alive connection open and reconnects only when the server closed it.
+// The response is parsed as it streams in: status line and Content-Length/Connection headers
+// are picked out line by line, the body is skipped, nothing is accumulated in a String.
+class UplinkClient {
+public:
+  explicit UplinkClient(const char* url) : lastConnectMs(0), connects(0), requests(0), reused(0), keepAlive(false) {
+    parseEndpointUrl(url, ep);
+  }
+
+  const UplinkEndpoint& endpoint() const { return ep; }
+
+  // POST a body and return the HTTP status code, or one of the UPLINK_ERR_* codes.
+  int post(const char* body, size_t len, const char* contentType) {
+    if (!ep.valid) return UPLINK_ERR_CONNECT;
+    if (WiFi.status() != WL_CONNECTED) return UPLINK_ERR_NOT_CONNECTED;
+
+    // A reused connection may have been closed by the server while idle; retry once on a fresh one
+    for (int attempt = 0; attempt < 2; ++attempt) {
+      bool wasOpen = keepAlive && client.connected();
+      if (!wasOpen && !connect()) return UPLINK_ERR_CONNECT;
+
+      int code = sendRequest(body, len, contentType);
+      if (code == UPLINK_ERR_SEND_HEADER || code == UPLINK_ERR_SEND_PAYLOAD || code == UPLINK_ERR_CONN_LOST) {
+        client.stop();
+        keepAlive = false;
+        if (wasOpen) continue;
+      }
+      requests++;
+      if (wasOpen) reused++;
+      return code;
+    }
+    return UPLINK_ERR_CONN_LOST;
+  }
+
+  void stop() {
+    client.stop();
+    keepAlive = false;
+  }
+
+  uint32_t lastConnectMs;   // Duration of the last TCP connect
+  uint32_t connects;        // TCP connections opened
+  uint32_t requests;        // Requests that got a final result
+  uint32_t reused;          // Requests that went over an already open connection
+
+private:
+  bool connect() {
+    client.stop();
+    unsigned long start = millis();
+    bool ok = client.connect(ep.host, ep.port, UPLINK_CONNECT_TIMEOUT_MS);
+    lastConnectMs = millis() - start;
+    if (!ok) return false;
+    client.setNoDelay(true);
+    connects++;
+    keepAlive = true;
+    return true;
+  }
+
+  int sendRequest(const char* body, size_t len, const char* contentType) {
+    char header[384];
+    int n = snprintf(header, sizeof(header),
+                     "POST %s HTTP/1.1\r\n"
+                     "Host: %s\r\n"
+                     "Content-Type: %s\r\n"
+                     "User-Agent: ESP32-S3-Gateway/1.0\r\n"
+                     "Accept: application/json\r\n"
+                     "Connection: keep-alive\r\n"
+                     "Content-Length: %u\r\n\r\n",
+                     ep.path, ep.host, contentType, (unsigned)len);
+    if (n <= 0 || n >= (int)sizeof(header)) return UPLINK_ERR_SEND_HEADER;
+    if (client.write((const uint8_t*)header, n) != (size_t)n) return UPLINK_ERR_SEND_HEADER;
+    if (client.write((const uint8_t*)body, len) != len) return UPLINK_ERR_SEND_PAYLOAD;
+    return readResponse();
+  }
+
+  // Read one byte, waiting up to the deadline. Returns -1 on timeout, -2 if the connection closed.
+  int nextByte(unsigned long deadline) {
+    while (!client.available()) {
+      if (!client.connected()) return -2;
+      if ((long)(millis() - deadline) >= 0) return -1;
+      delay(1);
+    }
+    return client.read();
+  }
+
+  int readResponse() {
+    unsigned long deadline = millis() + UPLINK_RESPONSE_TIMEOUT_MS;
+    char line[80];
+    size_t lineLen = 0;
+    bool gotAny = false;
+    int status = 0;
+    long contentLength = -1;
+    bool chunked = false;
+    bool serverCloses = false;
+
+    // Status line and headers, one line at a time (long header lines are truncated, which is fine)
+    for (;;) {
+      int c = nextByte(deadline);
+      if (c < 0) {
+        keepAlive = false;
+        if (!gotAny && c == -2) return UPLINK_ERR_CONN_LOST;
+        return status > 0 ? status : UPLINK_ERR_READ_TIMEOUT;
+      }
+      gotAny = true;
+      if (c == '\r') continue;
+      if (c != '\n') {
+        if (lineLen < sizeof(line) - 1) line[lineLen++] = (char)c;
+        continue;
+      }
+      line[lineLen] = '\0';
+      if (status == 0) {
+        // "HTTP/1.1 200 OK"
+        if (strncmp(line, "HTTP/1.", 7) != 0 || lineLen < 12) {
+          keepAlive = false;
+          return UPLINK_ERR_NO_HTTP;
+        }
+        status = atoi(line + 9);
+      } else if (lineLen == 0) {
+        break; // End of headers
+      } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        contentLength = atol(line + 15);
+      } else if (strncasecmp(line, "Connection:", 11) == 0) {
+        serverCloses = strstr(line + 11, "close") != NULL;
+      } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+        chunked = strstr(line + 18, "chunked") != NULL;
+      }
+      lineLen = 0;
+    }
+
+    // Without a length (or if the server closes anyway) the connection can't be reused:
+    // stop here instead of waiting for the body.
+    if (serverCloses || (contentLength < 0 && !chunked)) {
+      stop();
+      return status;
+    }
+
+    // Skip the body so the next request starts on a clean connection
+    bool ok = chunked ? skipChunkedBody(deadline) : skipBytes(contentLength, deadline);
+    if (!ok) stop();
+    return status;
+  }
+
+  bool skipBytes(long count, unsigned long deadline) {
+    uint8_t scratch[64];
+    while (count > 0) {
+      if (!client.available()) {
+        if (nextByte(deadline) < 0) return false;
+        count--;
+        continue;
+      }
+      int got = client.read(scratch, count < (long)sizeof(scratch) ? count : sizeof(scratch));
+      if (got <= 0) return false;
+      count -= got;
+    }
+    return true;
+  }
+
+  // "<hex size>\r\n<data>\r\n" ... "0\r\n\r\n" (trailers are not expected from the ingest server)
+  bool skipChunkedBody(unsigned long deadline) {
+    for (;;) {
+      long size = 0;
+      int c;
+      while ((c = nextByte(deadline)) >= 0 && c != '\n') {
+        if (c >= '0' && c <= '9') size = size * 16 + (c - '0');
+        else if (c >= 'a' && c <= 'f') size = size * 16 + (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') size = size * 16 + (c - 'A' + 10);
+      }
+      if (c < 0) return false;
+      if (!skipBytes(size + 2, deadline)) return false;  // data + CRLF (or final empty line)
+      if (size == 0) return true;
+    }
+  }
+
+  UplinkEndpoint ep;
+  WiFiClient client;
+  bool keepAlive;
+};
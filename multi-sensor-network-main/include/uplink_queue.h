@@ -0,0 +1,86 @@
+#include <Arduino.h>
+#pragma once
+#include <atomic>
+
+#include "config.h"
+
+// Fixed-size copy of one reading as it leaves the ESP-NOW callback.
+// The callback fills one of these and hands it to the uploader task, so nothing
+// in the receive path allocates or blocks on the network.
+typedef struct uplink_record {
+  uint8_t mac[6];       // Station MAC
+  int16_t rssi;         // Smoothed station RSSI in dBm (0 if unknown)
+  float temperature;
+  float humidity;
+  uint16_t co2;
+  uint32_t rx_ms;       // millis() when the frame was received
+  uint32_t seq;         // Write-ahead log sequence number (0 if not logged)
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+  // Window summary: temperature / humidity / co2 above are the means, rx_ms is the window end.
+  // count 0: plain reading (e.g. recovered from the WAL, which only keeps the means).
+  uint16_t count;       // Readings in the window
+  uint16_t window_s;    // Window length in seconds
+  float temperature_min, temperature_max, temperature_last;
+  float humidity_min, humidity_max, humidity_last;
+  uint16_t co2_min, co2_max, co2_last;
+#endif
+} uplink_record;
+
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+static_assert(AGG_WINDOW_S > 0 && AGG_WINDOW_S <= 0xFFFF, "AGG_WINDOW_S must fit in uplink_record.window_s (uint16_t)");
+#endif
+
+// Single-producer / single-consumer ring buffer.
+// Producer: ESP-NOW receive callback (Wi-Fi task). Consumer: uploader task.
+// Storage is preallocated; head/tail are free-running counters, so N must be a power of two.
+template <typename T, uint32_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0), highWater(0), drops(0) {}
+
+  // Producer side. Returns false (and counts a drop) when the ring is full.
+  bool push(const T& item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    uint32_t t = tail.load(std::memory_order_acquire);
+    if (h - t >= N) {
+      drops.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slots[h & (N - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+
+    uint32_t depth = h + 1 - t;
+    if (depth > highWater.load(std::memory_order_relaxed)) {
+      highWater.store(depth, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer side. Returns false when the ring is empty.
+  bool pop(T& out) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    uint32_t h = head.load(std::memory_order_acquire);
+    if (t == h) {
+      return false;
+    }
+    out = slots[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint32_t depth() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+  uint32_t capacity() const { return N; }
+  uint32_t highWaterMark() const { return highWater.load(std::memory_order_relaxed); }
+  uint32_t dropCount() const { return drops.load(std::memory_order_relaxed); }
+
+private:
+  T slots[N];
+  std::atomic<uint32_t> head;       // written by producer only
+  std::atomic<uint32_t> tail;       // written by consumer only
+  std::atomic<uint32_t> highWater;  // max depth seen by producer
+  std::atomic<uint32_t> drops;      // pushes rejected because the ring was full
+};
@@ -17,15 +17,20 @@
 #include "config.h"  // Where information is stored about constants, e.g. fan duration etc.
 #include "espnow_comm.h" // Header files for esp now communication
 
+Scd41Sensor sensor;
+uint16_t boot_count = 0;  // power-on counter (NVS)
+uint32_t msg_seq = 0;     // sequence number of the next sensor_msg
+
 // Run once (init)
 void setup() {
 
     // Anything calibration required is preset by device itself, by default.
-  Serial.begin(115200);
+  LOG_BEGIN(115200);
      // Initialize stuff
   ESPNOWSetup();
-  initSensor();
+  sensor.init();
   addBroadcastPeer();
+  boot_count = nextBootCount();
 }
 
 
@@ -34,34 +39,22 @@ void loop(){
 
     // Start measurement loop
 
-    Serial.println("Starting measurement");
-    error = sensor.startPeriodicMeasurement(); // Start the measurement process (non blocking)
-        
-    if (error != NO_ERROR) {
-        Serial.print("Error trying to execute periodic measurement(): ");
-        errorToString(error, errorMessage, sizeof errorMessage);
-        Serial.println(errorMessage);
-    }   
+    LOG_I("Starting measurement\n");
+    sensor.start(true); // Start the measurement process (non blocking)
 
-    // Measurement pause
-    delay(5000); //ms afaik - now 5 sec
+    // Measurement pause, then wait for the data-ready flag
+    delay(Scd41Sensor::measureTimeMs(true));
+    sensor.waitReady(SCD41_READY_TIMEOUT_MS);
 
     // Start transmission step
-    Serial.println("Reading value and sending");
-    msg = readSDA41(); // This uses sensor.readMeasurement()
-    esp_now_send(broadcastAddr, (uint8_t *)&msg, sizeof(msg));
-
-    // Wait for send to complete
-    while (!send_done) {
-        delay(1);
-    }
-
-    error = sensor.stopPeriodicMeasurement();
-    if (error != NO_ERROR) {
-        Serial.print("Error trying to stop periodic measurement(): ");
-        errorToString(error, errorMessage, sizeof errorMessage);
-        Serial.println(errorMessage);
-    }
+    LOG_I("Reading value and sending\n");
+    sensor_msg msg;
+    sensor.read(msg); // Stops the periodic measurement again (periodic mode)
+    msg.boot = boot_count;
+    msg.seq = msg_seq++;
+    msg.uptime_s = millis() / 1000;
+    uint8_t frame[ESPNOW_MAX_FRAME];
+    sendToGateway(frame, wireEncode(msg, frame, sizeof(frame)));
 }
 
 
@@ -10,22 +10,23 @@
 
 #include "config.h"
 #include "espnow_comm.h" // ESP-NOW communication
+#include "metrics_server.h" // GET /metrics (Prometheus)
 
 void connectToWiFi() {
-    Serial.printf("Connecting to WiFi SSID '%s'...\n", WIFI_SSID);
+    LOG_PRINTF("Connecting to WiFi SSID '%s'...\n", WIFI_SSID);
     WiFi.mode(WIFI_STA);
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 
     unsigned long start = millis();
     while (WiFi.status() != WL_CONNECTED && millis() - start < 20000) {
         delay(500);
-        Serial.print(".");
+        LOG_PRINT(".");
     }
-    Serial.println();
+    LOG_PRINTLN();
 
     if (WiFi.status() == WL_CONNECTED) {
-        Serial.print("WiFi connected, IP: ");
-        Serial.println(WiFi.localIP());
+        LOG_PRINT("WiFi connected, IP: ");
+        LOG_PRINTLN(WiFi.localIP());
         
         // Get current network configuration
         IPAddress localIP = WiFi.localIP();
@@ -33,7 +34,7 @@ void connectToWiFi() {
         IPAddress subnet = WiFi.subnetMask();
         
         // Force Google DNS - reconfigure with DNS servers
-        Serial.println("Configuring Google DNS (8.8.8.8, 8.8.4.4)...");
+        LOG_PRINTLN("Configuring Google DNS (8.8.8.8, 8.8.4.4)...");
         WiFi.config(localIP, gateway, subnet, IPAddress(8, 8, 8, 8), IPAddress(8, 8, 4, 4));
         delay(2000); // Wait for DNS config to apply
         
@@ -46,82 +47,77 @@ void connectToWiFi() {
         start = millis();
         while (WiFi.status() != WL_CONNECTED && millis() - start < 10000) {
             delay(500);
-            Serial.print(".");
+            LOG_PRINT(".");
         }
-        Serial.println();
+        LOG_PRINTLN();
         
         // Verify DNS configuration
         IPAddress dns1 = WiFi.dnsIP(0);
         IPAddress dns2 = WiFi.dnsIP(1);
-        Serial.print("DNS Server 1: ");
-        Serial.println(dns1);
-        Serial.print("DNS Server 2: ");
-        Serial.println(dns2);
+        LOG_PRINT("DNS Server 1: ");
+        LOG_PRINTLN(dns1);
+        LOG_PRINT("DNS Server 2: ");
+        LOG_PRINTLN(dns2);
         
         // Test DNS resolution
         IPAddress testIP;
-        Serial.print("Testing DNS with google.com... ");
+        LOG_PRINT("Testing DNS with google.com... ");
         if (WiFi.hostByName("google.com", testIP) == 1) {
-            Serial.print("SUCCESS! IP: ");
-            Serial.println(testIP);
+            LOG_PRINT("SUCCESS! IP: ");
+            LOG_PRINTLN(testIP);
         } else {
-            Serial.println("FAILED");
+            LOG_PRINTLN("FAILED");
         }
         
         // Test Vercel domain specifically
-        Serial.print("Testing DNS with multisensornetwork.vercel.app... ");
+        LOG_PRINT("Testing DNS with multisensornetwork.vercel.app... ");
         IPAddress vercelIP;
         if (WiFi.hostByName("multisensornetwork.vercel.app", vercelIP) == 1) {
-            Serial.print("SUCCESS! IP: ");
-            Serial.println(vercelIP);
+            LOG_PRINT("SUCCESS! IP: ");
+            LOG_PRINTLN(vercelIP);
         } else {
-            Serial.println("FAILED - This domain may not resolve");
+            LOG_PRINTLN("FAILED - This domain may not resolve");
         }
         
         // Test Supabase domain DNS resolution
-        Serial.print("Testing DNS with hvmhlvaoovmyctmctqyb.supabase.co... ");
+        LOG_PRINT("Testing DNS with hvmhlvaoovmyctmctqyb.supabase.co... ");
         IPAddress supabaseIP;
         if (WiFi.hostByName("hvmhlvaoovmyctmctqyb.supabase.co", supabaseIP) == 1) {
-            Serial.print("SUCCESS! IP: ");
-            Serial.println(supabaseIP);
+            LOG_PRINT("SUCCESS! IP: ");
+            LOG_PRINTLN(supabaseIP);
         } else {
-            Serial.println("FAILED - Supabase domain may not resolve");
-            Serial.println("This will cause connection issues. Check DNS settings.");
+            LOG_PRINTLN("FAILED - Supabase domain may not resolve");
+            LOG_PRINTLN("This will cause connection issues. Check DNS settings.");
         }
         
-        // Test Cloudflare Worker DNS resolution
-        String workerUrl = String(SUPABASE_EDGE_FUNCTION_URL);
-        int protocolEnd = workerUrl.indexOf("://");
-        if (protocolEnd > 0) {
-            String domain = workerUrl.substring(protocolEnd + 3);
-            int pathStart = domain.indexOf("/");
-            if (pathStart > 0) {
-                domain = domain.substring(0, pathStart);
-            }
-            Serial.print("Testing DNS with Cloudflare Worker: ");
-            Serial.print(domain);
-            Serial.print("... ");
-            IPAddress workerIP;
-            if (WiFi.hostByName(domain.c_str(), workerIP) == 1) {
-                Serial.print("SUCCESS! IP: ");
-                Serial.println(workerIP);
-            } else {
-                Serial.println("FAILED - Worker domain may not resolve");
-                Serial.println("This will cause connection issues.");
-            }
+        // Test ingest endpoint DNS resolution (endpoint was parsed once at startup)
+        const char* domain = uplinkClient.endpoint().host;
+        LOG_PRINT("Testing DNS with ingest server: ");
+        LOG_PRINT(domain);
+        LOG_PRINT("... ");
+        IPAddress workerIP;
+        if (WiFi.hostByName(domain, workerIP) == 1) {
+            LOG_PRINT("SUCCESS! IP: ");
+            LOG_PRINTLN(workerIP);
+        } else {
+            LOG_PRINTLN("FAILED - Ingest server domain may not resolve");
+            LOG_PRINTLN("This will cause connection issues.");
         }
         
-        Serial.print("Gateway will forward data to: ");
-        Serial.println(SUPABASE_EDGE_FUNCTION_URL);
+        // Wall clock for the write-ahead log, so readings replayed after a reboot keep their time
+        configTime(0, 0, "pool.ntp.org", "time.google.com");
+        
+        LOG_PRINT("Gateway will forward data to: ");
+        LOG_PRINTLN(SUPABASE_EDGE_FUNCTION_URL);
     } else {
-        Serial.println("WiFi connection failed, continuing with ESP-NOW only");
-        Serial.println("Note: Data will not be forwarded to web server without WiFi");
+        LOG_PRINTLN("WiFi connection failed, continuing with ESP-NOW only");
+        LOG_PRINTLN("Note: Data will not be forwarded to web server without WiFi");
     }
 }
 
 void setup() {
     // Initialize serial communication (use COM USB-C port for programming/serial monitor)
-    Serial.begin(115200);
+    LOG_BEGIN(115200);
     // Wait for serial port to connect (important for ESP32-S3 with dual USB ports)
     // Use COM port (USB-to-UART) for serial communication
     while (!Serial && millis() < 3000) {
@@ -129,25 +125,30 @@ void setup() {
     }
     delay(500);
 
-    Serial.println("\n========================================");
-    Serial.println("=== ESP32-S3 Gateway Starting ===");
-    Serial.println("========================================\n");
+    LOG_PRINTLN("\n========================================");
+    LOG_PRINTLN("=== ESP32-S3 Gateway Starting ===");
+    LOG_PRINTLN("========================================\n");
     
-    Serial.println("Step 1: Connecting to WiFi...");
+    LOG_PRINTLN("Step 1: Connecting to WiFi...");
     connectToWiFi();
     
-    Serial.println("\nStep 2: Initializing ESP-NOW...");
+    LOG_PRINTLN("\nStep 2: Starting uplink task...");
+    startUplinkTask();
+    
+    LOG_PRINTLN("\nStep 3: Initializing ESP-NOW...");
     ESPNOWSetup(); 
+
+    LOG_PRINTLN("\nStep 4: Starting metrics server...");
+    startMetricsServer();
     
-    Serial.println("\n========================================");
-    Serial.println("=== Gateway Ready ===");
-    Serial.println("========================================");
-    Serial.println("Status: Listening for ESP-NOW packets");
-    Serial.println("Action: Received data will be forwarded to Supabase Edge Function");
-    Serial.printf("Supabase Edge Function: %s\n", SUPABASE_EDGE_FUNCTION_URL);
+    LOG_PRINTLN("\n========================================");
+    LOG_PRINTLN("=== Gateway Ready ===");
+    LOG_PRINTLN("========================================");
+    LOG_PRINTLN("Status: Listening for ESP-NOW packets");
+    LOG_PRINTLN("Action: Received data will be forwarded to Supabase Edge Function");
+    LOG_PRINTF("Supabase Edge Function: %s\n", SUPABASE_EDGE_FUNCTION_URL);
     
     // Print gateway MAC address for debugging
-    Serial.print("Gateway MAC Address: ");
     uint8_t gatewayMac[6];
 #if defined(ESP32S3) || defined(CONFIG_IDF_TARGET_ESP32S3)
     // ESP32-S3 uses ESP_MAC_WIFI_SOFTAP or ESP_MAC_WIFI_STA
@@ -155,15 +156,11 @@ void setup() {
 #else
     esp_read_mac(gatewayMac, ESP_MAC_WIFI_STA);
 #endif
-    for (int i = 0; i < 6; ++i) {
-        Serial.printf("%02X", gatewayMac[i]);
-        if (i < 5) Serial.print(":");
-    }
-    Serial.println();
+    LOG_PRINTF("Gateway MAC Address: " MAC_FMT "\n", MAC_ARGS(gatewayMac));
     
-    Serial.println("Waiting for sensor stations to send data...");
-    Serial.println("(Stations should send to broadcast address FF:FF:FF:FF:FF:FF)");
-    Serial.println();
+    LOG_PRINTLN("Waiting for sensor stations to send data...");
+    LOG_PRINTLN("(Stations should send to broadcast address FF:FF:FF:FF:FF:FF)");
+    LOG_PRINTLN();
 }
 
 void loop() {
@@ -172,14 +169,18 @@ void loop() {
     if (millis() - lastWiFiCheck > 30000) { // Check every 30 seconds
         lastWiFiCheck = millis();
         if (WiFi.status() != WL_CONNECTED) {
-            Serial.println("WiFi disconnected, attempting to reconnect...");
+            LOG_W("WiFi disconnected, attempting to reconnect...\n");
             connectToWiFi();
         } else {
             // Periodic heartbeat to show gateway is alive
-            Serial.println("[Heartbeat] Gateway is alive and listening for ESP-NOW packets...");
+            LOG_I("[Heartbeat] Gateway is alive and listening for ESP-NOW packets...\n");
         }
+        printUplinkQueueStats();
+        printLinkStats();
     }
+
+    sendBeacon();   // Lets scanning stations find our channel
     
-    // All data forwarding is handled in ESP-NOW callbacks (espnow_comm.h)
-    // Real sensor data is automatically forwarded when received via ESP-NOW
+    // ESP-NOW callbacks (espnow_comm.h) queue received readings,
+    // the uplink task forwards them to the web server
 }
@@ -0,0 +1,101 @@
+// FreeRTOS task, notification and mutex API on std::thread (hal/freertos/).
+
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+struct hal_task {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notify = 0;
+};
+
+static thread_local hal_task* t_self = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg,
+                                   UBaseType_t, TaskHandle_t* out, BaseType_t) {
+  hal_task* t = new hal_task();
+  if (out) *out = t;
+  std::thread([t, fn, arg]() {
+    t_self = t;
+    fn(arg);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out) {
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, 0);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+// A task deleting itself parks its thread (the process exit ends it)
+void vTaskDelete(TaskHandle_t) {
+  if (t_self) {
+    for (;;) std::this_thread::sleep_for(std::chrono::hours(1));
+  }
+}
+
+TickType_t xTaskGetTickCount(void) {
+  static const auto boot = std::chrono::steady_clock::now();
+  return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t) {
+  if (!t) return pdFAIL;
+  {
+    std::lock_guard<std::mutex> g(t->m);
+    t->notify++;
+  }
+  t->cv.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) {
+  hal_task* t = t_self;
+  if (!t) {
+    // Not called from a task (the loop() thread): nothing can notify it
+    vTaskDelay(wait == portMAX_DELAY ? 1 : wait);
+    return 0;
+  }
+  std::unique_lock<std::mutex> l(t->m);
+  if (wait == portMAX_DELAY) t->cv.wait(l, [t] { return t->notify > 0; });
+  else t->cv.wait_for(l, std::chrono::milliseconds(wait), [t] { return t->notify > 0; });
+  uint32_t v = t->notify;
+  if (clear) t->notify = 0;
+  else if (t->notify) t->notify--;
+  return v;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+  return 4096;   // No stack limit on the host
+}
+
+// ---- Mutex semaphores ----
+
+struct hal_sem {
+  std::timed_mutex m;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  return new hal_sem();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) {
+  if (wait == portMAX_DELAY) {
+    s->m.lock();
+    return pdTRUE;
+  }
+  return s->m.try_lock_for(std::chrono::milliseconds(wait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  s->m.unlock();
+  return pdTRUE;
+}
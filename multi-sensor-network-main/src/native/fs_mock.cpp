@@ -0,0 +1,60 @@
+// LittleFS and File on a host directory (hal/FS.h, hal/LittleFS.h).
+
+#include "LittleFS.h"
+#include <sys/stat.h>
+
+std::string hostfs_root = ".pio/native_fs";
+LittleFSFS LittleFS;
+
+File::File(const std::string& path, const char* mode) {
+  full = hostfs_root + path;
+  nm = path.substr(path.rfind('/') + 1);
+  struct stat st;
+  if (stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    DIR* dd = opendir(full.c_str());
+    if (dd) d = std::shared_ptr<DIR>(dd, closedir);
+    return;
+  }
+  std::string m = mode;
+  m += "b";
+  FILE* ff = fopen(full.c_str(), m.c_str());
+  if (ff) f = std::shared_ptr<FILE>(ff, fclose);
+}
+
+size_t File::size() {
+  struct stat st;
+  return stat(full.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+File File::openNextFile() {
+  if (!d) return File();
+  while (struct dirent* e = readdir(d.get())) {
+    if (e->d_name[0] == '.') continue;
+    std::string p = full.substr(hostfs_root.size()) + "/" + e->d_name;
+    if (p.rfind("//", 0) == 0) p = p.substr(1);
+    return File(p, "r");
+  }
+  return File();
+}
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*) {
+  mkdir(hostfs_root.c_str(), 0755);
+  struct stat st;
+  return stat(hostfs_root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool LittleFSFS::remove(const char* path) {
+  return ::remove((hostfs_root + path).c_str()) == 0;
+}
+
+size_t LittleFSFS::usedBytes() {
+  size_t n = 0;
+  DIR* dd = opendir(hostfs_root.c_str());
+  if (!dd) return 0;
+  while (struct dirent* e = readdir(dd)) {
+    struct stat st;
+    if (stat((hostfs_root + "/" + e->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) n += st.st_size;
+  }
+  closedir(dd);
+  return n;
+}
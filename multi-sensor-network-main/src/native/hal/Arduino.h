@@ -0,0 +1,124 @@
+#pragma once
+
+// Host stand-in for the Arduino-ESP32 core, for the native env (platformio.ini). Only what the
+// gateway uses; Serial goes to stdout.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+#define GPIO_NUM_2 2
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+
+unsigned long millis();
+unsigned long micros();
+static inline uint32_t esp_random() { return (uint32_t)rand(); }
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+static inline void pinMode(int, int) {}
+static inline void digitalWrite(int, int) {}
+static inline int digitalRead(int) { return LOW; }
+
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(int v) : s_(std::to_string(v)) {}
+  String(unsigned int v) : s_(std::to_string(v)) {}
+  String(long v) : s_(std::to_string(v)) {}
+  String(unsigned long v) : s_(std::to_string(v)) {}
+  String(float v, unsigned int decimals = 2) { char b[32]; snprintf(b, sizeof(b), "%.*f", decimals, v); s_ = b; }
+  String(double v, unsigned int decimals = 2) { char b[32]; snprintf(b, sizeof(b), "%.*f", decimals, v); s_ = b; }
+  const char* c_str() const { return s_.c_str(); }
+  unsigned int length() const { return s_.size(); }
+  bool reserve(unsigned int n) { s_.reserve(n); return true; }
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += o; return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+  bool operator==(const char* o) const { return s_ == o; }
+  bool startsWith(const char* p) const { return s_.rfind(p, 0) == 0; }
+  int indexOf(const char* p, unsigned int from = 0) const { size_t i = s_.find(p, from); return i == std::string::npos ? -1 : (int)i; }
+  int indexOf(char c, unsigned int from = 0) const { size_t i = s_.find(c, from); return i == std::string::npos ? -1 : (int)i; }
+  String substring(unsigned int a) const { return a >= s_.size() ? String() : String(s_.substr(a)); }
+  String substring(unsigned int a, unsigned int b) const { if (a >= s_.size() || b <= a) return String(); return String(s_.substr(a, b - a)); }
+  long toInt() const { return atol(s_.c_str()); }
+private:
+  std::string s_;
+};
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) { o_[0] = a; o_[1] = b; o_[2] = c; o_[3] = d; }
+  String toString() const { char b[16]; snprintf(b, sizeof(b), "%u.%u.%u.%u", o_[0], o_[1], o_[2], o_[3]); return String(b); }
+  uint8_t operator[](int i) const { return o_[i]; }
+private:
+  uint8_t o_[4];
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) { size_t n = 0; while (len--) n += write(*buf++); return n; }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write(s.c_str()); }
+  size_t print(const IPAddress& ip) { return print(ip.toString()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(double v, int d = 2) { return printf("%.*f", d, v); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[512];
+    va_list ap; va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  void flush() { fflush(stdout); }
+  operator bool() const { return true; }
+  size_t write(uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+  size_t write(const uint8_t* b, size_t n) override { return fwrite(b, 1, n, stdout); }
+  using Print::write;
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getFreePsram();
+  uint32_t getMaxAllocPsram();
+  void restart();
+};
+extern EspClass ESP;
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t n) { return malloc(n); }
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
@@ -0,0 +1,26 @@
+#pragma once
+#include <Arduino.h>
+#include <dirent.h>
+#include <memory>
+#include <string>
+
+// Host stand-in for fs::File: files and directories below hostfs_root on the host (--fs)
+extern std::string hostfs_root;
+class File {
+public:
+  File() {}
+  File(const std::string& path, const char* mode);
+  explicit operator bool() const { return f != nullptr || d != nullptr; }
+  const char* name() const { return nm.c_str(); }
+  size_t size();
+  bool seek(size_t pos) { return f && fseek(f.get(), pos, SEEK_SET) == 0; }
+  size_t read(uint8_t* b, size_t n) { return f ? fread(b, 1, n, f.get()) : 0; }
+  size_t write(const uint8_t* b, size_t n) { return f ? fwrite(b, 1, n, f.get()) : 0; }
+  void close() { f.reset(); d.reset(); }
+  File openNextFile();
+private:
+  std::shared_ptr<FILE> f;
+  std::shared_ptr<DIR> d;
+  std::string full, nm;
+};
+namespace fs { using ::File; }
@@ -0,0 +1,4 @@
+#pragma once
+
+// The gateway only needs WiFiClient from here (uplink_client.h speaks HTTP itself)
+#include "WiFiClient.h"
@@ -0,0 +1,13 @@
+#pragma once
+
+// LittleFS on a host directory (FS.h); sized like the "wal" partition in partitions_gateway.csv
+#include "FS.h"
+class LittleFSFS {
+public:
+  bool begin(bool formatOnFail = false, const char* base = "/littlefs", uint8_t maxOpen = 10, const char* label = "spiffs");
+  File open(const char* path, const char* mode = "r") { return File(path, mode); }
+  bool remove(const char* path);
+  size_t usedBytes();
+  size_t totalBytes() { return 0x160000; }
+};
+extern LittleFSFS LittleFS;
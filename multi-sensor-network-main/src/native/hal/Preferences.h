@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for the NVS Preferences library, kept in memory (lost when the process exits)
+#include <stdint.h>
+#include <map>
+#include <string>
+class Preferences {
+public:
+  bool begin(const char* ns, bool = false) { ns_ = ns; return true; }
+  void end() {}
+  uint16_t getUShort(const char* k, uint16_t d = 0) { auto it = store()[ns_ + k]; return it ? it : d; }
+  size_t putUShort(const char* k, uint16_t v) { store()[ns_ + k] = v; return 2; }
+  uint32_t getUInt(const char* k, uint32_t d = 0) { auto it = store()[ns_ + k]; return it ? it : d; }
+  size_t putUInt(const char* k, uint32_t v) { store()[ns_ + k] = v; return 4; }
+private:
+  static std::map<std::string, uint32_t>& store() { static std::map<std::string, uint32_t> s; return s; }
+  std::string ns_;
+};
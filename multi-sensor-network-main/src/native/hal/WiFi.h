@@ -0,0 +1,30 @@
+#pragma once
+
+// Host stand-in for the Arduino WiFi library: always connected, DNS through the host resolver.
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+class WiFiClass {
+public:
+  wl_status_t status() { return status_; }
+  void setStatus(wl_status_t s) { status_ = s; }
+  bool mode(wifi_mode_t) { return true; }
+  void begin(const char*, const char*) { status_ = WL_CONNECTED; }
+  bool disconnect() { return true; }
+  bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress(), IPAddress = IPAddress()) { return true; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  IPAddress gatewayIP() { return IPAddress(127, 0, 0, 1); }
+  IPAddress subnetMask() { return IPAddress(255, 0, 0, 0); }
+  IPAddress dnsIP(int = 0) { return IPAddress(127, 0, 0, 1); }
+  int hostByName(const char* host, IPAddress& out);
+  int32_t channel() { return 1; }
+  uint8_t* macAddress(uint8_t* mac) { static const uint8_t m[6] = {0x24, 0x6F, 0x28, 0xAA, 0xBB, 0xCC}; memcpy(mac, m, 6); return mac; }
+  int8_t RSSI() { return -40; }
+  String SSID() { return String("host"); }
+private:
+  wl_status_t status_ = WL_DISCONNECTED;
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,31 @@
+#pragma once
+
+// WiFiClient on a POSIX TCP socket, so uploads reach a real (local) HTTP server.
+#include "Arduino.h"
+
+class WiFiClient : public Print {
+public:
+  WiFiClient() {}
+  ~WiFiClient() { stop(); }
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+  int connect(const char* host, uint16_t port);
+  int connect(const char* host, uint16_t port, int32_t timeoutMs) { (void)timeoutMs; return connect(host, port); }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t len) override;
+  using Print::write;
+  int available();
+  int read();
+  int read(uint8_t* buf, size_t len);
+  void stop();
+  uint8_t connected();
+  void setTimeout(unsigned long ms) { timeoutMs_ = ms; }
+  void setNoDelay(bool) {}
+  int getWriteError() { return writeError_; }
+  operator bool() { return connected(); }
+private:
+  int fd_ = -1;
+  int writeError_ = 0;
+  unsigned long timeoutMs_ = 1000;
+  int peeked_ = -1;
+};
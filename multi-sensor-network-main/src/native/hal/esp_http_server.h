@@ -0,0 +1,49 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF HTTP server (esp_http_server.h): a thread that accepts one
+// connection at a time, calls the handler registered for the exact path and closes the
+// connection after the response. Request bodies are not read; enough for /metrics.
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "esp_wifi.h"
+
+typedef void* httpd_handle_t;
+typedef enum { HTTP_DELETE = 0, HTTP_GET = 1, HTTP_HEAD = 2, HTTP_POST = 3, HTTP_PUT = 4 } httpd_method_t;
+
+#define HTTPD_RESP_USE_STRLEN -1
+
+typedef struct httpd_req {
+  httpd_handle_t handle;
+  int method;
+  char uri[512];
+  size_t content_len;
+  void* aux;        // Response being built (hal: httpd_mock.cpp)
+  void* user_ctx;
+} httpd_req_t;
+
+typedef struct httpd_uri {
+  const char* uri;
+  httpd_method_t method;
+  esp_err_t (*handler)(httpd_req_t* r);
+  void* user_ctx;
+} httpd_uri_t;
+
+typedef struct {
+  unsigned task_priority;
+  size_t stack_size;
+  int core_id;
+  uint16_t server_port;
+  uint16_t ctrl_port;
+  uint16_t max_uri_handlers;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() { 5, 4096, 0x7FFFFFFF, 80, 32768, 8 }
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri);
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value);
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t len);
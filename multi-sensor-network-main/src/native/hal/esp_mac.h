@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in for esp_mac.h: the gateway gets a fixed, locally administered MAC
+#include <stdint.h>
+typedef enum { ESP_MAC_WIFI_STA, ESP_MAC_WIFI_SOFTAP } esp_mac_type_t;
+int esp_read_mac(uint8_t* mac, esp_mac_type_t type);
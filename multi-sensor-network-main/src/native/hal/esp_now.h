@@ -0,0 +1,47 @@
+#pragma once
+
+// Host stand-in for the ESP-NOW API. There is no radio: frames are handed to the receive callback
+// with hal_espnow_inject(), and sent frames go to hal_espnow_on_send.
+#include <stdint.h>
+#include "esp_wifi.h"
+
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_MAX_DATA_LEN 250
+
+typedef enum { ESP_NOW_SEND_SUCCESS = 0, ESP_NOW_SEND_FAIL } esp_now_send_status_t;
+
+typedef struct esp_now_peer_info {
+  uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+  uint8_t lmk[16];
+  uint8_t channel;
+  wifi_interface_t ifidx;
+  bool encrypt;
+  void* priv;
+} esp_now_peer_info_t;
+
+typedef struct esp_now_recv_info {
+  uint8_t* src_addr;
+  uint8_t* des_addr;
+  wifi_pkt_rx_ctrl_t* rx_ctrl;
+} esp_now_recv_info_t;
+
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac, esp_now_send_status_t status);
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+typedef void (*esp_now_recv_cb_t)(const esp_now_recv_info_t* info, const uint8_t* data, int len);
+#else
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac, const uint8_t* data, int len);
+#endif
+
+esp_err_t esp_now_init(void);
+esp_err_t esp_now_deinit(void);
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_send(const uint8_t* peer, const uint8_t* data, size_t len);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_del_peer(const uint8_t* peer);
+bool esp_now_is_peer_exist(const uint8_t* peer);
+
+// Host hooks (src/native/hal_mock.cpp)
+void hal_espnow_inject(const uint8_t mac[6], const uint8_t* data, int len, int rssi);
+// Called for every send; returns the status reported to the send callback (unicast only)
+extern esp_now_send_status_t (*hal_espnow_on_send)(const uint8_t* peer, const uint8_t* data, size_t len);
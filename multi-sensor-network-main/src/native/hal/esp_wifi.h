@@ -0,0 +1,48 @@
+#pragma once
+
+// Host stand-in for the parts of esp_wifi.h the gateway uses. Promiscuous mode is accepted but
+// never delivers packets; the channel is only remembered.
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_NOT_FOUND 0x105
+
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+typedef enum { WIFI_SECOND_CHAN_NONE = 0, WIFI_SECOND_CHAN_ABOVE, WIFI_SECOND_CHAN_BELOW } wifi_second_chan_t;
+typedef enum { WIFI_PKT_MGMT, WIFI_PKT_CTRL, WIFI_PKT_DATA, WIFI_PKT_MISC } wifi_promiscuous_pkt_type_t;
+
+#define WIFI_PROMIS_FILTER_MASK_ALL 0xFFFFFFFF
+#define WIFI_PROMIS_FILTER_MASK_MGMT (1)
+#define WIFI_PROMIS_FILTER_MASK_CTRL (1 << 1)
+#define WIFI_PROMIS_FILTER_MASK_DATA (1 << 2)
+
+typedef struct { uint32_t filter_mask; } wifi_promiscuous_filter_t;
+
+typedef struct {
+  signed rssi : 8;
+  unsigned rate : 5;
+  unsigned channel : 4;
+  unsigned sig_len : 12;
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct {
+  wifi_pkt_rx_ctrl_t rx_ctrl;
+  uint8_t payload[0];
+} wifi_promiscuous_pkt_t;
+
+typedef void (*wifi_promiscuous_cb_t)(void* buf, wifi_promiscuous_pkt_type_t type);
+
+esp_err_t esp_wifi_set_promiscuous(bool en);
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb);
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t* filter);
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second);
+
+// Host hooks (src/native/hal_mock.cpp): current channel, and a callback on every channel change
+uint8_t hal_channel();
+extern void (*hal_on_set_channel)(uint8_t channel);
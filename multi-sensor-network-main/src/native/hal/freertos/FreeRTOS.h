@@ -0,0 +1,22 @@
+#pragma once
+
+// Host stand-in for FreeRTOS: tasks are std::threads, ticks are milliseconds
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void*);
+struct hal_task;
+typedef hal_task* TaskHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskIDLE_PRIORITY 0
+#define configMAX_PRIORITIES 25
+#define ARDUINO_RUNNING_CORE 1
@@ -0,0 +1,9 @@
+#pragma once
+
+// Mutex semaphores on std::timed_mutex
+#include "FreeRTOS.h"
+struct hal_sem;
+typedef hal_sem* SemaphoreHandle_t;
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s);
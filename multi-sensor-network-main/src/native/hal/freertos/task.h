@@ -0,0 +1,15 @@
+#pragma once
+
+// Task API on std::thread (src/native/freertos_mock.cpp); priorities and cores are ignored
+#include "FreeRTOS.h"
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* out, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                       UBaseType_t prio, TaskHandle_t* out);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t t);
+TickType_t xTaskGetTickCount(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t t);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t t);
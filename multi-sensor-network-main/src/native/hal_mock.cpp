@@ -0,0 +1,218 @@
+// Host implementation of the Arduino core, WiFi, WiFiClient and ESP-NOW stand-ins in hal/.
+#include "Arduino.h"
+#include "WiFi.h"
+#include "esp_now.h"
+#include "esp_mac.h"
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <set>
+#include <string>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+EspClass ESP;
+
+static const auto g_boot = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - g_boot).count();
+}
+unsigned long micros() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_boot).count();
+}
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+uint32_t EspClass::getFreeHeap() { return 256 * 1024; }
+uint32_t EspClass::getMinFreeHeap() { return 200 * 1024; }
+uint32_t EspClass::getMaxAllocHeap() { return 128 * 1024; }
+uint32_t EspClass::getFreePsram() { return 1024 * 1024; }
+uint32_t EspClass::getMaxAllocPsram() { return 1024 * 1024; }
+void EspClass::restart() { fprintf(stderr, "ESP.restart() called\n"); exit(1); }
+
+int esp_read_mac(uint8_t* mac, esp_mac_type_t) {
+  static const uint8_t host_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+  memcpy(mac, host_mac, 6);
+  return 0;
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& out) {
+  struct addrinfo hints = {}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  if (getaddrinfo(host, nullptr, &hints, &res) != 0 || !res) return 0;
+  const uint8_t* a = (const uint8_t*)&((struct sockaddr_in*)res->ai_addr)->sin_addr;
+  out = IPAddress(a[0], a[1], a[2], a[3]);
+  freeaddrinfo(res);
+  return 1;
+}
+
+// ---- WiFiClient ----
+int WiFiClient::connect(const char* host, uint16_t port) {
+  stop();
+  char portStr[8];
+  snprintf(portStr, sizeof(portStr), "%u", port);
+  struct addrinfo hints = {}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, portStr, &hints, &res) != 0 || !res) return 0;
+  fd_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (fd_ >= 0 && ::connect(fd_, res->ai_addr, res->ai_addrlen) != 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  freeaddrinfo(res);
+  if (fd_ < 0) return 0;
+  int one = 1;
+  setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return 1;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t len) {
+  if (fd_ < 0) { writeError_ = 1; return 0; }
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = ::send(fd_, buf + done, len - done, MSG_NOSIGNAL);
+    if (n <= 0) { writeError_ = 1; break; }
+    done += (size_t)n;
+  }
+  return done;
+}
+
+int WiFiClient::available() {
+  if (fd_ < 0) return peeked_ >= 0 ? 1 : 0;
+  int n = 0;
+  if (ioctl(fd_, FIONREAD, &n) != 0) n = 0;
+  return n + (peeked_ >= 0 ? 1 : 0);
+}
+
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t* buf, size_t len) {
+  if (len == 0) return 0;
+  size_t off = 0;
+  if (peeked_ >= 0) { buf[0] = (uint8_t)peeked_; peeked_ = -1; off = 1; if (len == 1) return 1; }
+  if (fd_ < 0) return off ? (int)off : -1;
+  ssize_t n = ::recv(fd_, buf + off, len - off, MSG_DONTWAIT);
+  if (n == 0) { ::close(fd_); fd_ = -1; return off ? (int)off : -1; }
+  if (n < 0) return off ? (int)off : -1;
+  return (int)(n + off);
+}
+
+void WiFiClient::stop() {
+  if (fd_ >= 0) ::close(fd_);
+  fd_ = -1;
+  peeked_ = -1;
+}
+
+uint8_t WiFiClient::connected() {
+  if (fd_ < 0) return 0;
+  struct pollfd p = {fd_, POLLIN, 0};
+  if (poll(&p, 1, 0) > 0 && (p.revents & POLLIN)) {
+    uint8_t c;
+    ssize_t n = ::recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0) { ::close(fd_); fd_ = -1; return available() > 0; }
+  }
+  if (p.revents & (POLLHUP | POLLERR)) { ::close(fd_); fd_ = -1; return 0; }
+  return 1;
+}
+
+// ---- ESP-NOW ----
+// The receive callback runs in the Wi-Fi task on the ESP32, one frame at a time; injected frames
+// are serialized the same way, whichever thread injects them.
+
+static esp_now_send_cb_t g_send_cb = nullptr;
+static esp_now_recv_cb_t g_recv_cb = nullptr;
+static std::mutex g_recv_lock;
+static std::mutex g_peer_lock;
+static std::set<std::string> g_peers;
+static uint8_t g_channel = 1;
+
+esp_now_send_status_t (*hal_espnow_on_send)(const uint8_t* peer, const uint8_t* data, size_t len) = nullptr;
+void (*hal_on_set_channel)(uint8_t channel) = nullptr;
+
+static std::string peerKey(const uint8_t* mac) {
+  return std::string((const char*)mac, ESP_NOW_ETH_ALEN);
+}
+
+esp_err_t esp_now_init(void) { return ESP_OK; }
+esp_err_t esp_now_deinit(void) { return ESP_OK; }
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) { g_send_cb = cb; return ESP_OK; }
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) { g_recv_cb = cb; return ESP_OK; }
+
+esp_err_t esp_now_send(const uint8_t* peer, const uint8_t* data, size_t len) {
+  if (len > ESP_NOW_MAX_DATA_LEN) return ESP_ERR_INVALID_ARG;
+  if (!esp_now_is_peer_exist(peer)) return ESP_ERR_NOT_FOUND;
+  esp_now_send_status_t st = ESP_NOW_SEND_SUCCESS;
+  if (hal_espnow_on_send) st = hal_espnow_on_send(peer, data, len);
+  if (peer[0] == 0xFF) st = ESP_NOW_SEND_SUCCESS;   // Broadcasts are never acknowledged
+  if (g_send_cb) g_send_cb(peer, st);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) {
+  std::lock_guard<std::mutex> g(g_peer_lock);
+  g_peers.insert(peerKey(peer->peer_addr));
+  return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t* peer) {
+  std::lock_guard<std::mutex> g(g_peer_lock);
+  return g_peers.erase(peerKey(peer)) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+bool esp_now_is_peer_exist(const uint8_t* peer) {
+  std::lock_guard<std::mutex> g(g_peer_lock);
+  return g_peers.count(peerKey(peer)) != 0;
+}
+
+void hal_espnow_inject(const uint8_t mac[6], const uint8_t* data, int len, int rssi) {
+  std::lock_guard<std::mutex> g(g_recv_lock);
+  if (!g_recv_cb) return;
+  uint8_t src[6], dst[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  memcpy(src, mac, 6);
+  wifi_pkt_rx_ctrl_t ctrl = {};
+  ctrl.rssi = rssi;
+  ctrl.channel = g_channel;
+  ctrl.sig_len = len;
+  esp_now_recv_info_t info = {src, dst, &ctrl};
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+  g_recv_cb(&info, data, len);
+#else
+  g_recv_cb(src, data, len);
+#endif
+}
+
+// ---- Wi-Fi driver ----
+
+esp_err_t esp_wifi_set_promiscuous(bool) { return ESP_OK; }
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t) { return ESP_OK; }
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t*) { return ESP_OK; }
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t) {
+  g_channel = primary;
+  if (hal_on_set_channel) hal_on_set_channel(primary);
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_channel(uint8_t* primary, wifi_second_chan_t* second) {
+  *primary = g_channel;
+  if (second) *second = WIFI_SECOND_CHAN_NONE;
+  return ESP_OK;
+}
+
+uint8_t hal_channel() {
+  return g_channel;
+}
@@ -0,0 +1,141 @@
+// ESP-IDF HTTP server on host sockets (hal/esp_http_server.h).
+
+#include "esp_http_server.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct MockServer {
+  int fd;
+  std::vector<httpd_uri_t> handlers;
+};
+
+struct MockResponse {
+  std::string type = "text/html";
+  std::string headers;
+  std::string body;
+  bool done = false;
+};
+
+static void writeAll(int fd, const std::string& s) {
+  size_t off = 0;
+  while (off < s.size()) {
+    ssize_t n = send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+    if (n <= 0) return;
+    off += n;
+  }
+}
+
+static void reply(int fd, const char* status, const MockResponse& resp) {
+  char head[256];
+  snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n",
+           status, resp.type.c_str(), resp.body.size());
+  writeAll(fd, std::string(head) + resp.headers + "\r\n" + resp.body);
+}
+
+static void serve(MockServer* srv) {
+  for (;;) {
+    int c = accept(srv->fd, nullptr, nullptr);
+    if (c < 0) continue;
+    std::string req;
+    char buf[1024];
+    while (req.find("\r\n\r\n") == std::string::npos && req.size() < 16384) {
+      ssize_t n = recv(c, buf, sizeof(buf), 0);
+      if (n <= 0) break;
+      req.append(buf, n);
+    }
+    char method[16] = "", path[512] = "";
+    sscanf(req.c_str(), "%15s %511s", method, path);
+    char* query = strchr(path, '?');
+    if (query) *query = 0;
+
+    httpd_req_t r = {};
+    MockResponse resp;
+    r.handle = srv;
+    r.method = strcmp(method, "GET") == 0 ? HTTP_GET : strcmp(method, "POST") == 0 ? HTTP_POST : -1;
+    snprintf(r.uri, sizeof(r.uri), "%s", path);
+    r.aux = &resp;
+    const httpd_uri_t* h = nullptr;
+    for (const httpd_uri_t& u : srv->handlers) {
+      if ((int)u.method == r.method && strcmp(u.uri, path) == 0) h = &u;
+    }
+    if (!h) {
+      resp.type = "text/plain";
+      resp.body = "Not found\n";
+      reply(c, "404 Not Found", resp);
+    } else {
+      r.user_ctx = h->user_ctx;
+      if (h->handler(&r) == ESP_OK) {
+        reply(c, "200 OK", resp);
+      } else {
+        resp.type = "text/plain";
+        resp.body = "Handler failed\n";
+        reply(c, "500 Internal Server Error", resp);
+      }
+    }
+    close(c);
+  }
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return ESP_FAIL;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(config->server_port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+    close(fd);
+    return ESP_FAIL;
+  }
+  MockServer* srv = new MockServer();
+  srv->fd = fd;
+  *handle = srv;
+  std::thread(serve, srv).detach();
+  return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t) {
+  return ESP_OK;   // The server thread runs until exit
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri) {
+  if (!handle || !uri) return ESP_ERR_INVALID_ARG;
+  // Registered once at startup, before the first request (no lock, as on the device)
+  ((MockServer*)handle)->handlers.push_back(*uri);
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* r, const char* type) {
+  ((MockResponse*)r->aux)->type = type;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* r, const char* field, const char* value) {
+  ((MockResponse*)r->aux)->headers += std::string(field) + ": " + value + "\r\n";
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* r, const char* buf, ssize_t len) {
+  MockResponse* resp = (MockResponse*)r->aux;
+  if (!buf) {
+    resp->done = true;
+    return ESP_OK;
+  }
+  if (resp->done) return ESP_FAIL;
+  resp->body.append(buf, len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)len);
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* r, const char* buf, ssize_t len) {
+  if (buf) httpd_resp_send_chunk(r, buf, len);
+  return httpd_resp_send_chunk(r, nullptr, 0);
+}
@@ -0,0 +1,190 @@
+// Host entry point of the native env (platformio.ini): runs the gateway firmware, src/gateway/main.cpp
+// and include/espnow_comm.h unchanged, as a Linux program. The stand-ins in hal/ replace the
+// Arduino core, Wi-Fi, ESP-NOW and FreeRTOS; uploads go over real TCP to a local ingest server, so
+// the whole receive -> queue -> uplink task -> HTTP path runs, under perf or the sanitizers.
+//
+// Start the local server first (gateway-server/, see LOCAL_SERVER_SETUP.md):
+//   cd gateway-server && npm install && npm start          (listens on port 3000)
+// then:
+//   pio run -e native && .pio/build/native/program --stations 20 --duration 60
+//   pio run -e native-asan && .pio/build/native-asan/program
+//
+// Simulated stations stand in for the radio: every station sends a numbered sensor_msg frame every
+// --interval seconds (spread over the interval), from its own MAC, injected into the ESP-NOW receive
+// callback from a separate thread like the Wi-Fi task does on the ESP32. Options:
+//   --stations N    number of stations (default 10)
+//   --interval S    seconds between readings of one station (default MEASUREMENT_INTERVAL)
+//   --duration S    run time before the summary and exit (default 60, 0 = forever)
+//   --fs DIR        host directory that stands in for the LittleFS partition (default .pio/native_fs)
+//
+// At the end the stations stop, the uplink gets time to drain, and the run checks itself: every
+// frame received in order (no loss, no duplicates on the links) and every upload of this run acked
+// once by the server (live: one per reading, aggregate: one per closed window). The exit status is
+// 0 if it all adds up, 1 otherwise, so the env works as a smoke test in CI.
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// The gateway sketch itself, built into this file: config.h defines globals, so it can only be in
+// one translation unit (build_src_filter leaves src/gateway/ out of the native env)
+#include "../gateway/main.cpp"
+
+extern std::string hostfs_root;   // fs_mock.cpp
+
+static std::atomic<uint32_t> framesInjected(0);
+static std::atomic<uint32_t> acksSent(0);
+static std::atomic<uint32_t> beaconsSent(0);
+static std::atomic<bool> stationsStop(false);
+
+// Server answers per uploaded record (uplinkResultHook, called by the uplink task)
+static std::mutex resultLock;
+static std::set<uint32_t> ackedSeqs;   // WAL sequence numbers acked so far (0: WAL not mounted)
+static uint32_t firstSeq = 0;          // First WAL sequence number of this run
+static uint32_t acked = 0;             // Records of this run acked by the server
+static uint32_t ackedTwice = 0;
+static uint32_t rejected = 0;          // 4xx: dropped by the gateway
+static uint32_t failed = 0;            // Network error or 5xx: retried from the backlog
+static uint32_t recovered = 0;         // Acked records from the WAL of an earlier run
+
+static void onUplinkResult(const uplink_record& rec, int httpCode) {
+  std::lock_guard<std::mutex> g(resultLock);
+  UplinkResult r = uplinkResult(httpCode);
+  if (r == UPLINK_RESULT_REJECTED) rejected++;
+  else if (r == UPLINK_RESULT_FAILED) failed++;
+  else if (rec.seq && rec.seq < firstSeq) recovered++;
+  else if (rec.seq && !ackedSeqs.insert(rec.seq).second) ackedTwice++;
+  else acked++;
+}
+
+// Records the uplink should have sent by now
+static uint32_t expectedUploads() {
+#if UPLINK_MODE == UPLINK_MODE_AGGREGATE
+  return aggregator.windows;   // One summary per closed window; open windows are not due yet
+#else
+  return metricGet(gatewayMetrics.readings);
+#endif
+}
+
+// Frames the gateway sends (ACKs, beacons); nobody receives them
+static esp_now_send_status_t onGatewaySend(const uint8_t* peer, const uint8_t* data, size_t len) {
+  (void)peer;
+  if (len > 0 && data[0] == MSG_TYPE_ACK) acksSent++;
+  if (len > 0 && data[0] == MSG_TYPE_BEACON) beaconsSent++;
+  return ESP_NOW_SEND_SUCCESS;
+}
+
+// One thread plays all stations: station i sends at i/N of every interval
+static void runStations(int stations, uint32_t intervalMs) {
+  uint32_t start = millis();
+  for (uint32_t round = 0;; ++round) {
+    for (int i = 0; i < stations; ++i) {
+      uint32_t due = start + round * intervalMs + (uint32_t)((uint64_t)intervalMs * i / stations);
+      int32_t wait = (int32_t)(due - millis());
+      if (wait > 0) delay(wait);
+      if (stationsStop) return;
+
+      sensor_msg msg = {};
+      msg.temperature = 20.0f + (i % 50) / 10.0f + (esp_random() % 100) / 100.0f;
+      msg.co2 = round % 3 ? CO2_NONE : 420 + (esp_random() % 400);   // Like SCD41_CO2_EVERY 3
+      msg.humidity = 40.0f + (esp_random() % 2000) / 100.0f;
+      msg.boot = 1;
+      msg.seq = round;
+      msg.uptime_s = (millis() - start) / 1000;
+      uint8_t frame[ESPNOW_MAX_FRAME];
+      size_t len = wireEncode(msg, frame, sizeof(frame));
+      uint8_t mac[6] = {0x24, 0x6F, 0x28, 0x00, (uint8_t)(i >> 8), (uint8_t)i};
+      hal_espnow_inject(mac, frame, (int)len, -40 - (int)(esp_random() % 45));
+      framesInjected++;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  int stations = 10;
+  uint32_t intervalS = MEASUREMENT_INTERVAL;
+  uint32_t durationS = 60;
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    if (strcmp(a, "--stations") == 0 && i + 1 < argc) stations = atoi(argv[++i]);
+    else if (strcmp(a, "--interval") == 0 && i + 1 < argc) intervalS = atoi(argv[++i]);
+    else if (strcmp(a, "--duration") == 0 && i + 1 < argc) durationS = atoi(argv[++i]);
+    else if (strcmp(a, "--fs") == 0 && i + 1 < argc) hostfs_root = argv[++i];
+    else {
+      fprintf(stderr, "usage: %s [--stations N] [--interval S] [--duration S] [--fs DIR]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (stations < 1 || stations > 65535 || intervalS < 1) {
+    fprintf(stderr, "need 1..65535 stations and an interval of at least 1 s\n");
+    return 1;
+  }
+
+  hal_espnow_on_send = onGatewaySend;
+  uplinkResultHook = onUplinkResult;
+  setup();
+  firstSeq = uplinkWal.nextSeq();
+
+  LOG_PRINTF("[native] %d simulated stations, one reading each every %u s, upload to %s\n",
+             stations, intervalS, SUPABASE_EDGE_FUNCTION_URL);
+  std::thread stationThread(runStations, stations, intervalS * 1000);
+
+  // loopTask on the ESP32 calls loop() back to back; 1 ms apart here so the host core is not pinned
+  uint32_t start = millis();
+  while (durationS == 0 || millis() - start < durationS * 1000) {
+    loop();
+    delay(1);
+  }
+
+  // Drain: the last live batch goes out after UPLINK_BATCH_MAX_AGE_MS, readings parked in the
+  // backlog after a failed POST are retried UPLINK_REPLAY_RETRY_MS later
+  stationsStop = true;
+  stationThread.join();
+  uint32_t drainStart = millis();
+  for (;;) {
+    bool done;
+    {
+      std::lock_guard<std::mutex> g(resultLock);
+      done = acked + rejected >= expectedUploads();
+    }
+    if ((done && uplinkBacklog.size() == 0) ||
+        millis() - drainStart > UPLINK_BATCH_MAX_AGE_MS + 2 * UPLINK_REPLAY_RETRY_MS) break;
+    loop();
+    delay(10);
+  }
+
+  LOG_PRINTF("\n[native] %u frames injected in %u s, gateway sent %u ACKs and %u beacons\n",
+             framesInjected.load(), durationS, acksSent.load(), beaconsSent.load());
+  printRegisteredStations();
+  printLinkStats();
+  printUplinkQueueStats();
+
+  // Self-check
+  uint32_t received = 0, lost = 0, duplicates = 0;
+  for (int i = 0; i < ::stations.size(); ++i) {   // The registry, not the option
+    received += ::stations[i].link.received;
+    lost += ::stations[i].link.lost;
+    duplicates += ::stations[i].link.duplicates;
+  }
+  std::lock_guard<std::mutex> g(resultLock);
+  uint32_t expected = expectedUploads();
+  bool ok = true;
+  if (received != framesInjected || lost || duplicates) {
+    LOG_PRINTF("[native] FAIL: %u frames injected, %u received, %u lost, %u duplicates\n",
+               framesInjected.load(), received, lost, duplicates);
+    ok = false;
+  }
+  if (acked != expected || ackedTwice || rejected) {
+    LOG_PRINTF("[native] FAIL: %u uploads due, %u acked, %u acked twice, %u rejected\n",
+               expected, acked, ackedTwice, rejected);
+    ok = false;
+  }
+  LOG_PRINTF("[native] %s: %u uploads acked (%u failed attempts retried, %u recovered from an earlier run)\n",
+             ok ? "PASS" : "FAIL", acked, failed, recovered);
+  LOG_FLUSH();
+  // The uplink task never returns; leave without running static destructors under it
+  _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,348 @@
+// Gateway pipeline benchmark (env:native-bench in platformio.ini): the native gateway build
+// (src/native/) with a load generator and a mock ingest server instead of simulated stations.
+// Frames are injected into OnDataRecv at a fixed rate, and every reading is timed from receive to
+// the server's answer to the POST that carried it. Results go to stdout as one JSON object, the
+// gateway's own Serial output goes to --log.
+//
+//   pio run -e native-bench && .pio/build/native-bench/program --rate 200 --duration 30
+//   .pio/build/native-bench/program --rate 500 --server-latency-ms 150 --fail-rate 0.05 > run.json
+//
+// The mock server listens on the port of SUPABASE_EDGE_FUNCTION_URL (127.0.0.1:3901 in this env)
+// in the same process, answers every POST after --server-latency-ms (+- --server-jitter-ms) with
+// 200, or with 503 (--fail-rate) or by closing the connection without an answer (--reset-rate).
+// Options:
+//   --rate N                frames per second into OnDataRecv, all stations together (default 100)
+//   --stations N            distinct station MACs, sending round robin (default 100, NUM_STATIONS max)
+//   --warmup S              seconds of load before the measurement starts (default 5)
+//   --duration S            measured seconds of load (default 30)
+//   --drain S               max seconds to wait for outstanding readings after the load (default 30)
+//   --server-latency-ms N   mock server response time (default 20)
+//   --server-jitter-ms N    uniform +- on top of it (default 0)
+//   --fail-rate P           share of POSTs answered 503 (default 0)
+//   --reset-rate P          share of POSTs whose connection is closed without an answer (default 0)
+//   --seed N                payloads and server failures (default 1)
+//   --log FILE              gateway Serial output (default /dev/null)
+//   --fs DIR                LittleFS stand-in, emptied at start (default .pio/native_bench_fs)
+//
+// Latency is in whole milliseconds (uplink_record.rx_ms is millis()); with the default batching
+// it is dominated by UPLINK_BATCH_MAX_AGE_MS and UPLINK_BATCH_MAX_COUNT anyway.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "../gateway/main.cpp"
+
+extern std::string hostfs_root;   // fs_mock.cpp
+
+// ---- Mock ingest server ----
+
+struct ServerParams {
+  uint32_t latencyMs = 20;
+  uint32_t jitterMs = 0;
+  double failRate = 0;
+  double resetRate = 0;
+};
+
+static ServerParams server;
+static std::mutex serverLock;
+static std::mt19937 serverRng;
+static std::atomic<uint32_t> serverRequests(0);
+static std::atomic<uint32_t> serverFailed(0);
+static std::atomic<uint32_t> serverReset(0);
+static std::atomic<uint64_t> serverBodyBytes(0);
+
+// One keep-alive connection: read header + body, wait, answer (or hang up)
+static void serveConnection(int fd) {
+  std::string in;
+  char buf[4096];
+  for (;;) {
+    size_t hdrEnd;
+    while ((hdrEnd = in.find("\r\n\r\n")) == std::string::npos) {
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) { close(fd); return; }
+      in.append(buf, n);
+    }
+    size_t bodyLen = 0;
+    size_t cl = in.find("Content-Length:");
+    if (cl != std::string::npos && cl < hdrEnd) bodyLen = strtoul(in.c_str() + cl + 15, NULL, 10);
+    while (in.size() < hdrEnd + 4 + bodyLen) {
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) { close(fd); return; }
+      in.append(buf, n);
+    }
+    in.erase(0, hdrEnd + 4 + bodyLen);
+    serverRequests++;
+    serverBodyBytes += bodyLen;
+
+    uint32_t wait;
+    double fate;
+    {
+      std::lock_guard<std::mutex> g(serverLock);
+      int32_t jitter = server.jitterMs ? (int32_t)(serverRng() % (2 * server.jitterMs + 1)) - (int32_t)server.jitterMs : 0;
+      wait = (int32_t)server.latencyMs + jitter > 0 ? server.latencyMs + jitter : 0;
+      fate = std::uniform_real_distribution<double>(0, 1)(serverRng);
+    }
+    if (wait) delay(wait);
+    if (fate < server.resetRate) {
+      serverReset++;
+      close(fd);
+      return;
+    }
+    const char* reply;
+    if (fate < server.resetRate + server.failRate) {
+      serverFailed++;
+      reply = "HTTP/1.1 503 Service Unavailable\r\nContent-Type: application/json\r\nContent-Length: 15\r\n\r\n{\"ok\":false}   ";
+    } else {
+      reply = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 11\r\n\r\n{\"ok\":true}";
+    }
+    if (send(fd, reply, strlen(reply), MSG_NOSIGNAL) <= 0) { close(fd); return; }
+  }
+}
+
+static bool startServer(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+    close(fd);
+    return false;
+  }
+  std::thread([fd]() {
+    for (;;) {
+      int c = accept(fd, NULL, NULL);
+      if (c >= 0) std::thread(serveConnection, c).detach();
+    }
+  }).detach();
+  return true;
+}
+
+// ---- Measurement ----
+
+static std::mutex resultLock;
+static std::vector<uint32_t> ackLatencyMs;   // Readings received after the warm-up, acked with 2xx
+static bool measureStarted = false;
+static uint32_t measureFromMs = 0;
+static uint32_t uploadsOk = 0, uploadsRejected = 0, uploadsFailed = 0;   // Readings per upload attempt
+static uint32_t warmupAcked = 0;
+
+static void onUplinkResult(const uplink_record& rec, int httpCode) {
+  uint32_t now = millis();
+  std::lock_guard<std::mutex> g(resultLock);
+  if (httpCode >= 200 && httpCode < 300) {
+    uploadsOk++;
+    if (measureStarted && (int32_t)(rec.rx_ms - measureFromMs) >= 0) ackLatencyMs.push_back(now - rec.rx_ms);
+    else warmupAcked++;
+  } else if (httpCode >= 400 && httpCode < 500) {
+    uploadsRejected++;
+  } else {
+    uploadsFailed++;
+  }
+}
+
+static esp_now_send_status_t onGatewaySend(const uint8_t*, const uint8_t*, size_t) {
+  return ESP_NOW_SEND_SUCCESS;
+}
+
+static double quantile(const std::vector<uint32_t>& sorted, double q) {
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)(q * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+static double quantile(std::vector<double>& v, double q) {
+  if (v.empty()) return 0;
+  size_t i = (size_t)(q * (v.size() - 1) + 0.5);
+  std::nth_element(v.begin(), v.begin() + i, v.end());
+  return v[i];
+}
+
+int main(int argc, char** argv) {
+  double rate = 100;
+  int stationCount = 100;
+  double warmupS = 5, durationS = 30, drainS = 30;
+  uint32_t seed = 1;
+  const char* logPath = "/dev/null";
+  hostfs_root = ".pio/native_bench_fs";
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : NULL;
+    if (!v) a = "";
+    if (strcmp(a, "--rate") == 0) rate = atof(v);
+    else if (strcmp(a, "--stations") == 0) stationCount = atoi(v);
+    else if (strcmp(a, "--warmup") == 0) warmupS = atof(v);
+    else if (strcmp(a, "--duration") == 0) durationS = atof(v);
+    else if (strcmp(a, "--drain") == 0) drainS = atof(v);
+    else if (strcmp(a, "--server-latency-ms") == 0) server.latencyMs = atoi(v);
+    else if (strcmp(a, "--server-jitter-ms") == 0) server.jitterMs = atoi(v);
+    else if (strcmp(a, "--fail-rate") == 0) server.failRate = atof(v);
+    else if (strcmp(a, "--reset-rate") == 0) server.resetRate = atof(v);
+    else if (strcmp(a, "--seed") == 0) seed = strtoul(v, NULL, 10);
+    else if (strcmp(a, "--log") == 0) logPath = v;
+    else if (strcmp(a, "--fs") == 0) hostfs_root = v;
+    else {
+      fprintf(stderr,
+              "usage: %s [--rate N] [--stations N] [--warmup S] [--duration S] [--drain S]\n"
+              "          [--server-latency-ms N] [--server-jitter-ms N] [--fail-rate P] [--reset-rate P]\n"
+              "          [--seed N] [--log FILE] [--fs DIR]\n", argv[0]);
+      return 1;
+    }
+    ++i;
+  }
+  if (rate <= 0 || durationS <= 0 || stationCount < 1 || stationCount > NUM_STATIONS) {
+    fprintf(stderr, "need --rate > 0, --duration > 0 and 1..%d stations\n", NUM_STATIONS);
+    return 1;
+  }
+
+  // Same run, same numbers: fresh flash (no WAL recovery), fixed seeds
+  std::error_code ec;
+  std::filesystem::remove_all(hostfs_root, ec);
+  srand(seed);
+  serverRng.seed(seed);
+
+  uint16_t port = uplinkClient.endpoint().port;
+  if (!startServer(port)) {
+    fprintf(stderr, "mock ingest server: cannot listen on 127.0.0.1:%u\n", port);
+    return 1;
+  }
+
+  // stdout is for the JSON; the gateway's Serial output goes to the log
+  FILE* out = fdopen(dup(fileno(stdout)), "w");
+  if (!freopen(logPath, "w", stdout)) {
+    fprintf(stderr, "cannot open %s\n", logPath);
+    return 1;
+  }
+
+  hal_espnow_on_send = onGatewaySend;
+  uplinkResultHook = onUplinkResult;
+  setup();
+  std::thread([]() {
+    for (;;) {
+      loop();
+      delay(1);
+    }
+  }).detach();
+
+  // Load: frame k comes from station k % N at start + k / rate, injected late rather than
+  // dropped when OnDataRecv falls behind (so the achieved rate shows saturation)
+  std::vector<uint32_t> seq(stationCount, 0);
+  std::vector<double> recvUs;
+  recvUs.reserve((size_t)(rate * durationS) + 16);
+  uint64_t injected = 0, measured = 0;
+  uint32_t droppedBefore = 0;
+  double maxLagMs = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  auto measureStart = t0 + std::chrono::microseconds((int64_t)(warmupS * 1e6));
+  auto end = measureStart + std::chrono::microseconds((int64_t)(durationS * 1e6));
+  bool measuring = false;
+  for (uint64_t k = 0;; ++k) {
+    auto due = t0 + std::chrono::microseconds((int64_t)(k * 1e6 / rate));
+    if (due >= end) break;
+    auto now = std::chrono::steady_clock::now();
+    if (due > now) std::this_thread::sleep_until(due);
+    else if (measuring) maxLagMs = std::max(maxLagMs, std::chrono::duration<double, std::milli>(now - due).count());
+    if (!measuring && due >= measureStart) {
+      measuring = true;
+      droppedBefore = uplinkQueue.dropCount();
+      std::lock_guard<std::mutex> g(resultLock);
+      measureFromMs = millis();
+      measureStarted = true;
+    }
+
+    int i = (int)(k % stationCount);
+    sensor_msg msg = {};
+    msg.temperature = 20.0f + (esp_random() % 1000) / 100.0f;
+    msg.co2 = 420 + (esp_random() % 400);
+    msg.humidity = 40.0f + (esp_random() % 2000) / 100.0f;
+    msg.boot = 1;
+    msg.seq = ++seq[i];
+    msg.uptime_s = millis() / 1000;
+    uint8_t frame[ESPNOW_MAX_FRAME];
+    size_t len = wireEncode(msg, frame, sizeof(frame));
+    uint8_t mac[6] = {0x24, 0x6F, 0x28, 0x00, (uint8_t)(i >> 8), (uint8_t)i};
+    unsigned long before = micros();
+    hal_espnow_inject(mac, frame, (int)len, -40 - (int)(esp_random() % 45));
+    unsigned long took = micros() - before;
+    injected++;
+    if (measuring) {
+      measured++;
+      recvUs.push_back(took);
+    }
+  }
+  double loadS = std::chrono::duration<double>(std::chrono::steady_clock::now() - measureStart).count();
+  uint32_t queueDrops = uplinkQueue.dropCount() - droppedBefore;
+
+  // Drain: wait until every measured reading is acked (or lost for good), at most --drain seconds
+  uint32_t drainStart = millis();
+  for (;;) {
+    size_t acked;
+    {
+      std::lock_guard<std::mutex> g(resultLock);
+      acked = ackLatencyMs.size();
+    }
+    if (acked + queueDrops + uplinkBacklog.overwritten >= measured) break;
+    if (millis() - drainStart >= drainS * 1000) break;
+    delay(10);
+  }
+  double drainedS = (millis() - drainStart) / 1000.0;
+
+  std::vector<uint32_t> lat;
+  uint32_t ok, rejected, failed;
+  {
+    std::lock_guard<std::mutex> g(resultLock);
+    lat = ackLatencyMs;
+    ok = uploadsOk;
+    rejected = uploadsRejected;
+    failed = uploadsFailed;
+  }
+  std::sort(lat.begin(), lat.end());
+  double meanLat = 0;
+  for (uint32_t l : lat) meanLat += l;
+  if (!lat.empty()) meanLat /= lat.size();
+
+  LOG_FLUSH();
+  fprintf(out,
+          "{\n"
+          "  \"config\": {\"rate\": %.1f, \"stations\": %d, \"warmup_s\": %.1f, \"duration_s\": %.1f, "
+          "\"server_latency_ms\": %u, \"server_jitter_ms\": %u, \"fail_rate\": %.4f, \"reset_rate\": %.4f, "
+          "\"seed\": %u, \"batch_max_count\": %d, \"batch_max_age_ms\": %d, \"queue_len\": %d},\n",
+          rate, stationCount, warmupS, durationS, server.latencyMs, server.jitterMs, server.failRate,
+          server.resetRate, seed, UPLINK_BATCH_MAX_COUNT, UPLINK_BATCH_MAX_AGE_MS, UPLINK_QUEUE_LEN);
+  fprintf(out,
+          "  \"frames\": %llu, \"achieved_pps\": %.1f, \"max_lag_ms\": %.1f,\n"
+          "  \"recv_us\": {\"p50\": %.0f, \"p99\": %.0f, \"p999\": %.0f, \"max\": %.0f},\n",
+          (unsigned long long)measured, loadS > 0 ? measured / loadS : 0, maxLagMs, quantile(recvUs, 0.5),
+          quantile(recvUs, 0.99), quantile(recvUs, 0.999), quantile(recvUs, 1.0));
+  fprintf(out,
+          "  \"acked\": %zu, \"acked_pps\": %.1f, \"unacked\": %llu, \"queue_drops\": %u, "
+          "\"backlog_overwritten\": %u, \"drain_s\": %.2f,\n"
+          "  \"latency_ms\": {\"p50\": %.0f, \"p99\": %.0f, \"p999\": %.0f, \"max\": %.0f, \"mean\": %.1f},\n",
+          lat.size(), loadS > 0 ? lat.size() / (loadS + drainedS) : 0,
+          (unsigned long long)(measured > lat.size() ? measured - lat.size() : 0), queueDrops,
+          uplinkBacklog.overwritten, drainedS, quantile(lat, 0.5), quantile(lat, 0.99), quantile(lat, 0.999),
+          quantile(lat, 1.0), meanLat);
+  fprintf(out,
+          "  \"uplink\": {\"posts\": %u, \"connects\": %u, \"reused\": %u, \"readings_ok\": %u, "
+          "\"readings_rejected\": %u, \"readings_failed\": %u, \"warmup_acked\": %u},\n"
+          "  \"server\": {\"requests\": %u, \"failed\": %u, \"reset\": %u, \"body_bytes\": %llu}\n"
+          "}\n",
+          uplinkClient.requests, uplinkClient.connects, uplinkClient.reused, ok, rejected, failed, warmupAcked,
+          serverRequests.load(), serverFailed.load(), serverReset.load(),
+          (unsigned long long)serverBodyBytes.load());
+  fflush(out);
+  // The uplink task, loop thread and server threads never return
+  _exit(0);
+}
@@ -4,7 +4,9 @@
 #include <driver/rtc_io.h>  
 #include <esp_sleep.h> 
 #include "config.h"  // Where information is stored about constants, e.g. fan duration etc.
+#include "serial_log.h"  // LOG_* macros, compiled out with -DSERIAL_LOG=0
 #include <Wire.h>
+#include <time.h>
 
 // Header files for esp now communication
 #include "espnow_comm.h"
@@ -16,6 +18,22 @@ RTC_DATA_ATTR int system_state = 0;
 // Calibration constants that must stay in memory!
 RTC_DATA_ATTR int cali_counter = 1; // iteration counter for calibration; counts from 1. 
 
+// Message numbering, so the gateway can drop duplicates and count lost messages
+RTC_DATA_ATTR uint32_t msg_seq = 0;    // sequence number of the next sensor_msg
+RTC_DATA_ATTR uint16_t boot_count = 0; // power-on counter (NVS), read once per power-on
+
+// Awake time per phase since the last diagnostics frame (phase_profiler.h)
+RTC_DATA_ATTR PhaseProfile profile;
+uint32_t phase_start_us = 0;
+
+void phaseStart() {
+  phase_start_us = micros();
+}
+
+void phaseEnd(Phase phase) {
+  profile.add(phase, micros() - phase_start_us);
+}
+
 // States
 const int STATE_INITIAL_BOOT = 0;
 const int STATE_START_MEASURE = 1;
@@ -27,21 +45,22 @@ const int STATE_CALI_ROUTINE = 3;
 // what you wrote with what you assign it - it will replace LED_PIN with GPIO_Num_2 each time you run the code.
 #define uS_TO_S_FACTOR 1000000ULL  // Conversion factor for micro seconds to sec
 #define LED_PIN GPIO_NUM_2             // GPIO pin for the LED
-#define MEASUREMENT_DURATION 10  // Time needed for sensor measurement (seconds) - matches SHORT_SLEEP
 
+Scd41Sensor sensor;
 
+uint32_t LONG_SLEEP_MS;   // sleep between cycles
+uint32_t SHORT_SLEEP_MS;  // wait for the sensor measurement (Scd41Sensor::measureTimeMs)
 
-uint16_t LONG_SLEEP;      
-uint8_t SHORT_SLEEP = 10; // seconds to wait for sensor measurement (sensor needs 10 seconds)
-uint8_t cur_time = 0;     // shorter length to save memory
-uint16_t AWAKE_TIME = 0;
+// CO2 is measured on every SCD41_CO2_EVERY-th reading, T/RH-only in between (single-shot mode).
+// Follows the message number, so the measure and the read wake agree without extra RTC state.
+bool co2Cycle() {
+  return msg_seq % SCD41_CO2_EVERY == 0;
+}
 
 void setMeasuremntIntervals() {
-  if(useFan) {
-  LONG_SLEEP = MEASUREMENT_INTERVAL - MEASUREMENT_DURATION - FAN_DURATION;
-} else {
-  LONG_SLEEP = MEASUREMENT_INTERVAL - MEASUREMENT_DURATION;
-}
+  SHORT_SLEEP_MS = Scd41Sensor::measureTimeMs(co2Cycle());
+  uint32_t busy = SHORT_SLEEP_MS + (useFan ? FAN_DURATION * 1000 : 0);
+  LONG_SLEEP_MS = MEASUREMENT_INTERVAL * 1000UL > busy ? MEASUREMENT_INTERVAL * 1000UL - busy : 0;
 } 
 
 void checkCalibration() {
@@ -52,7 +71,7 @@ void checkCalibration() {
   */
 
   if(cali_counter >= CALI_PERIOD){    // condition leq due to error handling.
-    Serial.println("Calibration boundary reached. Sensor will calibrate this cycle.");
+    LOG_I("Calibration boundary reached. Sensor will calibrate this cycle.\n");
     needCalibration = true;
     system_state = STATE_CALI_ROUTINE;
   }
@@ -62,71 +81,198 @@ void checkCalibration() {
 
 }
 
-void setup() {
-  // Turn on indicator LED
-  pinMode(LED_PIN, OUTPUT);
-  digitalWrite(LED_PIN, HIGH); 
-  setMeasuremntIntervals();
+#if STATION_BATCH_READINGS > MULTI_MAX_READINGS
+#error "STATION_BATCH_READINGS readings do not fit in one ESP-NOW frame (MULTI_MAX_READINGS)"
+#endif
+
+#if STATION_BATCH_READINGS > 1
+// Readings not sent yet, oldest first from ring_head. Kept in RTC memory across deep sleep,
+// sent together every STATION_BATCH_READINGS cycles so the radio starts once per frame.
+RTC_DATA_ATTR sensor_msg reading_ring[STATION_BATCH_READINGS];
+RTC_DATA_ATTR uint8_t ring_head = 0;
+RTC_DATA_ATTR uint8_t ring_count = 0;
+
+void bufferReading(const sensor_msg& reading) {
+  if (ring_count == STATION_BATCH_READINGS) {
+    // Full (last frame was not sent): drop the oldest
+    ring_head = (ring_head + 1) % STATION_BATCH_READINGS;
+    ring_count--;
+  }
+  reading_ring[(ring_head + ring_count) % STATION_BATCH_READINGS] = reading;
+  ring_count++;
+}
+
+// One MSG_TYPE_MULTI frame with everything in the ring. Only the oldest readings are ever
+// dropped, so the ring holds consecutive sequence numbers and the frame needs only the first;
+// the gateway counts dropped readings as lost.
+size_t buildBatchFrame(uint8_t* frame, size_t cap) {
+  static multi_msg batch;
+  const sensor_msg& newest = reading_ring[(ring_head + ring_count - 1) % STATION_BATCH_READINGS];
+  batch.boot = newest.boot;
+  batch.seq = reading_ring[ring_head].seq;
+  batch.uptime_s = newest.uptime_s;
+  batch.count = ring_count;
+  for (uint8_t i = 0; i < ring_count; ++i) {
+    const sensor_msg& r = reading_ring[(ring_head + i) % STATION_BATCH_READINGS];
+    multi_reading& e = batch.readings[i];
+    e.temperature = r.temperature;
+    e.co2 = r.co2;
+    e.humidity = r.humidity;
+    uint32_t age = newest.uptime_s - r.uptime_s;
+    e.age_s = age > 0xFFFF ? 0xFFFF : age;
+  }
+  LOG_I("Step 3: Sending %u buffered readings (seq %u..%u) in one frame\n",
+        batch.count, batch.seq, newest.seq);
+  return wireEncode(batch, frame, cap);
+}
+#endif
 
-  uint8_t start_time = millis();
+void startRadio() {
+  LOG_I("  Initializing ESP-NOW...\n");
+  ESPNOWSetup();
+  addBroadcastPeer();
+  LOG_I("  ✓ ESP-NOW initialized, broadcast peer added\n");
+}
+
+// Send one frame to the gateway (unicast once it is known, see sendToGateway). Returns true if
+// the gateway has it.
+bool sendFrame(const uint8_t* frame, size_t frameLen) {
+  LOG_I("Step 3: Sending data via ESP-NOW...\n");
+  LOG_I("  Target: %s\n", gateway_known ? "cached gateway (unicast)" : "Broadcast (FF:FF:FF:FF:FF:FF), gateway discovery");
+  if (gateway_channel) {
+    LOG_I("  Channel: %u (cached)\n", gateway_channel);
+  } else {
+    LOG_I("  Channel: unknown, scanning first\n");
+  }
+  LOG_I("  Data size: %u bytes\n", (unsigned)frameLen);
+  bool sent = sendToGateway(frame, frameLen);
+  profile.add(PHASE_CHANNEL_SCAN, last_tune_us);
+  if (last_send_us) profile.add(PHASE_SEND, last_send_us);
+  if (last_ack_wait_us) profile.add(PHASE_ACK_WAIT, last_ack_wait_us);
+  return sent;
+}
+
+// Every DIAG_INTERVAL_S, after a frame got through (radio on, gateway known): send the awake-time
+// profile and start a new one. Kept if the gateway does not get it.
+void sendDiagnostics() {
+  uint32_t now = (uint32_t)time(NULL);
+  if (now - profile.start_s < DIAG_INTERVAL_S) return;
+  static diag_msg diag;
+  profile.toDiag(diag, boot_count, now);
+  uint8_t frame[ESPNOW_MAX_FRAME];
+  size_t len = wireEncode(diag, frame, sizeof(frame));
+  LOG_I("Step 4: Sending diagnostics (%u wakes in %u s, %u phases)\n", diag.wakes, diag.window_s, diag.count);
+  if (sendToGateway(frame, len)) profile.reset(now);
+}
 
-  Serial.begin(115200);
+// Awake time per state, kept across deep sleep: from the start of setup() to the sleep call
+// (the ~tens of ms of boot ROM and bootloader before setup() are not included)
+RTC_DATA_ATTR uint64_t state_awake_us[4];
+RTC_DATA_ATTR uint32_t state_wakes[4];
+uint32_t wake_start_us = 0;
+int wake_state = 0;       // State this wake started in
+
+void recordAwakeTime() {
+  uint32_t us = micros() - wake_start_us;
+  if (wake_state < 0 || wake_state > STATE_CALI_ROUTINE) return;
+  state_awake_us[wake_state] += us;
+  state_wakes[wake_state]++;
+  profile.addWake(us);
+  LOG_I("  Awake %lu us in state %d (mean %lu us over %u wakes)\n", (unsigned long)us, wake_state,
+        (unsigned long)(state_awake_us[wake_state] / state_wakes[wake_state]), state_wakes[wake_state]);
+}
+
+// Deep sleep for `us` microseconds and start over in setup()
+void sleepFor(uint64_t us) {
+  recordAwakeTime();
+  LOG_FLUSH();
+  esp_sleep_enable_timer_wakeup(us);
+  esp_deep_sleep_start();
+}
+
+// Everything a cold boot needs once: Serial banner and full sensor init
+void coldBootInit(esp_sleep_wakeup_cause_t wakeup_reason) {
+#if SERIAL_LOG
   delay(1000); // Give serial time to initialize
+#endif
+
+  LOG_PRINTLN("\n========================================");
+  LOG_PRINTLN("=== ESP32 Station Starting ===");
+  LOG_PRINTLN("========================================\n");
   
-  Serial.println("\n========================================");
-  Serial.println("=== ESP32 Station Starting ===");
-  Serial.println("========================================\n");
-  
-  Serial.println("--- Configuration ---");
-  Serial.printf("  Measurement interval: %d seconds\n", MEASUREMENT_INTERVAL);
-  Serial.printf("  Short sleep (measurement wait): %d seconds\n", SHORT_SLEEP);
-  Serial.printf("  Long sleep (between cycles): %d seconds\n", LONG_SLEEP);
-  Serial.printf("  Fan enabled: %s\n", useFan ? "YES" : "NO");
-  Serial.printf("  Fan duration: %d seconds\n", FAN_DURATION);
-  Serial.printf("  Max stations: %d\n", NUM_STATIONS);
-  Serial.printf("  Calibration period: %d cycles (%d hours)\n", CALI_PERIOD, CALI_DURATION);
-  Serial.println();
+  LOG_PRINTLN("--- Configuration ---");
+  LOG_PRINTF("  Measurement interval: %d seconds\n", MEASUREMENT_INTERVAL);
+  LOG_PRINTF("  Sensor mode: %s (CO2 every %d readings)\n",
+             SCD41_MODE == SCD41_MODE_SINGLE_SHOT ? "single shot" : "periodic", SCD41_CO2_EVERY);
+  LOG_PRINTF("  Short sleep (measurement wait): %lu ms\n", (unsigned long)SHORT_SLEEP_MS);
+  LOG_PRINTF("  Long sleep (between cycles): %lu ms\n", (unsigned long)LONG_SLEEP_MS);
+  LOG_PRINTF("  Fan enabled: %s\n", useFan ? "YES" : "NO");
+  LOG_PRINTF("  Fan duration: %d seconds\n", FAN_DURATION);
+  LOG_PRINTF("  Max stations: %d\n", NUM_STATIONS);
+  LOG_PRINTF("  Calibration period: %d cycles (%d hours)\n", CALI_PERIOD, CALI_DURATION);
+  LOG_PRINTLN();
   
-  Serial.println("--- Initialization ---");
-
-  esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
+  LOG_PRINTLN("--- Initialization ---");
     
-    Serial.print("Boot Reason: ");
-    if (wakeup_reason == ESP_SLEEP_WAKEUP_TIMER) {
-        Serial.println("Timer Wakeup (OK)");
-    } else if (wakeup_reason == ESP_SLEEP_WAKEUP_UNDEFINED) {
-        Serial.println("Reset/Crash (OR post-calibration restart!)");
+    LOG_PRINT("Boot Reason: ");
+    if (wakeup_reason == ESP_SLEEP_WAKEUP_UNDEFINED) {
+        LOG_PRINTLN("Reset/Crash (OR post-calibration restart!)");
     } else {
-        Serial.printf("Other Wakeup Reason: %d\n", wakeup_reason);
+        LOG_PRINTF("Other Wakeup Reason: %d\n", wakeup_reason);
     }
 
-  // Initialize stuff
-  Serial.println("  Initializing ESP-NOW...");
-  ESPNOWSetup();
-  Serial.println("  ✓ ESP-NOW initialized");
-  
-  Serial.println("  Initializing SCD41 sensor...");
-  initSensor();
-  Serial.println("  ✓ Sensor initialized");
-  
-  Serial.println("  Adding broadcast peer...");
-  addBroadcastPeer();
-  Serial.println("  ✓ Broadcast peer added");
+  // Initialize stuff (the radio is only started in cycles that send)
+  LOG_PRINTLN("  Initializing SCD41 sensor...");
+  phaseStart();
+  sensor.init();
+  phaseEnd(PHASE_SENSOR_INIT);
+  LOG_PRINTLN("  ✓ Sensor initialized");
+}
+
+void setup() {
+  wake_start_us = micros();
+  profile.add(PHASE_BOOT, wake_start_us);   // micros() counts from app startup
+  wake_state = system_state;
+  setMeasuremntIntervals();
+
+  // Turn on indicator LED
+  if (useOnboardLED) {
+    pinMode(LED_PIN, OUTPUT);
+    digitalWrite(LED_PIN, HIGH); 
+  }
+
+  LOG_BEGIN(115200);
+
+  // Timer wakes take the short path: the sensor kept running while we slept and nothing needs
+  // announcing, so only the I2C bus is set up again. The radio is only started in cycles that send.
+  esp_sleep_wakeup_cause_t wakeup_reason = esp_sleep_get_wakeup_cause();
+  if (wakeup_reason == ESP_SLEEP_WAKEUP_TIMER) {
+    phaseStart();
+    sensor.attach();
+    phaseEnd(PHASE_SENSOR_INIT);
+  } else {
+    coldBootInit(wakeup_reason);
+  }
   
-  Serial.println("  Checking calibration status...");
   checkCalibration();   // check current iteration if we need to do calibration
-  Serial.printf("  Calibration needed: %s\n", needCalibration ? "YES" : "NO");
-  Serial.printf("  Current calibration counter: %d\n", cali_counter);
-  Serial.println();
-  
-  Serial.println("--- Entering Main Loop ---");
-  Serial.printf("Current system state: %d\n", system_state);
-  Serial.println("  (0=Initial, 1=Start Measure, 2=Read Value, 3=Calibration)\n");
+  if (wakeup_reason != ESP_SLEEP_WAKEUP_TIMER) {
+    LOG_PRINTF("  Calibration needed: %s\n", needCalibration ? "YES" : "NO");
+    LOG_PRINTF("  Current calibration counter: %d\n", cali_counter);
+    LOG_PRINTLN();
+    LOG_PRINTLN("--- Entering Main Loop ---");
+    LOG_PRINTLN("  (0=Initial, 1=Start Measure, 2=Read Value, 3=Calibration)\n");
+  }
+  LOG_I("Current system state: %d\n", system_state);
 
         switch (system_state) {  // switch case sytax note; you check the () variable against if it equals what is after case _____;
             case STATE_INITIAL_BOOT:
                 // First boot - initialize and start first measurement
-                Serial.println("First boot detected - starting initial measurement cycle");
+                LOG_I("First boot detected - starting initial measurement cycle\n");
+                boot_count = nextBootCount();
+                msg_seq = 0;
+                profile.start_s = (uint32_t)time(NULL);
+                setMeasuremntIntervals();
+                LOG_I("Boot count: %u\n", boot_count);
                 system_state = STATE_START_MEASURE;
                 // Fall through to STATE_START_MEASURE
                 
@@ -136,37 +282,35 @@ void setup() {
             if (useFan) {
               pinMode(FAN_PIN, OUTPUT);
               digitalWrite(FAN_PIN, HIGH);   // Turn on fan
-              Serial.println("Fan turned on");
+              LOG_I("Fan turned on\n");
 
               esp_sleep_enable_timer_wakeup(FAN_DURATION * uS_TO_S_FACTOR);   // set sleep duration
-              Serial.printf("Fan will run for %d seconds (light sleep)\n", FAN_DURATION);
+              LOG_I("Fan will run for %d seconds (light sleep)\n", FAN_DURATION);
 
               // Enter light sleep
               esp_light_sleep_start();    
 
               // Wake up here
               digitalWrite(FAN_PIN, LOW);    // Turn off fan
-              Serial.println("Fan turned off after light sleep");
+              LOG_I("Fan turned off after light sleep\n");
             }
 
           //   // check iteration - enforce sensor is already on (testing)
           //   if (cali_counter == 1) {  // only run on initialisation & when cali_counter is reset.            
-          //     Serial.println("Sensor will be forced awake");
-          //     sensor.wakeUp();
+          //     LOG_PRINTLN("Sensor will be forced awake");
+          //     sensor.driver.wakeUp();
           //     delay(500);
           // }
 
-            // Start periodic measurement
-            Serial.println("\n--- Starting Measurement Cycle ---");
-            Serial.println("Step 1: Starting sensor measurement...");
-            error = sensor.startPeriodicMeasurement(); // Start the measurement process (non blocking)
-            if (error != NO_ERROR) {
-              Serial.print("ERROR: Failed to start measurement - ");
-              errorToString(error, errorMessage, sizeof errorMessage);
-              Serial.println(errorMessage);
-            } else {
-              Serial.println("✓ Sensor measurement started successfully");
-              Serial.printf("  Waiting %d seconds for measurement to complete...\n", SHORT_SLEEP);
+            // Start the measurement (non blocking)
+            LOG_I("\n--- Starting Measurement Cycle ---\n");
+            LOG_I("Step 1: Starting sensor measurement (%s)...\n", co2Cycle() ? "CO2, T, RH" : "T, RH only");
+            phaseStart();
+            sensor.start(co2Cycle());
+            phaseEnd(PHASE_MEASURE_START);
+            if (sensor.error == NO_ERROR) {
+              LOG_I("✓ Sensor measurement started successfully\n");
+              LOG_I("  Waiting %lu ms for measurement to complete...\n", (unsigned long)SHORT_SLEEP_MS);
             }
 
             // Save state in RTC memory
@@ -175,61 +319,72 @@ void setup() {
             // Turn off indicator LED
             digitalWrite(LED_PIN, LOW);
             
-            // Note down the time
-            cur_time = millis();
-            Serial.printf("Awake time so far: %d milliseconds\n", (cur_time - start_time));
-            Serial.printf("Entering deep sleep for %d seconds (measurement in progress)...\n", SHORT_SLEEP);
-            Serial.println("--- Sleeping ---\n");
-
-            // Go to sleep (the short sleep - wait for measurement)
-            esp_sleep_enable_timer_wakeup(SHORT_SLEEP * uS_TO_S_FACTOR);
-            esp_deep_sleep_start();
-            break;
+            if (SHORT_SLEEP_MS >= SCD41_DEEP_SLEEP_MIN_MS) {
+              LOG_I("Entering deep sleep for %lu ms (measurement in progress)...\n", (unsigned long)SHORT_SLEEP_MS);
+
+              // Go to sleep (the short sleep - wait for measurement)
+              sleepFor(SHORT_SLEEP_MS * 1000ULL);
+              break;
+            }
+
+            // Short measurement (T/RH-only shot): a deep sleep wake would cost more than it saves,
+            // so light sleep through it and read in this same wake
+            LOG_FLUSH();
+            esp_sleep_enable_timer_wakeup(SHORT_SLEEP_MS * 1000ULL);
+            esp_light_sleep_start();
+            // Fall through to STATE_READ_VALUE
 
         case STATE_READ_VALUE: {
             // we woke up from short sleep
             // Time to read the value and send it
-            Serial.println("\n=== Woke up from measurement sleep ===");
-            Serial.println("Step 2: Reading sensor data...");
-            msg = readSDA41(); // This uses sensor.readMeasurement()
-            
-            Serial.println("\n--- Sensor Readings ---");
-            Serial.printf("  Temperature: %.2f °C\n", msg.temperature);
-            Serial.printf("  CO2:         %d ppm\n", msg.co2);
-            Serial.printf("  Humidity:    %.2f %%\n", msg.humidity);
-            Serial.println("--- End Readings ---\n");
-
-            // Reset send_done flag
-            send_done = false;
-            
-            Serial.println("Step 3: Sending data via ESP-NOW...");
-            Serial.print("  Target: Broadcast (FF:FF:FF:FF:FF:FF)\n");
-            Serial.printf("  Data size: %d bytes\n", sizeof(msg));
+            LOG_I("\n=== Woke up from measurement sleep ===\n");
+            LOG_I("Step 2: Reading sensor data...\n");
+            sensor_msg msg;
+            phaseStart();
+            sensor.waitReady(SCD41_READY_TIMEOUT_MS);
+            sensor.read(msg, co2Cycle());
+            phaseEnd(PHASE_READ);
             
-            esp_err_t result = esp_now_send(broadcastAddr, (uint8_t *)&msg, sizeof(msg));
-            
-            if (result == ESP_OK) {
-              Serial.println("  ✓ ESP-NOW send initiated successfully");
+            LOG_I("\n--- Sensor Readings ---\n");
+            LOG_I("  Temperature: %.2f °C\n", msg.temperature);
+            if (msg.co2 == CO2_NONE) {
+              LOG_I("  CO2:         - (not measured this cycle)\n");
             } else {
-              Serial.printf("  ✗ ESP-NOW send failed with error code: %d\n", result);
-              Serial.println("  Error codes: 0=OK, -1=FAIL, -2=NO_MEM, -3=INVALID_ARG");
-            }
-  
-            // Wait for send to complete (with timeout)
-            Serial.println("  Waiting for send confirmation...");
-            unsigned long sendTimeout = millis() + 2000; // 2 second timeout
-            unsigned long startWait = millis();
-            
-            while (!send_done && millis() < sendTimeout) {
-              delay(10);
+              LOG_I("  CO2:         %d ppm\n", msg.co2);
             }
-            
-            unsigned long waitTime = millis() - startWait;
-            
-            if (send_done) {
-              Serial.printf("  ✓ ESP-NOW data sent successfully! (waited %lu ms)\n", waitTime);
+            LOG_I("  Humidity:    %.2f %%\n", msg.humidity);
+            LOG_I("--- End Readings ---\n\n");
+
+            // Number the message
+            msg.boot = boot_count;
+            msg.seq = msg_seq++;
+            msg.uptime_s = (uint32_t)time(NULL); // system time is kept by the RTC timer during deep sleep
+            LOG_I("  Boot %u, seq %u, uptime %u s\n", msg.boot, msg.seq, msg.uptime_s);
+
+            uint8_t frame[ESPNOW_MAX_FRAME];
+            size_t frameLen = 0;
+#if STATION_BATCH_READINGS > 1
+            bufferReading(msg);
+            if (ring_count >= STATION_BATCH_READINGS) {
+              frameLen = buildBatchFrame(frame, sizeof(frame));
             } else {
-              Serial.printf("  ✗ WARNING: ESP-NOW send timeout after %lu ms\n", waitTime);
+              LOG_I("Step 3: Buffered reading %u / %u, radio stays off this cycle\n",
+                    ring_count, STATION_BATCH_READINGS);
+            }
+#else
+            frameLen = wireEncode(msg, frame, sizeof(frame));
+#endif
+            if (frameLen) {
+              phaseStart();
+              startRadio();
+              phaseEnd(PHASE_RADIO_INIT);
+              bool sent = sendFrame(frame, frameLen);
+              if (sent) sendDiagnostics();
+#if STATION_BATCH_READINGS > 1
+              if (sent) ring_count = 0;   // Else keep them; the oldest are overwritten while the gateway is unreachable
+#else
+              (void)sent;
+#endif
             }
             
             // Set the next state to start a new cycle
@@ -237,79 +392,74 @@ void setup() {
 
             digitalWrite(LED_PIN, LOW);
 
-            cur_time = millis();
-            Serial.println("\n--- Cycle Summary ---");
-            Serial.printf("  Total awake time: %d milliseconds\n", (cur_time - start_time));
-            Serial.printf("  Next sleep duration: %d seconds\n", LONG_SLEEP);
-            Serial.printf("  Calibration counter: %d / %d cycles\n", cali_counter, CALI_PERIOD);
+            LOG_I("\n--- Cycle Summary ---\n");
+            LOG_I("  Next sleep duration: %lu ms\n", (unsigned long)LONG_SLEEP_MS);
+            LOG_I("  Calibration counter: %d / %d cycles\n", cali_counter, CALI_PERIOD);
             
-            if (LONG_SLEEP > 0) {
-              Serial.printf("\nSleeping for %d seconds until next measurement cycle...\n", LONG_SLEEP);
+            if (LONG_SLEEP_MS > 0) {
+              LOG_I("\nSleeping for %lu ms until next measurement cycle...\n", (unsigned long)LONG_SLEEP_MS);
             } else {
-              Serial.println("\nWARNING: LONG_SLEEP is 0 or negative! Check timing configuration.");
+              LOG_W("\nWARNING: LONG_SLEEP_MS is 0! Check timing configuration.\n");
             }
 
             // Calibration counter tracking
             cali_counter++; // adds one to previous value of counter
 
             // enable sleep for the remaining time to complete measurement interval
-            if (LONG_SLEEP > 0) {
-              esp_sleep_enable_timer_wakeup(LONG_SLEEP * uS_TO_S_FACTOR); 
-              Serial.println("Entering deep sleep...\n"); 
-              esp_deep_sleep_start();
+            if (LONG_SLEEP_MS > 0) {
+              LOG_I("Entering deep sleep...\n\n"); 
+              sleepFor(LONG_SLEEP_MS * 1000ULL);
             } else {
-              // If LONG_SLEEP is 0, we need to start the next cycle immediately
-              // This happens when MEASUREMENT_INTERVAL equals MEASUREMENT_DURATION
-              Serial.println("WARNING: LONG_SLEEP is 0 - starting next cycle immediately");
-              Serial.println("Consider increasing MEASUREMENT_INTERVAL or decreasing MEASUREMENT_DURATION");
+              // If LONG_SLEEP_MS is 0, we need to start the next cycle immediately
+              // This happens when MEASUREMENT_INTERVAL is not longer than the measurement (and fan) time
+              LOG_W("WARNING: LONG_SLEEP_MS is 0 - starting next cycle immediately\n");
+              LOG_I("Consider increasing MEASUREMENT_INTERVAL or using the single-shot sensor mode\n");
               system_state = STATE_START_MEASURE;
               // Small delay to prevent tight loop, then continue to next cycle
               delay(100);
               // Don't sleep, just continue to next cycle (will restart from STATE_START_MEASURE)
               // Actually, we need to restart the loop, so we'll use a very short sleep
-              esp_sleep_enable_timer_wakeup(100000ULL); // 0.1 second minimum sleep
-              Serial.println("Entering minimal sleep (0.1s) before next cycle...\n");
-              esp_deep_sleep_start();
+              LOG_I("Entering minimal sleep (0.1s) before next cycle...\n\n");
+              sleepFor(100000ULL); // 0.1 second minimum sleep
             }
             break;
         }
 
         case STATE_CALI_ROUTINE:
             
-            error = sensor.setAutomaticSelfCalibrationInitialPeriod(0);  // See Inspirion docs, 0 forces IMMEDIATE recalibration!
-            if (error == NO_ERROR) {
-              Serial.println("Sensor forced automatic Cal. was a success");
+            sensor.error = sensor.driver.setAutomaticSelfCalibrationInitialPeriod(0);  // See Inspirion docs, 0 forces IMMEDIATE recalibration!
+            if (sensor.error == NO_ERROR) {
+              LOG_I("Sensor forced automatic Cal. was a success\n");
               }
             else {
-              Serial.println("Error encountered during calibration:  ");
-              errorToString(error, errorMessage, sizeof errorMessage);
-              Serial.println(errorMessage);;
+              errorToString(sensor.error, sensor.errorMessage, sizeof sensor.errorMessage);
+              LOG_E("Error encountered during calibration: %s\n", sensor.errorMessage);
               }
             
-            error = sensor.setAutomaticSelfCalibrationInitialPeriod(44);  // See Inspirion docs, reset to default value.
-            if (error == NO_ERROR) {
-              Serial.println("Sensor automatic Cal reset was a success");
+            sensor.error = sensor.driver.setAutomaticSelfCalibrationInitialPeriod(44);  // See Inspirion docs, reset to default value.
+            if (sensor.error == NO_ERROR) {
+              LOG_I("Sensor automatic Cal reset was a success\n");
               }
             else {
-              Serial.println("Error encountered during calibration:  ");
-              errorToString(error, errorMessage, sizeof errorMessage);
-              Serial.println(errorMessage);;
+              errorToString(sensor.error, sensor.errorMessage, sizeof sensor.errorMessage);
+              LOG_E("Error encountered during calibration: %s\n", sensor.errorMessage);
               }
 
-            if (error == NO_ERROR) {   // is the local error state that everything is fine? Then, restart.
+            if (sensor.error == NO_ERROR) {   // is the local error state that everything is fine? Then, restart.
               system_state = STATE_START_MEASURE; //reboot
               cali_counter = 1;
-              Serial.println("Device has reset state to measurement state, continuing to reboot");
+              LOG_I("Device has reset state to measurement state, continuing to reboot\n");
+              LOG_FLUSH();
               esp_restart();
             }
               else {
-                Serial.println("Post-Calibration restart failed, due to previous errors.");
+                LOG_E("Post-Calibration restart failed, due to previous errors.\n");
               }
           break;
             
         default:
             // Fallback - should not happen, but handle gracefully
-            Serial.printf("ERROR: Unknown state %d. Resetting to STATE_START_MEASURE...\n", system_state);
+            LOG_E("ERROR: Unknown state %d. Resetting to STATE_START_MEASURE...\n", system_state);
             system_state = STATE_START_MEASURE;
             // Small delay then restart cycle
             delay(100);
@@ -0,0 +1,230 @@
+// ESP-NOW wire codecs (include/espnow_proto.h): every message type survives encode -> decode, older
+// and newer versions of a type still decode, and malformed frames are refused.
+// Run with: pio test -e native-test
+#include <unity.h>
+
+#include "espnow_proto.h"
+
+static uint8_t frame[ESPNOW_MAX_FRAME + 16];
+
+void setUp(void) {
+  memset(frame, 0xA5, sizeof(frame));
+}
+
+void tearDown(void) {}
+
+static sensor_msg sensorReading(uint16_t co2) {
+  sensor_msg m = {};
+  m.temperature = -12.34f;
+  m.humidity = 56.78f;
+  m.co2 = co2;
+  m.boot = 7;
+  m.seq = 123456;
+  m.uptime_s = 86400;
+  return m;
+}
+
+static void assertSensor(const sensor_msg& in, const sensor_msg& out) {
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.temperature, out.temperature);
+  TEST_ASSERT_FLOAT_WITHIN(0.005f, in.humidity, out.humidity);
+  TEST_ASSERT_EQUAL_UINT16(in.co2, out.co2);
+  TEST_ASSERT_EQUAL_UINT16(in.boot, out.boot);
+  TEST_ASSERT_EQUAL_UINT32(in.seq, out.seq);
+  TEST_ASSERT_EQUAL_UINT32(in.uptime_s, out.uptime_s);
+}
+
+void test_sensor_round_trip(void) {
+  const uint16_t co2s[] = {0, 415, 40000, CO2_NONE};
+  for (uint16_t co2 : co2s) {
+    sensor_msg in = sensorReading(co2), out;
+    size_t len = wireEncode(in, frame, sizeof(frame));
+    TEST_ASSERT_EQUAL_UINT32(sizeof(WireSensor), len);
+    TEST_ASSERT_EQUAL_UINT8(MSG_TYPE_SENSOR, wireType(frame, len));
+    TEST_ASSERT_TRUE(wireDecode(frame, len, out));
+    assertSensor(in, out);
+  }
+}
+
+// Version 1 frames (no flags byte) from stations not yet reflashed: CO2 is always a value
+void test_sensor_v1_frame(void) {
+  sensor_msg in = sensorReading(800), out;
+  wireEncode(in, frame, sizeof(frame));
+  frame[1] = 1;
+  TEST_ASSERT_TRUE(wireDecode(frame, WIRE_SENSOR_V1_LEN, out));
+  assertSensor(in, out);
+  TEST_ASSERT_FALSE(wireDecode(frame, WIRE_SENSOR_V1_LEN - 1, out));
+}
+
+// A later version with appended fields: the known prefix is read, the rest ignored
+void test_sensor_newer_version(void) {
+  sensor_msg in = sensorReading(CO2_NONE), out;
+  size_t len = wireEncode(in, frame, sizeof(frame));
+  frame[1] = 9;
+  TEST_ASSERT_TRUE(wireDecode(frame, len + 6, out));
+  assertSensor(in, out);
+}
+
+void test_legacy_sensor_struct(void) {
+  float t = 22.5f, h = 41.0f;
+  uint16_t co2 = 612;
+  memset(frame, 0, SENSOR_MSG_V0_LEN);
+  memcpy(frame, &t, 4);
+  memcpy(frame + 4, &co2, 2);
+  memcpy(frame + 8, &h, 4);
+  sensor_msg out;
+  bool numbered = true;
+  TEST_ASSERT_TRUE(decodeSensorFrame(frame, SENSOR_MSG_V0_LEN, out, numbered));
+  TEST_ASSERT_FALSE(numbered);
+  TEST_ASSERT_EQUAL_FLOAT(t, out.temperature);
+  TEST_ASSERT_EQUAL_FLOAT(h, out.humidity);
+  TEST_ASSERT_EQUAL_UINT16(co2, out.co2);
+
+  sensor_msg in = sensorReading(500);
+  size_t len = wireEncode(in, frame, sizeof(frame));
+  TEST_ASSERT_TRUE(decodeSensorFrame(frame, len, out, numbered));
+  TEST_ASSERT_TRUE(numbered);
+  assertSensor(in, out);
+}
+
+static multi_msg multiFrame(uint8_t count) {
+  multi_msg m = {};
+  m.boot = 3;
+  m.seq = 1000;
+  m.uptime_s = 5000;
+  m.count = count;
+  for (uint8_t i = 0; i < count; ++i) {
+    m.readings[i].temperature = 20.0f + i / 10.0f;
+    m.readings[i].humidity = 50.0f - i / 4.0f;
+    m.readings[i].co2 = i % 3 ? CO2_NONE : 400 + i;
+    m.readings[i].age_s = (count - 1 - i) * 60;
+  }
+  return m;
+}
+
+void test_multi_round_trip(void) {
+  static multi_msg in, out;
+  in = multiFrame(MULTI_MAX_READINGS);
+  size_t len = wireEncode(in, frame, sizeof(frame));
+  TEST_ASSERT_LESS_OR_EQUAL(ESPNOW_MAX_FRAME, len);
+  TEST_ASSERT_TRUE(wireDecode(frame, len, out));
+  TEST_ASSERT_EQUAL_UINT8(in.count, out.count);
+  TEST_ASSERT_EQUAL_UINT32(in.seq, out.seq);
+  for (uint8_t i = 0; i < in.count; ++i) {
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.readings[i].temperature, out.readings[i].temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, in.readings[i].humidity, out.readings[i].humidity);
+    TEST_ASSERT_EQUAL_UINT16(in.readings[i].co2, out.readings[i].co2);
+    TEST_ASSERT_EQUAL_UINT16(in.readings[i].age_s, out.readings[i].age_s);
+  }
+  sensor_msg r = multiReadingAt(out, 2);
+  TEST_ASSERT_EQUAL_UINT32(in.seq + 2, r.seq);
+  TEST_ASSERT_EQUAL_UINT32(in.uptime_s - in.readings[2].age_s, r.uptime_s);
+}
+
+// Version 1 multi frames: 8-byte entries without flags
+void test_multi_v1_entries(void) {
+  static multi_msg out;
+  WireMulti w = {};
+  w.hdr.type = MSG_TYPE_MULTI;
+  w.hdr.version = 1;
+  w.seq = 10;
+  w.count = 2;
+  w.entry_len = WIRE_MULTI_ENTRY_V1_LEN;
+  memcpy(frame, &w, sizeof(w));
+  for (uint8_t i = 0; i < 2; ++i) {
+    WireMultiEntry e = {};
+    e.age_s = 60 - i * 60;
+    e.temperature = 2150;
+    e.humidity = 4000;
+    e.co2 = 700 + i;
+    memcpy(frame + sizeof(w) + i * WIRE_MULTI_ENTRY_V1_LEN, &e, WIRE_MULTI_ENTRY_V1_LEN);
+  }
+  TEST_ASSERT_TRUE(wireDecode(frame, sizeof(w) + 2 * WIRE_MULTI_ENTRY_V1_LEN, out));
+  TEST_ASSERT_EQUAL_UINT8(2, out.count);
+  TEST_ASSERT_EQUAL_UINT16(701, out.readings[1].co2);
+  TEST_ASSERT_EQUAL_FLOAT(21.5f, out.readings[1].temperature);
+  TEST_ASSERT_EQUAL_UINT16(60, out.readings[0].age_s);
+}
+
+void test_multi_malformed(void) {
+  static multi_msg in, out;
+  in = multiFrame(4);
+  size_t len = wireEncode(in, frame, sizeof(frame));
+  TEST_ASSERT_FALSE(wireDecode(frame, len - 1, out));                 // Last entry cut short
+  frame[offsetof(WireMulti, count)] = MULTI_MAX_READINGS + 1;
+  TEST_ASSERT_FALSE(wireDecode(frame, sizeof(frame), out));           // More than fit in memory
+  frame[offsetof(WireMulti, count)] = 4;
+  frame[offsetof(WireMulti, entry_len)] = WIRE_MULTI_ENTRY_V1_LEN - 1;
+  TEST_ASSERT_FALSE(wireDecode(frame, len, out));                     // Entries too short
+}
+
+void test_ack_and_beacon_round_trip(void) {
+  ack_msg a = {{0x24, 0x6F, 0x28, 0x01, 0x02, 0x03}, 9, 4242}, a2;
+  size_t len = wireEncode(a, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_UINT32(sizeof(WireAck), len);
+  TEST_ASSERT_TRUE(wireDecode(frame, len, a2));
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(a.station, a2.station, 6);
+  TEST_ASSERT_EQUAL_UINT16(a.boot, a2.boot);
+  TEST_ASSERT_EQUAL_UINT32(a.seq, a2.seq);
+  TEST_ASSERT_FALSE(wireDecode(frame, len - 1, a2));
+
+  beacon_msg b = {11, 2000}, b2;
+  len = wireEncode(b, frame, sizeof(frame));
+  TEST_ASSERT_TRUE(wireDecode(frame, len, b2));
+  TEST_ASSERT_EQUAL_UINT8(11, b2.channel);
+  TEST_ASSERT_EQUAL_UINT16(2000, b2.interval_ms);
+}
+
+void test_diag_round_trip(void) {
+  static diag_msg in, out;
+  memset(&in, 0, sizeof(in));
+  in.boot = 2;
+  in.uptime_s = 3600;
+  in.window_s = 600;
+  in.wakes = 20;
+  in.awake_ms = 4321;
+  in.count = DIAG_MAX_PHASES;
+  for (uint8_t i = 0; i < in.count; ++i) {
+    in.phases[i].phase = i;
+    in.phases[i].count = 20;
+    in.phases[i].mean_us = 1000u * (i + 1);
+    in.phases[i].max_us = 5000u * (i + 1);
+    in.phases[i].hist[i] = 20;
+  }
+  size_t len = wireEncode(in, frame, sizeof(frame));
+  TEST_ASSERT_LESS_OR_EQUAL(ESPNOW_MAX_FRAME, len);
+  TEST_ASSERT_TRUE(wireDecode(frame, len, out));
+  TEST_ASSERT_EQUAL_UINT32(in.awake_ms, out.awake_ms);
+  TEST_ASSERT_EQUAL_UINT8(in.count, out.count);
+  for (uint8_t i = 0; i < in.count; ++i) {
+    TEST_ASSERT_EQUAL_UINT32(in.phases[i].max_us, out.phases[i].max_us);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(in.phases[i].hist, out.phases[i].hist, DIAG_BUCKETS);
+  }
+}
+
+void test_wrong_type_or_version(void) {
+  sensor_msg s = sensorReading(500);
+  ack_msg a;
+  size_t len = wireEncode(s, frame, sizeof(frame));
+  TEST_ASSERT_FALSE(wireDecode(frame, len, a));   // A sensor frame is no ACK
+  frame[1] = 0;
+  TEST_ASSERT_FALSE(wireDecode(frame, len, s));   // Version 0 does not exist
+  TEST_ASSERT_EQUAL_UINT8(0, wireType(frame, 1));
+  TEST_ASSERT_EQUAL_UINT32(0, wireEncode(s, frame, sizeof(WireSensor) - 1));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_sensor_round_trip);
+  RUN_TEST(test_sensor_v1_frame);
+  RUN_TEST(test_sensor_newer_version);
+  RUN_TEST(test_legacy_sensor_struct);
+  RUN_TEST(test_multi_round_trip);
+  RUN_TEST(test_multi_v1_entries);
+  RUN_TEST(test_multi_malformed);
+  RUN_TEST(test_ack_and_beacon_round_trip);
+  RUN_TEST(test_diag_round_trip);
+  RUN_TEST(test_wrong_type_or_version);
+  return UNITY_END();
+}
@@ -0,0 +1,267 @@
+// FlashWal (include/flash_wal.h): after a power loss in the middle of a page or a segment, the
+// log comes back with every committed reading from the saved cursor on, in order, and keeps
+// working. Run with: pio test -e native-test
+#include <unity.h>
+#include <map>
+#include <vector>
+
+// Small segments, so a few pages reach the segment boundary and the size limit
+#define WAL_SEGMENT_PAGES 4
+#define WAL_MAX_SEGMENTS 6
+#include "flash_wal.h"
+
+// "Flash" in RAM that loses power after a given number of written bytes. A torn page is either
+// cut short (the segment ends mid-page) or has its tail filled with garbage (bad CRC).
+class RamWalStorage {
+public:
+  RamWalStorage() : budget(-1), garbageTail(false) {}
+
+  void cutPowerAfter(long bytes, bool garbage) { budget = bytes; garbageTail = garbage; }
+  void powerOn() { budget = -1; }
+  bool powered() const { return budget != 0; }
+  size_t segmentBytes(uint32_t seg) { return segs.count(seg) ? segs[seg].size() : 0; }
+
+  bool segmentRange(uint32_t& first, uint32_t& last) {
+    if (segs.empty()) return false;
+    first = segs.begin()->first;
+    last = segs.rbegin()->first;
+    return true;
+  }
+  uint32_t segmentPages(uint32_t seg) { return segmentBytes(seg) / WAL_PAGE_SIZE; }
+  bool readPage(uint32_t seg, uint32_t page, uint8_t* buf) {
+    if ((page + 1) * WAL_PAGE_SIZE > segmentBytes(seg)) return false;
+    memcpy(buf, segs[seg].data() + (size_t)page * WAL_PAGE_SIZE, WAL_PAGE_SIZE);
+    return true;
+  }
+  bool appendPage(uint32_t seg, const uint8_t* buf) {
+    if (budget == 0) return false;
+    std::vector<uint8_t>& f = segs[seg];
+    if (budget > 0 && budget < WAL_PAGE_SIZE) {
+      f.insert(f.end(), buf, buf + budget);
+      if (garbageTail) f.resize(f.size() + WAL_PAGE_SIZE - budget, 0xA5);
+      budget = 0;
+      return false;
+    }
+    f.insert(f.end(), buf, buf + WAL_PAGE_SIZE);
+    if (budget > 0) budget -= WAL_PAGE_SIZE;
+    return true;
+  }
+  void removeSegment(uint32_t seg) {
+    if (budget != 0) segs.erase(seg);
+  }
+  bool loadCursor(uint8_t* buf, size_t len) {
+    if (cursor.size() != len) return false;
+    memcpy(buf, cursor.data(), len);
+    return true;
+  }
+  bool saveCursor(const uint8_t* buf, size_t len) {
+    if (budget == 0) return false;
+    cursor.assign(buf, buf + len);  // Atomic, like a LittleFS file rewrite
+    return true;
+  }
+
+private:
+  std::map<uint32_t, std::vector<uint8_t>> segs;
+  std::vector<uint8_t> cursor;
+  long budget;
+  bool garbageTail;
+};
+
+static RamWalStorage* flash;
+static std::map<uint32_t, WalRecord> written;   // Everything append() accepted, by seq
+static uint32_t now;
+static uint32_t nextReading;
+
+void setUp(void) {
+  flash = new RamWalStorage();
+  written.clear();
+  now = 0;
+  nextReading = 0;
+}
+
+void tearDown(void) {
+  delete flash;
+}
+
+static void append(FlashWal<RamWalStorage>& wal) {
+  uint32_t i = nextReading++;
+  WalRecord r;
+  uint8_t mac[6] = {0x24, 0x6F, 0x28, 0x00, (uint8_t)(i >> 8), (uint8_t)i};
+  memcpy(r.mac, mac, 6);
+  r.rssi = -40 - (int16_t)(i % 50);
+  r.temperature = 18.0f + (i % 700) / 100.0f;
+  r.humidity = 30.0f + (i % 4000) / 100.0f;
+  r.co2 = i % 5 ? 400 + i % 2000 : CO2_NONE;
+  r.unix_s = 1700000000 + i * 10;
+  r.seq = wal.append(r, now);
+  written[r.seq] = r;
+}
+
+// Replay from seq on; every record must be the one written with that seq, with no gaps.
+// Returns the sequence number after the last record replayed.
+static uint32_t replayFrom(FlashWal<RamWalStorage>& wal, uint32_t seq) {
+  uint32_t expect = seq;
+  wal.replay(seq, [&](const WalRecord& r) {
+    TEST_ASSERT_EQUAL_UINT32(expect, r.seq);
+    TEST_ASSERT_TRUE(written.count(r.seq) == 1);
+    const WalRecord& w = written[r.seq];
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(w.mac, r.mac, 6);
+    TEST_ASSERT_EQUAL_INT(w.rssi, r.rssi);
+    TEST_ASSERT_EQUAL_FLOAT(w.temperature, r.temperature);
+    TEST_ASSERT_EQUAL_FLOAT(w.humidity, r.humidity);
+    TEST_ASSERT_EQUAL_UINT16(w.co2, r.co2);
+    TEST_ASSERT_EQUAL_UINT32(w.unix_s, r.unix_s);
+    expect++;
+  });
+  return expect;
+}
+
+// Readings keep arriving, uploads confirm all but the last `behind`, the uploader ticks every
+// second; stops when the power goes. Returns the cursor last written to flash (1 if none was).
+static uint32_t runUntilPowerLoss(FlashWal<RamWalStorage>& wal, uint32_t behind) {
+  uint32_t saved = 1;
+  for (int k = 0; flash->powered() && k < 100000; ++k) {
+    append(wal);
+    now += 1000;
+    if (wal.nextSeq() > behind + 1) wal.setCursor(wal.nextSeq() - behind);
+    uint32_t writes = wal.cursorWrites;
+    wal.tick(now);
+    if (wal.cursorWrites != writes) saved = wal.cursor();
+  }
+  TEST_ASSERT_FALSE(flash->powered());
+  return saved;
+}
+
+// After the reboot: replay from the cursor gets everything up to the torn page; only that page
+// and the open one may be missing. New readings go on after the last sequence number.
+static void assertRecovered(uint32_t expectCursor) {
+  flash->powerOn();
+  FlashWal<RamWalStorage> wal(*flash);
+  TEST_ASSERT_TRUE(wal.begin());
+  TEST_ASSERT_EQUAL_UINT32(expectCursor, wal.cursor());
+  uint32_t end = replayFrom(wal, wal.cursor());
+  uint32_t lastWritten = written.rbegin()->first;
+  TEST_ASSERT_LESS_OR_EQUAL(2 * WAL_RECORDS_PER_PAGE, lastWritten + 1 - end);
+  TEST_ASSERT_GREATER_OR_EQUAL(end, wal.nextSeq());
+
+  uint32_t firstNew = wal.nextSeq();
+  for (int k = 0; k < 2 * WAL_RECORDS_PER_PAGE + 3; ++k) append(wal);
+  wal.commit();
+  FlashWal<RamWalStorage> again(*flash);
+  again.begin();
+  TEST_ASSERT_EQUAL_UINT32(firstNew + 2 * WAL_RECORDS_PER_PAGE + 3, replayFrom(again, firstNew));
+  TEST_ASSERT_EQUAL_UINT32(firstNew + 2 * WAL_RECORDS_PER_PAGE + 3, again.nextSeq());
+}
+
+void test_clean_reboot(void) {
+  {
+    FlashWal<RamWalStorage> wal(*flash);
+    wal.begin();
+    TEST_ASSERT_EQUAL_UINT32(1, wal.nextSeq());
+    for (int k = 0; k < 3 * WAL_RECORDS_PER_PAGE + 5; ++k) append(wal);
+    wal.setCursor(20);
+    wal.tick(WAL_CURSOR_INTERVAL_MS);   // Writes the partial page and the cursor
+  }
+  FlashWal<RamWalStorage> wal(*flash);
+  wal.begin();
+  TEST_ASSERT_EQUAL_UINT32(20, wal.cursor());
+  TEST_ASSERT_EQUAL_UINT32(written.rbegin()->first + 1, wal.nextSeq());
+  TEST_ASSERT_EQUAL_UINT32(wal.nextSeq(), replayFrom(wal, wal.cursor()));
+  TEST_ASSERT_EQUAL_UINT32(0, wal.corruptPages);
+}
+
+// Power lost while a page is written, in the middle of a segment: the page is cut short
+void test_cut_mid_page_short(void) {
+  FlashWal<RamWalStorage> wal(*flash);
+  wal.begin();
+  flash->cutPowerAfter(3 * WAL_PAGE_SIZE + WAL_PAGE_SIZE / 2, false);
+  uint32_t cursor = runUntilPowerLoss(wal, 5);
+  TEST_ASSERT_EQUAL_UINT32(3 * WAL_PAGE_SIZE + WAL_PAGE_SIZE / 2, flash->segmentBytes(0));
+  TEST_ASSERT_GREATER_THAN(1, cursor);   // Saved before the cut
+  assertRecovered(cursor);
+}
+
+// Same, but the rest of the torn page is garbage: the bad CRC makes replay skip it
+void test_cut_mid_page_garbage(void) {
+  FlashWal<RamWalStorage> wal(*flash);
+  wal.begin();
+  flash->cutPowerAfter(2 * WAL_PAGE_SIZE + 17, true);
+  uint32_t cursor = runUntilPowerLoss(wal, 5);
+  TEST_ASSERT_EQUAL_UINT32(3 * WAL_PAGE_SIZE, flash->segmentBytes(0));
+  flash->powerOn();
+  FlashWal<RamWalStorage> reader(*flash);
+  reader.begin();
+  replayFrom(reader, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, reader.corruptPages);
+  assertRecovered(cursor);
+}
+
+// Power lost at every byte around a segment boundary, torn pages both short and garbage
+void test_cut_around_segment_boundary(void) {
+  long boundary = (long)WAL_SEGMENT_PAGES * WAL_PAGE_SIZE;
+  for (long cut = boundary - WAL_PAGE_SIZE - 1; cut <= boundary + WAL_PAGE_SIZE + 1; ++cut) {
+    for (int garbage = 0; garbage < 2; ++garbage) {
+      tearDown();
+      setUp();
+      FlashWal<RamWalStorage> wal(*flash);
+      wal.begin();
+      flash->cutPowerAfter(cut, garbage);
+      assertRecovered(runUntilPowerLoss(wal, 3));
+    }
+  }
+}
+
+// The cursor is only written every WAL_CURSOR_INTERVAL_MS: readings confirmed after the last
+// write are replayed again (the server may see them twice), none are skipped
+void test_cursor_resumes_from_last_save(void) {
+  FlashWal<RamWalStorage> wal(*flash);
+  wal.begin();
+  for (int k = 0; k < 40; ++k) append(wal);
+  wal.setCursor(30);
+  now = WAL_CURSOR_INTERVAL_MS;
+  wal.tick(now);
+  TEST_ASSERT_EQUAL_UINT32(1, wal.cursorWrites);
+  for (int k = 0; k < 40; ++k) append(wal);
+  wal.setCursor(70);
+  wal.tick(now + WAL_COMMIT_INTERVAL_MS);   // Page written, cursor not due yet
+  TEST_ASSERT_EQUAL_UINT32(1, wal.cursorWrites);
+  flash->cutPowerAfter(0, false);
+  assertRecovered(30);
+}
+
+// A log without a cursor record (lost before the first save) is uploaded from its oldest reading
+void test_no_cursor_replays_everything(void) {
+  FlashWal<RamWalStorage> wal(*flash);
+  wal.begin();
+  for (int k = 0; k < WAL_RECORDS_PER_PAGE + 4; ++k) append(wal);
+  wal.commit();
+  flash->cutPowerAfter(0, false);
+  assertRecovered(1);
+}
+
+// Beyond WAL_MAX_SEGMENTS the oldest segment is dropped even if it was not uploaded; the cursor
+// moves past it and the dropped readings are counted
+void test_log_full_drops_oldest_segment(void) {
+  FlashWal<RamWalStorage> wal(*flash);
+  wal.begin();
+  uint32_t perSegment = WAL_SEGMENT_PAGES * WAL_RECORDS_PER_PAGE;
+  for (uint32_t k = 0; k < perSegment * WAL_MAX_SEGMENTS + WAL_RECORDS_PER_PAGE; ++k) append(wal);
+  TEST_ASSERT_EQUAL_UINT32(WAL_MAX_SEGMENTS, wal.segments());
+  TEST_ASSERT_EQUAL_UINT32(1 + perSegment, wal.cursor());
+  TEST_ASSERT_EQUAL_UINT32(perSegment, wal.lostRecords);
+  TEST_ASSERT_EQUAL_UINT32(wal.nextSeq(), replayFrom(wal, wal.cursor()));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_reboot);
+  RUN_TEST(test_cut_mid_page_short);
+  RUN_TEST(test_cut_mid_page_garbage);
+  RUN_TEST(test_cut_around_segment_boundary);
+  RUN_TEST(test_cursor_resumes_from_last_save);
+  RUN_TEST(test_no_cursor_replays_everything);
+  RUN_TEST(test_log_full_drops_oldest_segment);
+  return UNITY_END();
+}
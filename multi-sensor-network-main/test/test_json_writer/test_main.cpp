@@ -0,0 +1,119 @@
+// JsonWriter (include/json_writer.h): number formatting, the reading schema the ingest endpoints
+// parse, and behaviour at the end of the buffer. Run with: pio test -e native-test
+#include <unity.h>
+#include <math.h>
+
+#include "json_writer.h"
+
+static char buf[256];
+
+void setUp(void) {
+  memset(buf, 'x', sizeof(buf));
+}
+
+void tearDown(void) {}
+
+void test_integers(void) {
+  JsonWriter w(buf, sizeof(buf));
+  w.u32(0);
+  w.raw(',');
+  w.u32(4294967295u);
+  w.raw(',');
+  w.i32(-2147483647 - 1);
+  w.raw(',');
+  w.i32(42);
+  TEST_ASSERT_EQUAL_STRING("0,4294967295,-2147483648,42", w.c_str());
+  TEST_ASSERT_EQUAL_UINT32(strlen(w.c_str()), w.length());
+  TEST_ASSERT_FALSE(w.overflow());
+}
+
+void test_fixed_point(void) {
+  JsonWriter w(buf, sizeof(buf));
+  w.fixed(21.5f, 2);
+  w.raw(',');
+  w.fixed(-1.25f, 1);     // Half away from zero, like String(value, 1)
+  w.raw(',');
+  w.fixed(-0.004f, 2);    // Rounds to zero: no "-0.00"
+  w.raw(',');
+  w.fixed(7.0f, 0);
+  w.raw(',');
+  w.fixed(0.000001f, 9);  // At most 6 decimals
+  TEST_ASSERT_EQUAL_STRING("21.50,-1.3,0.00,7,0.000001", w.c_str());
+}
+
+// Not valid JSON numbers, or out of range: written as null
+void test_fixed_not_finite(void) {
+  JsonWriter w(buf, sizeof(buf));
+  w.fixed(NAN, 2);
+  w.raw(',');
+  w.fixed(INFINITY, 2);
+  w.raw(',');
+  w.fixed(-1e30f, 2);
+  w.raw(',');
+  w.fixed(-5e9f, 0);      // Integer part wider than 32 bits: no "-null"
+  w.raw(',');
+  w.fixed(-4e9f, 0);
+  TEST_ASSERT_EQUAL_STRING("null,null,null,null,-4000000000", w.c_str());
+}
+
+void test_reading_schema(void) {
+  const uint8_t mac[6] = {0x24, 0x6F, 0x28, 0xAB, 0x0C, 0xFF};
+  JsonWriter w(buf, sizeof(buf));
+  writeReadingJson(w, mac, 21.456f, 40.0f, 415);
+  TEST_ASSERT_EQUAL_STRING("{\"mac\":\"24:6F:28:AB:0C:FF\",\"device_id\":\"24:6F:28:AB:0C:FF\","
+                           "\"temperature\":21.46,\"humidity\":40.00,\"co2\":415}", w.c_str());
+
+  JsonWriter w2(buf, sizeof(buf));
+  size_t ageAt = writeReadingJsonAgeSlot(w2, mac, -5.0f, 99.5f, CO2_NONE);
+  w2.fillU32(ageAt, 4294967295u);
+  w2.fillU32(ageAt, 1234);   // Filled again (upload retried later): no digits of the old value left
+  TEST_ASSERT_EQUAL_STRING("{\"mac\":\"24:6F:28:AB:0C:FF\",\"device_id\":\"24:6F:28:AB:0C:FF\","
+                           "\"temperature\":-5.00,\"humidity\":99.50,\"co2\":null,\"age_ms\":1234      }", w2.c_str());
+}
+
+// A slot that does not fit sets overflow; filling it does not write past the end
+void test_u32_slot_overflow(void) {
+  char small[12];
+  JsonWriter w(small, sizeof(small));
+  w.raw("{\"a\":");
+  size_t at = w.u32Slot();
+  TEST_ASSERT_TRUE(w.overflow());
+  w.fillU32(at, 99);
+  TEST_ASSERT_EQUAL_STRING("{\"a\":", w.c_str());
+}
+
+// A full buffer stops writing, stays NUL-terminated, and truncate() undoes the partial record
+void test_overflow_and_truncate(void) {
+  char small[16];
+  JsonWriter w(small, sizeof(small));
+  w.raw("[1,");
+  size_t mark = w.length();
+  w.raw("\"0123456789\"");
+  TEST_ASSERT_FALSE(w.overflow());
+  w.u32(123456);
+  TEST_ASSERT_TRUE(w.overflow());
+  TEST_ASSERT_EQUAL_UINT32(w.length(), strlen(small));   // Unchanged, still terminated
+  w.truncate(mark);
+  TEST_ASSERT_FALSE(w.overflow());
+  w.raw("2]");
+  TEST_ASSERT_EQUAL_STRING("[1,2]", w.c_str());
+
+  const uint8_t mac[6] = {1, 2, 3, 4, 5, 6};
+  JsonWriter tiny(small, 3);
+  tiny.mac(mac);     // Needs 20 bytes
+  TEST_ASSERT_TRUE(tiny.overflow());
+  TEST_ASSERT_EQUAL_STRING("", tiny.c_str());
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_integers);
+  RUN_TEST(test_fixed_point);
+  RUN_TEST(test_fixed_not_finite);
+  RUN_TEST(test_reading_schema);
+  RUN_TEST(test_u32_slot_overflow);
+  RUN_TEST(test_overflow_and_truncate);
+  return UNITY_END();
+}
@@ -0,0 +1,138 @@
+// Deferred log records (include/log_record.h): arguments survive encode -> format as printf
+// would have printed them, the ring hands records back in order across its wrap, and binary
+// frames carry the right CRC. Run with: pio test -e native-test
+#include <unity.h>
+#include <string>
+
+#include "log_record.h"
+
+static uint8_t rec[LOG_MAX_RECORD];
+static char line[256];
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Encode fmt and args into a record, parse it back and format it
+template <typename... Args>
+static const char* roundTrip(const char* fmt, Args... args) {
+  size_t len = logEncode(rec, sizeof(rec), LOG_LEVEL_INFO, 123456789u, fmt, args...);
+  LogRecordView v;
+  TEST_ASSERT_TRUE(logParseRecord(rec, len, v));
+  TEST_ASSERT_EQUAL_STRING(fmt, v.fmt);   // Same pointer: formats stay in flash
+  TEST_ASSERT_EQUAL_UINT32(123456789u, v.t_us);
+  TEST_ASSERT_EQUAL_UINT8(LOG_LEVEL_INFO, v.level);
+  logFormatArgs(line, sizeof(line), v.fmt, v.args, v.argLen);
+  return line;
+}
+
+void test_integers(void) {
+  TEST_ASSERT_EQUAL_STRING("-5 250 -1 4294967295 -9000000000 18446744073709551615",
+                           roundTrip("%d %u %ld %lu %lld %llu", (int8_t)-5, (uint8_t)250, -1L,
+                                     4294967295UL, -9000000000LL, 18446744073709551615ULL));
+  TEST_ASSERT_EQUAL_STRING("0x00ff|  42|42  |A", roundTrip("0x%04x|%4d|%-4u|%c", 255, 42, 42u, 'A'));
+}
+
+void test_floats_and_width_star(void) {
+  TEST_ASSERT_EQUAL_STRING("21.50 -0.125 1e+06", roundTrip("%.2f %.3f %g", 21.5f, -0.125, 1e6));
+  TEST_ASSERT_EQUAL_STRING("[   7.25]", roundTrip("[%*.*f]", 7, 2, 7.25));
+}
+
+void test_strings(void) {
+  char mutableBuf[8] = "ssid";
+  TEST_ASSERT_EQUAL_STRING("WiFi ssid: (null) 100%", roundTrip("WiFi %s: %s 100%%", mutableBuf, (const char*)NULL));
+  // Copied at the call: changing the buffer afterwards does not change the record
+  size_t len = logEncode(rec, sizeof(rec), LOG_LEVEL_WARN, 0, "%s", mutableBuf);
+  strcpy(mutableBuf, "other");
+  LogRecordView v;
+  logParseRecord(rec, len, v);
+  logFormatArgs(line, sizeof(line), v.fmt, v.args, v.argLen);
+  TEST_ASSERT_EQUAL_STRING("ssid", line);
+
+  std::string longStr(100, 'x');
+  roundTrip("%s", longStr.c_str());
+  TEST_ASSERT_EQUAL_UINT32(LOG_MAX_STR, strlen(line));
+}
+
+// Missing or mismatched arguments print as "?", never read past the record
+void test_mismatched_arguments(void) {
+  TEST_ASSERT_EQUAL_STRING("1 ? ?", roundTrip("%d %s %d", 1, 2));
+}
+
+// Arguments that do not fit in LOG_MAX_RECORD are left out
+void test_record_full(void) {
+  std::string s(LOG_MAX_STR, 'y');
+  const char* p = s.c_str();
+  size_t len = logEncode(rec, sizeof(rec), LOG_LEVEL_DEBUG, 0, "%s%s%s%d", p, p, p, 7);
+  TEST_ASSERT_LESS_OR_EQUAL(LOG_MAX_RECORD, len);
+  LogRecordView v;
+  logParseRecord(rec, len, v);
+  logFormatArgs(line, sizeof(line), v.fmt, v.args, v.argLen);
+  TEST_ASSERT_EQUAL_STRING("?", line + strlen(line) - 1);
+}
+
+void test_ring_order_and_wrap(void) {
+  static LogRing<256> ring;
+  uint32_t next = 0, expect = 0;
+  // Records of varying length, many times around the ring
+  for (int round = 0; round < 50; ++round) {
+    for (int i = 0; i < 3; ++i) {
+      uint8_t r[40];
+      uint32_t len = 4 + (next % 33);
+      memset(r, 0, sizeof(r));
+      memcpy(r, &next, 4);
+      TEST_ASSERT_TRUE(ring.write(r, len));
+      next++;
+    }
+    ring.drain([&](const uint8_t* r, uint32_t len) {
+      uint32_t n;
+      memcpy(&n, r, 4);
+      TEST_ASSERT_EQUAL_UINT32(expect, n);
+      TEST_ASSERT_EQUAL_UINT32(4 + (n % 33), len);
+      expect++;
+    });
+  }
+  TEST_ASSERT_EQUAL_UINT32(next, expect);
+  TEST_ASSERT_EQUAL_UINT32(0, ring.used());
+  TEST_ASSERT_EQUAL_UINT32(0, ring.dropCount());
+}
+
+void test_ring_full_drops(void) {
+  static LogRing<256> ring;
+  uint8_t r[60] = {0};
+  int written = 0;
+  while (ring.write(r, sizeof(r))) written++;
+  TEST_ASSERT_EQUAL_INT(256 / 64, written);
+  TEST_ASSERT_EQUAL_UINT32(1, ring.dropCount());
+  TEST_ASSERT_FALSE(ring.write(r, LOG_MAX_RECORD + 1));
+  TEST_ASSERT_EQUAL_UINT32(written, ring.drain([](const uint8_t*, uint32_t) {}));
+  TEST_ASSERT_TRUE(ring.write(r, sizeof(r)));
+}
+
+void test_binary_frame(void) {
+  TEST_ASSERT_EQUAL_HEX8(0xF4, logCrc8((const uint8_t*)"123456789", 9));   // CRC-8 check value
+  const uint8_t payload[3] = {0x01, 0x00, 'x'};
+  uint8_t out[3 + 4];
+  TEST_ASSERT_EQUAL_UINT32(7, logFrame(out, LOG_FRAME_FORMAT, payload, 3));
+  TEST_ASSERT_EQUAL_HEX8(LOG_FRAME_SYNC, out[0]);
+  TEST_ASSERT_EQUAL_HEX8(LOG_FRAME_FORMAT, out[1]);
+  TEST_ASSERT_EQUAL_UINT8(3, out[2]);
+  TEST_ASSERT_EQUAL_HEX8(logCrc8(out + 1, 5), out[6]);
+  TEST_ASSERT_EQUAL_UINT8('I', logLevelChar(LOG_LEVEL_INFO));
+  TEST_ASSERT_EQUAL_UINT8('?', logLevelChar(9));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_integers);
+  RUN_TEST(test_floats_and_width_star);
+  RUN_TEST(test_strings);
+  RUN_TEST(test_mismatched_arguments);
+  RUN_TEST(test_record_full);
+  RUN_TEST(test_ring_order_and_wrap);
+  RUN_TEST(test_ring_full_drops);
+  RUN_TEST(test_binary_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,126 @@
+// SeqTracker (include/seq_tracker.h): loss, duplicate, reorder and restart accounting per station.
+// Run with: pio test -e native-test
+#include <unity.h>
+
+#include "seq_tracker.h"
+
+static SeqTracker link;
+
+void setUp(void) {
+  link = SeqTracker();
+}
+
+void tearDown(void) {}
+
+void test_in_order(void) {
+  for (uint32_t s = 0; s < 100; ++s) TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(1, s));
+  TEST_ASSERT_EQUAL_UINT32(100, link.received);
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, link.duplicates);
+  TEST_ASSERT_EQUAL_UINT32(99, link.highestSeq());
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, link.lossRate());
+}
+
+void test_gap_counts_as_lost(void) {
+  link.accept(1, 0);
+  link.accept(1, 1);
+  TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(1, 5));   // 2, 3, 4 missing
+  TEST_ASSERT_EQUAL_UINT32(3, link.received);
+  TEST_ASSERT_EQUAL_UINT32(3, link.lost);
+  TEST_ASSERT_EQUAL_FLOAT(0.5f, link.lossRate());
+}
+
+void test_late_frame_is_no_longer_lost(void) {
+  link.accept(1, 0);
+  link.accept(1, 3);
+  TEST_ASSERT_EQUAL(SEQ_REORDERED, link.accept(1, 2));
+  TEST_ASSERT_EQUAL(SEQ_REORDERED, link.accept(1, 1));
+  TEST_ASSERT_EQUAL_UINT32(4, link.received);
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost);
+  TEST_ASSERT_EQUAL_UINT32(2, link.reordered);
+}
+
+void test_duplicates(void) {
+  link.accept(1, 0);
+  link.accept(1, 1);
+  TEST_ASSERT_EQUAL(SEQ_DUPLICATE, link.accept(1, 1));   // Highest again
+  TEST_ASSERT_EQUAL(SEQ_DUPLICATE, link.accept(1, 0));   // Inside the window
+  TEST_ASSERT_EQUAL_UINT32(2, link.received);
+  TEST_ASSERT_EQUAL_UINT32(2, link.duplicates);
+}
+
+// Bit SEQ_WINDOW - 1 is the oldest one the window still tells apart
+void test_window_edge(void) {
+  link.accept(1, 0);
+  link.accept(1, 200);
+  TEST_ASSERT_EQUAL(SEQ_REORDERED, link.accept(1, 200 - (SEQ_WINDOW - 1)));
+  TEST_ASSERT_EQUAL(SEQ_DUPLICATE, link.accept(1, 200 - (SEQ_WINDOW - 1)));
+  TEST_ASSERT_EQUAL(SEQ_STALE, link.accept(1, 200 - SEQ_WINDOW));
+  TEST_ASSERT_EQUAL_UINT32(1, link.stale);
+}
+
+// A jump of SEQ_WINDOW or more clears the window: nothing below the new highest counts as seen
+void test_long_jump_clears_window(void) {
+  link.accept(1, 100);
+  TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(1, 100 + SEQ_WINDOW));
+  TEST_ASSERT_EQUAL(SEQ_REORDERED, link.accept(1, 101));
+  TEST_ASSERT_EQUAL_UINT32(SEQ_WINDOW - 2, link.lost);
+}
+
+void test_new_boot_restarts(void) {
+  link.accept(1, 50);
+  link.accept(1, 51);
+  TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(2, 0));
+  TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(2, 1));
+  TEST_ASSERT_EQUAL_UINT32(1, link.restarts);
+  TEST_ASSERT_EQUAL_UINT32(0, link.lost);
+  TEST_ASSERT_EQUAL_UINT16(2, link.currentBoot());
+}
+
+// A frame from the previous boot arriving late neither restarts the sequence nor clears the
+// window of the current boot
+void test_old_boot_is_stale(void) {
+  link.accept(1, 50);
+  link.accept(2, 0);
+  link.accept(2, 1);
+  TEST_ASSERT_EQUAL(SEQ_STALE, link.accept(1, 9));
+  TEST_ASSERT_EQUAL(SEQ_DUPLICATE, link.accept(2, 1));
+  TEST_ASSERT_EQUAL_UINT32(1, link.restarts);
+  TEST_ASSERT_EQUAL_UINT32(1, link.stale);
+  TEST_ASSERT_EQUAL_UINT16(2, link.currentBoot());
+}
+
+// The boot counter wraps: 0 comes after 65535
+void test_boot_counter_wraps(void) {
+  link.accept(65535, 10);
+  TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(0, 0));
+  TEST_ASSERT_EQUAL(SEQ_STALE, link.accept(65535, 11));
+  TEST_ASSERT_EQUAL_UINT32(1, link.restarts);
+}
+
+// Counter back at 0 with the same boot number (station could not save its boot counter)
+void test_counter_reset_without_new_boot(void) {
+  for (uint32_t s = 0; s < 200; ++s) link.accept(1, s);
+  TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(1, 0));
+  TEST_ASSERT_EQUAL(SEQ_NEW, link.accept(1, 1));
+  TEST_ASSERT_EQUAL_UINT32(1, link.restarts);
+  TEST_ASSERT_EQUAL_UINT32(0, link.duplicates);
+  TEST_ASSERT_EQUAL_UINT32(0, link.stale);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_in_order);
+  RUN_TEST(test_gap_counts_as_lost);
+  RUN_TEST(test_late_frame_is_no_longer_lost);
+  RUN_TEST(test_duplicates);
+  RUN_TEST(test_window_edge);
+  RUN_TEST(test_long_jump_clears_window);
+  RUN_TEST(test_new_boot_restarts);
+  RUN_TEST(test_old_boot_is_stale);
+  RUN_TEST(test_boot_counter_wraps);
+  RUN_TEST(test_counter_reset_without_new_boot);
+  return UNITY_END();
+}
@@ -0,0 +1,145 @@
+// StationHistory (include/station_history.h): samples come back out of the compressed blocks
+// exactly as they went in. Run with: pio test -e native-test
+#include <unity.h>
+#include <vector>
+
+#include "station_history.h"
+
+static const uint8_t MAC_A[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+static const uint8_t MAC_B[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x02};
+
+static uint8_t pool[16 * 1024];
+static StationHistory<4, 256> history;
+
+void setUp(void) {
+  history.begin(pool, sizeof(pool), 7 * 24 * 3600);
+}
+
+void tearDown(void) {}
+
+static std::vector<HistorySample> readBack(const uint8_t* mac, uint32_t t0 = 0, uint32_t t1 = 0xFFFFFFFF) {
+  std::vector<HistorySample> out;
+  history.query(mac, t0, t1, [&](const HistorySample& s) { out.push_back(s); });
+  return out;
+}
+
+static void assertSamples(const std::vector<HistorySample>& in, const std::vector<HistorySample>& out) {
+  TEST_ASSERT_EQUAL_UINT32(in.size(), out.size());
+  for (size_t i = 0; i < in.size(); ++i) {
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(in[i].t, out[i].t, "timestamp");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(historyFloatBits(in[i].temperature), historyFloatBits(out[i].temperature), "temperature");
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(historyFloatBits(in[i].humidity), historyFloatBits(out[i].humidity), "humidity");
+    TEST_ASSERT_EQUAL_UINT16_MESSAGE(in[i].co2, out[i].co2, "co2");
+  }
+}
+
+// Every edge of the 7, 9 and 12-bit delta-of-delta fields, and the 32-bit escape
+void test_timestamp_delta_of_delta_boundaries(void) {
+  const int32_t dods[] = {0, 1, -1, 63, -64, 64, -65, 255, -256, 256, -257,
+                          2047, -2048, 2048, -2049, 100000, -100000, 0};
+  std::vector<HistorySample> in;
+  uint32_t t = 1700000000;
+  int32_t delta = 5000;
+  in.push_back({t, 21.5f, 40.0f, 420});
+  t += delta;
+  in.push_back({t, 21.5f, 40.0f, 420});
+  for (int32_t dod : dods) {
+    delta += dod;
+    t += delta;
+    in.push_back({t, 21.5f, 40.0f, 420});
+  }
+  for (const HistorySample& s : in) TEST_ASSERT_TRUE(history.append(MAC_A, s));
+  TEST_ASSERT_EQUAL_UINT32(1, history.blocksUsed());
+  assertSamples(in, readBack(MAC_A));
+}
+
+// The case that first showed the problem: a +64 jump after a steady interval
+void test_timestamp_steady_then_jump(void) {
+  const uint32_t ts[] = {1000, 1010, 1020, 1094, 1168, 1242, 1572, 1902, 4000, 4010};
+  std::vector<HistorySample> in;
+  for (uint32_t t : ts) in.push_back({t, 20.0f, 50.0f, 600});
+  for (const HistorySample& s : in) TEST_ASSERT_TRUE(history.append(MAC_A, s));
+  assertSamples(in, readBack(MAC_A));
+}
+
+void test_values_round_trip(void) {
+  std::vector<HistorySample> in;
+  uint32_t seed = 12345;
+  for (uint32_t i = 0; i < 200; ++i) {
+    seed = seed * 1103515245 + 12345;
+    float noise = (int32_t)((seed >> 16) % 21 - 10) / 100.0f;
+    uint16_t co2 = (i % 50 == 0) ? 0 : (i % 37 == 0) ? 40000 : (i % 3 == 1) ? CO2_NONE :
+                   (uint16_t)(400 + (seed >> 8) % 600);
+    in.push_back({1700000000 + i * 10, 22.0f + noise, 45.0f - noise * 3, co2});
+  }
+  for (const HistorySample& s : in) TEST_ASSERT_TRUE(history.append(MAC_A, s));
+  TEST_ASSERT_GREATER_THAN(1, history.blocksUsed());
+  assertSamples(in, readBack(MAC_A));
+}
+
+// Readings without CO2 come back without CO2 and do not disturb the values around them
+void test_co2_absent(void) {
+  std::vector<HistorySample> in = {
+    {100, 20.0f, 50.0f, CO2_NONE}, {110, 20.1f, 50.0f, 650}, {120, 20.1f, 50.1f, CO2_NONE},
+    {130, 20.2f, 50.1f, CO2_NONE}, {140, 20.2f, 50.2f, 640}, {150, 20.3f, 50.2f, 0},
+    {160, 20.3f, 50.3f, CO2_NONE}, {170, 20.3f, 50.3f, 5000},
+  };
+  for (const HistorySample& s : in) TEST_ASSERT_TRUE(history.append(MAC_A, s));
+  assertSamples(in, readBack(MAC_A));
+}
+
+void test_query_window_and_stations(void) {
+  for (uint32_t i = 0; i < 100; ++i) {
+    history.append(MAC_A, {1000 + i * 10, 20.0f, 50.0f, 500});
+    history.append(MAC_B, {1000 + i * 10, 25.0f, 30.0f, 800});
+  }
+  std::vector<HistorySample> a = readBack(MAC_A, 1200, 1299);
+  TEST_ASSERT_EQUAL_UINT32(10, a.size());
+  TEST_ASSERT_EQUAL_UINT32(1200, a.front().t);
+  TEST_ASSERT_EQUAL_UINT32(1290, a.back().t);
+  std::vector<HistorySample> b = readBack(MAC_B);
+  TEST_ASSERT_EQUAL_UINT32(100, b.size());
+  TEST_ASSERT_EQUAL_UINT16(800, b[50].co2);
+  const uint8_t unknown[6] = {1, 2, 3, 4, 5, 6};
+  TEST_ASSERT_EQUAL_UINT32(0, readBack(unknown).size());
+}
+
+// A reading older than the station's last one is dropped, so later blocks stay reachable
+void test_late_reading_dropped(void) {
+  for (uint32_t i = 0; i < 100; ++i) TEST_ASSERT_TRUE(history.append(MAC_A, {1000 + i * 10, 20.0f, 50.0f, 500}));
+  TEST_ASSERT_FALSE(history.append(MAC_A, {1500, 21.0f, 51.0f, 510}));
+  TEST_ASSERT_EQUAL_UINT32(1, history.late);
+  TEST_ASSERT_TRUE(history.append(MAC_A, {1990, 20.0f, 50.0f, 500}));   // Same time as the last: kept
+  for (uint32_t i = 0; i < 200; ++i) history.append(MAC_A, {2000 + i * 10, 20.0f + (i % 7), 50.0f, 500});
+  TEST_ASSERT_GREATER_THAN(1, history.blocksUsed());
+  std::vector<HistorySample> out = readBack(MAC_A, 2000, 3990);
+  TEST_ASSERT_EQUAL_UINT32(200, out.size());
+  TEST_ASSERT_EQUAL_UINT32(3990, out.back().t);
+  TEST_ASSERT_EQUAL_UINT32(301, readBack(MAC_A).size());
+}
+
+void test_retention_drops_old_blocks(void) {
+  history.begin(pool, sizeof(pool), 3600);
+  for (uint32_t i = 0; i < 2000; ++i) history.append(MAC_A, {1000 + i * 10, 20.0f + (i % 7), 50.0f, 500});
+  std::vector<HistorySample> out = readBack(MAC_A);
+  TEST_ASSERT_LESS_THAN(2000, out.size());
+  TEST_ASSERT_EQUAL_UINT32(1000 + 1999 * 10, out.back().t);
+  // Whole blocks are dropped, so up to one block more than the window is kept
+  TEST_ASSERT_LESS_OR_EQUAL(2 * 3600, out.back().t - out.front().t);
+  TEST_ASSERT_GREATER_OR_EQUAL(3600, out.back().t - out.front().t);
+  TEST_ASSERT_EQUAL_UINT32(0, history.evicted);
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_timestamp_delta_of_delta_boundaries);
+  RUN_TEST(test_timestamp_steady_then_jump);
+  RUN_TEST(test_values_round_trip);
+  RUN_TEST(test_co2_absent);
+  RUN_TEST(test_query_window_and_stations);
+  RUN_TEST(test_late_reading_dropped);
+  RUN_TEST(test_retention_drops_old_blocks);
+  return UNITY_END();
+}
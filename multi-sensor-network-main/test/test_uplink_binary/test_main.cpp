@@ -0,0 +1,111 @@
+// Binary uplink encoder (include/uplink_binary.h): the batch matches the layout documented in the
+// header, byte for byte, the way the ingest servers parse it. Run with: pio test -e native-test
+#include <unity.h>
+
+#include "uplink_binary.h"
+
+static const uint8_t MAC_A[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x01};
+static const uint8_t MAC_B[6] = {0x24, 0x6F, 0x28, 0x00, 0x00, 0x02};
+
+static uint8_t buf[512];
+static UplinkBinaryEncoder<4> enc;
+
+void setUp(void) {
+  memset(buf, 0xEE, sizeof(buf));
+  enc.begin(buf, sizeof(buf));
+}
+
+void tearDown(void) {}
+
+static const uint8_t* record(uint16_t i) {
+  return buf + UPLINK_BIN_HEADER_LEN + (size_t)i * UPLINK_BIN_RECORD_LEN;
+}
+
+void test_crc32_check_value(void) {
+  TEST_ASSERT_EQUAL_UINT32(0xCBF43926, uplinkCrc32((const uint8_t*)"123456789", 9));
+  // Chained over two pieces: same as in one go
+  TEST_ASSERT_EQUAL_UINT32(0xCBF43926, uplinkCrc32((const uint8_t*)"6789", 4,
+                                                   uplinkCrc32((const uint8_t*)"12345", 5)));
+}
+
+void test_fixed_point_clamps(void) {
+  TEST_ASSERT_EQUAL_INT(-1234, uplinkToCenti(-12.34f));
+  TEST_ASSERT_EQUAL_INT(INT16_MAX, uplinkToCenti(1000.0f));
+  TEST_ASSERT_EQUAL_INT(INT16_MIN, uplinkToCenti(-1000.0f));
+  TEST_ASSERT_EQUAL_UINT16(0, uplinkToCentiU(-1.0f));
+  TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, uplinkToCentiU(1000.0f));
+}
+
+void test_batch_layout(void) {
+  TEST_ASSERT_TRUE(enc.add(MAC_A, 21.5f, 40.25f, 415, -60, 1000));
+  TEST_ASSERT_TRUE(enc.add(MAC_B, -3.0f, 99.0f, CO2_NONE, -200, 1500));
+  TEST_ASSERT_TRUE(enc.add(MAC_A, 22.0f, 41.0f, 0, 10, 2000));
+  size_t len = enc.finish(2500);
+
+  TEST_ASSERT_EQUAL_UINT32(UPLINK_BIN_HEADER_LEN + 3 * UPLINK_BIN_RECORD_LEN + 2 * UPLINK_BIN_MAC_LEN +
+                           UPLINK_BIN_CRC_LEN, len);
+  TEST_ASSERT_EQUAL_UINT8('M', buf[0]);
+  TEST_ASSERT_EQUAL_UINT8('S', buf[1]);
+  TEST_ASSERT_EQUAL_UINT8(UPLINK_BIN_VERSION, buf[2]);
+  TEST_ASSERT_EQUAL_UINT16(2, uplinkGetU16(buf + 4));
+  TEST_ASSERT_EQUAL_UINT16(3, uplinkGetU16(buf + 6));
+
+  TEST_ASSERT_EQUAL_UINT16(0, uplinkGetU16(record(0)));
+  TEST_ASSERT_EQUAL_UINT16(2150, uplinkGetU16(record(0) + 2));
+  TEST_ASSERT_EQUAL_UINT16(4025, uplinkGetU16(record(0) + 4));
+  TEST_ASSERT_EQUAL_UINT16(415, uplinkGetU16(record(0) + 6));
+  TEST_ASSERT_EQUAL_INT(-60, (int8_t)record(0)[8]);
+  TEST_ASSERT_EQUAL_UINT32(1500, uplinkGetU32(record(0) + 9));   // Age at finish()
+
+  TEST_ASSERT_EQUAL_UINT16(1, uplinkGetU16(record(1)));
+  TEST_ASSERT_EQUAL_INT(-300, (int16_t)uplinkGetU16(record(1) + 2));
+  TEST_ASSERT_EQUAL_UINT16(CO2_NONE, uplinkGetU16(record(1) + 6));
+  TEST_ASSERT_EQUAL_INT(-128, (int8_t)record(1)[8]);             // RSSI clamped to i8
+  TEST_ASSERT_EQUAL_UINT32(1000, uplinkGetU32(record(1) + 9));
+
+  TEST_ASSERT_EQUAL_UINT16(0, uplinkGetU16(record(2)));          // MAC_A again: same index
+  TEST_ASSERT_EQUAL_UINT16(0, uplinkGetU16(record(2) + 6));      // A real 0 ppm is not "absent"
+  TEST_ASSERT_EQUAL_UINT32(500, uplinkGetU32(record(2) + 9));
+
+  const uint8_t* table = record(3);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(MAC_A, table, 6);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(MAC_B, table + 6, 6);
+  TEST_ASSERT_EQUAL_UINT32(uplinkCrc32(buf, len - UPLINK_BIN_CRC_LEN), uplinkGetU32(buf + len - UPLINK_BIN_CRC_LEN));
+}
+
+// Receive times before a millis() wrap still give the right age
+void test_age_across_millis_wrap(void) {
+  enc.add(MAC_A, 20.0f, 50.0f, 400, -50, 0xFFFFFF00u);
+  enc.finish(0x100);
+  TEST_ASSERT_EQUAL_UINT32(0x200, uplinkGetU32(record(0) + 9));
+}
+
+// Full buffer or full station table: add() refuses and the batch stays consistent
+void test_limits(void) {
+  const uint8_t macs[5][6] = {{1}, {2}, {3}, {4}, {5}};
+  for (int i = 0; i < 4; ++i) TEST_ASSERT_TRUE(enc.add(macs[i], 20.0f, 50.0f, 400, -50, 0));
+  TEST_ASSERT_FALSE(enc.add(macs[4], 20.0f, 50.0f, 400, -50, 0));
+  TEST_ASSERT_TRUE(enc.add(macs[0], 20.0f, 50.0f, 400, -50, 0));
+  TEST_ASSERT_EQUAL_UINT16(5, enc.records());
+
+  size_t cap = UPLINK_BIN_HEADER_LEN + 2 * UPLINK_BIN_RECORD_LEN + UPLINK_BIN_MAC_LEN + UPLINK_BIN_CRC_LEN;
+  enc.begin(buf, cap);
+  TEST_ASSERT_EQUAL_UINT32(cap - UPLINK_BIN_RECORD_LEN, enc.sizeIfAdded(MAC_A));
+  TEST_ASSERT_TRUE(enc.add(MAC_A, 20.0f, 50.0f, 400, -50, 0));
+  TEST_ASSERT_FALSE(enc.add(MAC_B, 20.0f, 50.0f, 400, -50, 0));   // Its MAC would not fit
+  TEST_ASSERT_TRUE(enc.add(MAC_A, 20.0f, 50.0f, 400, -50, 0));
+  TEST_ASSERT_FALSE(enc.add(MAC_A, 20.0f, 50.0f, 400, -50, 0));
+  TEST_ASSERT_EQUAL_UINT32(cap, enc.finish(0));
+}
+
+int main(int argc, char** argv) {
+  (void)argc;
+  (void)argv;
+  UNITY_BEGIN();
+  RUN_TEST(test_crc32_check_value);
+  RUN_TEST(test_fixed_point_clamps);
+  RUN_TEST(test_batch_layout);
+  RUN_TEST(test_age_across_millis_wrap);
+  RUN_TEST(test_limits);
+  return UNITY_END();
+}
@@ -0,0 +1,383 @@
+// Host battery-life simulator for a station: steps the STATE_START_MEASURE -> STATE_READ_VALUE
+// (-> STATE_CALI_ROUTINE) cycle of src/station/main.cpp wake by wake until the battery is empty,
+// for every combination of a parameter grid, spread over all cores.
+//
+// Build and run (from the project root):
+//   g++ -O2 -std=c++17 -pthread -Iinclude tools/battery_sim.cpp -o battery_sim && ./battery_sim
+//
+// Timing constants come from include/config.h, SDA41_sensor.h and espnow_proto.h (read as text, so the
+// tool follows the firmware without building it): MEASUREMENT_INTERVAL, FAN_DURATION and useFan,
+// CALI_PERIOD, STATION_BATCH_READINGS, SCD41_MODE, SCD41_CO2_EVERY, the SCD41 command timings, ...
+// -DNAME=VALUE overrides a define the way build_flags in platformio.ini do.
+//
+// Phase durations and currents have defaults below (see tools/battery_profile.txt for what they
+// mean and where they come from); --profile reads "key = value" lines over them. The durations
+// are best taken from the gateway's "Diagnostics from" output of a real station.
+//
+// Sweeps: comma-separated lists, every combination is simulated.
+//   ./battery_sim --interval 10,60,300 --batch 1,6 --fan 0,3
+//   ./battery_sim --mode periodic,single --co2-every 1,6 --serial-log 0,1 --profile tools/battery_profile.txt
+//   ./battery_sim -DSCD41_MODE=SCD41_MODE_SINGLE_SHOT --interval 30,60 --csv > sweep.csv
+// --fan 0 runs without the fan, N runs it for N seconds. --threads N (default: all cores),
+// --max-years Y (default 30) stops a simulation that outlives the battery's shelf life anyway.
+
+#include <atomic>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "firmware_defines.h"
+
+// ---- Profile: phase durations (ms) and currents (mA) ----
+
+struct Profile {
+  // Durations of the awake phases (ms), named after phase_profiler.h
+  double boot_ms = 40;            // Reset to setup(): ROM, bootloader, app startup
+  double sensor_attach_ms = 1;    // I2C bus and driver after a timer wake
+  double cold_init_ms = 20;       // Cold boot extra work besides the waits below (banner, wakeUp())
+  double serial_delay_ms = 1000;  // delay(1000) for Serial on cold boots, SERIAL_LOG builds only
+  double measure_start_ms = 2;    // Measurement command
+  double read_ms = 8;             // Data-ready poll and readMeasurement
+  double stop_periodic_ms = 500;  // stop_periodic_measurement (periodic mode, driver waits 500 ms)
+  double log_ms = 25;             // Serial printing per wake, SERIAL_LOG builds only
+  double radio_init_ms = 60;      // Wi-Fi + ESP-NOW start
+  double channel_ms = 1;          // Tuning to the cached gateway channel
+  double send_ms = 4;             // esp_now_send until the send callback (unicast, first try)
+  double cali_ms = 5;             // Two setAutomaticSelfCalibrationInitialPeriod calls
+  // Currents (mA), at the supply the board was measured at
+  double cpu_ma = 40;             // Awake, radio off (phase_profiler.h figures)
+  double radio_ma = 100;          // Radio on, receiving
+  double tx_ma = 120;             // Sending
+  double led_ma = 2;              // Onboard LED while awake (useOnboardLED)
+  double light_sleep_ma = 0.8;    // Light sleep (fan run, short measurement waits)
+  double deep_sleep_ma = 0.15;    // Deep sleep, whole board (regulator, USB bridge)
+  double fan_ma = 80;             // Fan while it runs
+  double scd41_idle_ma = 0.2;     // SCD41 idle between measurements
+  double scd41_measure_ma = 15;   // SCD41 while measuring (periodic measurement or a single shot)
+  // Battery
+  double battery_mah = 3500;      // Capacity
+  double battery_v = 3.7;         // Nominal battery voltage
+  double supply_v = 5;            // Voltage the currents above are drawn at
+  double converter_eff = 0.95;    // Battery -> supply converter efficiency
+  double usable_fraction = 0.85;  // Share of the capacity above the brown-out voltage
+  double self_discharge_pct = 3;  // Self-discharge per year (% of capacity)
+};
+
+static const struct { const char* key; double Profile::* field; } profileKeys[] = {
+  { "boot_ms", &Profile::boot_ms }, { "sensor_attach_ms", &Profile::sensor_attach_ms },
+  { "cold_init_ms", &Profile::cold_init_ms }, { "serial_delay_ms", &Profile::serial_delay_ms },
+  { "measure_start_ms", &Profile::measure_start_ms }, { "read_ms", &Profile::read_ms },
+  { "stop_periodic_ms", &Profile::stop_periodic_ms }, { "log_ms", &Profile::log_ms },
+  { "radio_init_ms", &Profile::radio_init_ms }, { "channel_ms", &Profile::channel_ms },
+  { "send_ms", &Profile::send_ms }, { "cali_ms", &Profile::cali_ms },
+  { "cpu_ma", &Profile::cpu_ma }, { "radio_ma", &Profile::radio_ma }, { "tx_ma", &Profile::tx_ma },
+  { "led_ma", &Profile::led_ma }, { "light_sleep_ma", &Profile::light_sleep_ma },
+  { "deep_sleep_ma", &Profile::deep_sleep_ma }, { "fan_ma", &Profile::fan_ma },
+  { "scd41_idle_ma", &Profile::scd41_idle_ma }, { "scd41_measure_ma", &Profile::scd41_measure_ma },
+  { "battery_mah", &Profile::battery_mah }, { "battery_v", &Profile::battery_v },
+  { "supply_v", &Profile::supply_v }, { "converter_eff", &Profile::converter_eff },
+  { "usable_fraction", &Profile::usable_fraction }, { "self_discharge_pct", &Profile::self_discharge_pct },
+};
+
+static bool readProfile(const char* path, Profile& prof) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[256];
+  int n = 0;
+  while (fgets(line, sizeof line, f)) {
+    n++;
+    char* comment = strchr(line, '#');
+    if (comment) *comment = 0;
+    char key[64];
+    double value;
+    if (sscanf(line, " %63[a-z0-9_] = %lf", key, &value) != 2) {
+      char rest[2];
+      if (sscanf(line, " %1s", rest) == 1) fprintf(stderr, "%s:%d: expected key = value\n", path, n);
+      continue;
+    }
+    bool found = false;
+    for (auto& k : profileKeys) {
+      if (strcmp(k.key, key) == 0) { prof.*k.field = value; found = true; }
+    }
+    if (!found) fprintf(stderr, "%s:%d: unknown key %s\n", path, n, key);
+  }
+  fclose(f);
+  return true;
+}
+
+// ---- Simulation ----
+
+// One point of the grid, with the firmware constants it implies
+struct Config {
+  int interval;       // MEASUREMENT_INTERVAL (s)
+  int batch;          // STATION_BATCH_READINGS
+  int fan;            // FAN_DURATION (s), 0 = useFan false
+  int singleShot;     // SCD41_MODE
+  int co2Every;       // SCD41_CO2_EVERY
+  int serialLog;      // SERIAL_LOG
+  bool led;           // useOnboardLED
+  long long caliPeriod;      // CALI_PERIOD (cycles)
+  long long periodicFirstMs, singleShotMs, rhtMs, powerUpMs, deepSleepMinMs;
+  long long diagIntervalS, scanMs;
+};
+
+struct Result {
+  double years;
+  bool capped;          // Still running at --max-years
+  double avgUa;         // Mean battery current
+  double awakeMsPerCycle;
+  double mahPerDay;
+  double radioShare;    // Share of the charge spent with the radio on
+};
+
+// Steps the station firmware wake by wake. Mirrors setup() in src/station/main.cpp: the fan runs in
+// light sleep, measurement waits of at least SCD41_DEEP_SLEEP_MIN_MS are a deep sleep and a second
+// wake, shorter ones a light sleep in the same wake; the radio starts on every batch-th reading;
+// once cali_counter reaches CALI_PERIOD the next wake calibrates and restarts the chip (cold boot).
+static Result simulate(const Config& c, const Profile& p, double maxYears) {
+  const double toBattery = p.supply_v / (p.converter_eff * p.battery_v);   // supply mA -> battery mA
+  const double usableMas = p.battery_mah * p.usable_fraction * 3600.0;     // mA*s
+  const double selfDischargeMa = p.battery_mah * p.self_discharge_pct / 100.0 / (365.25 * 24.0);
+  const double maxS = maxYears * 365.25 * 86400.0;
+  const double led = c.led ? p.led_ma : 0;   // On while awake and through the fan run
+  const double log = c.serialLog ? p.log_ms : 0;
+
+  double t = 0;        // s
+  double q = 0;        // Board charge at the supply, mA*s
+  double radioQ = 0;
+  double sensorQ = 0;  // SCD41 charge above idle, mA*s
+  double awakeMs = 0;
+  long long cycles = 0;
+  uint32_t seq = 0;
+  long long caliCounter = 1;
+  bool cold = true, scanned = false;
+  double lastDiag = 0;
+
+  auto spend = [&](double ms, double ma) { t += ms / 1000.0; q += ms * ma / 1000.0; };
+  auto awake = [&](double ms, double ma) { spend(ms, ma + led); awakeMs += ms; };
+  auto battery = [&]() { return (q + sensorQ + p.scd41_idle_ma * t) * toBattery + selfDischargeMa * t; };
+
+  while (battery() < usableMas && t < maxS) {
+    // STATE_START_MEASURE wake (or the cold boot after power-on / calibration)
+    awake(p.boot_ms + log, p.cpu_ma);
+    if (cold) {
+      awake(p.cold_init_ms + c.powerUpMs + (c.serialLog ? p.serial_delay_ms : 0), p.cpu_ma);
+      cold = false;
+    } else {
+      awake(p.sensor_attach_ms, p.cpu_ma);
+    }
+    if (c.fan) spend(c.fan * 1000.0, p.light_sleep_ma + p.fan_ma + led);
+    awake(p.measure_start_ms, p.cpu_ma);
+
+    bool co2 = !c.singleShot || seq % c.co2Every == 0;
+    double shortMs = !c.singleShot ? c.periodicFirstMs : co2 ? c.singleShotMs : c.rhtMs;
+    double readMs = p.read_ms + (c.singleShot ? 0 : p.stop_periodic_ms);
+    // The sensor measures through the wait (and, periodic, until the stop command)
+    sensorQ += (shortMs + (c.singleShot ? 0 : readMs)) * (p.scd41_measure_ma - p.scd41_idle_ma) / 1000.0;
+    if (shortMs >= c.deepSleepMinMs) {
+      spend(shortMs, p.deep_sleep_ma);
+      awake(p.boot_ms + log + p.sensor_attach_ms, p.cpu_ma);   // STATE_READ_VALUE wake
+    } else {
+      spend(shortMs, p.light_sleep_ma);
+    }
+    awake(readMs, p.cpu_ma);
+    seq++;
+
+    // Radio: every batch-th reading, plus a diagnostics frame every DIAG_INTERVAL_S
+    if (seq % c.batch == 0) {
+      double q0 = q;
+      awake(p.radio_init_ms, p.radio_ma);
+      if (!scanned) {
+        awake(c.scanMs, p.radio_ma);   // First send after power-on scans for the gateway
+        scanned = true;
+      }
+      awake(p.channel_ms, p.radio_ma);
+      awake(p.send_ms, p.tx_ma);
+      if (t - lastDiag >= c.diagIntervalS) {
+        awake(p.send_ms, p.tx_ma);
+        lastDiag = t;
+      }
+      radioQ += q - q0;
+    }
+
+    // Long sleep fills the rest of the interval (the awake time is not subtracted)
+    double busy = shortMs + c.fan * 1000.0;
+    double longMs = c.interval * 1000.0 > busy ? c.interval * 1000.0 - busy : 100;
+    spend(longMs, p.deep_sleep_ma);
+    caliCounter++;
+    cycles++;
+
+    // STATE_CALI_ROUTINE: checkCalibration() sends the next wake here; esp_restart() afterwards
+    if (caliCounter >= c.caliPeriod) {
+      awake(p.boot_ms + log + p.sensor_attach_ms + p.cali_ms, p.cpu_ma);
+      caliCounter = 1;
+      cold = true;
+    }
+  }
+
+  Result r;
+  r.capped = battery() < usableMas;
+  r.years = t / (365.25 * 86400.0);
+  double boardMa = battery() / t;
+  r.avgUa = boardMa * 1000.0;
+  r.mahPerDay = boardMa * 24.0;
+  r.awakeMsPerCycle = cycles ? awakeMs / cycles : 0;
+  r.radioShare = q + sensorQ > 0 ? radioQ / (q + sensorQ + p.scd41_idle_ma * t) : 0;
+  return r;
+}
+
+// ---- Command line ----
+
+static std::vector<int> parseList(const char* arg, const char* what) {
+  std::vector<int> out;
+  std::string s(arg);
+  size_t pos = 0;
+  while (pos <= s.size()) {
+    size_t comma = s.find(',', pos);
+    std::string item = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+    if (item == "periodic") out.push_back(0);
+    else if (item == "single") out.push_back(1);
+    else {
+      char* end;
+      long v = strtol(item.c_str(), &end, 10);
+      if (item.empty() || *end || v < 0) {
+        fprintf(stderr, "bad %s value '%s'\n", what, item.c_str());
+        exit(1);
+      }
+      out.push_back((int)v);
+    }
+    if (comma == std::string::npos) break;
+    pos = comma + 1;
+  }
+  return out;
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+    "usage: %s [--interval S,..] [--batch N,..] [--fan S,..] [--mode periodic,single]\n"
+    "          [--co2-every N,..] [--serial-log 0,1] [--profile FILE] [-DNAME=VALUE]\n"
+    "          [--config DIR] [--threads N] [--max-years Y] [--csv]\n", name);
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  const char* includeDir = "include";
+  const char* profilePath = nullptr;
+  const char* lists[6] = {};   // interval, batch, fan, mode, co2-every, serial-log
+  const char* listNames[6] = { "--interval", "--batch", "--fan", "--mode", "--co2-every", "--serial-log" };
+  int threads = (int)std::thread::hardware_concurrency();
+  double maxYears = 30;
+  bool csv = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    bool matched = false;
+    for (int l = 0; l < 6; ++l) {
+      if (strcmp(a, listNames[l]) == 0 && i + 1 < argc) { lists[l] = argv[++i]; matched = true; }
+    }
+    if (matched) continue;
+    if (parseDefineArg(a)) continue;
+    if (strcmp(a, "--profile") == 0 && i + 1 < argc) profilePath = argv[++i];
+    else if (strcmp(a, "--config") == 0 && i + 1 < argc) includeDir = argv[++i];
+    else if (strcmp(a, "--threads") == 0 && i + 1 < argc) threads = atoi(argv[++i]);
+    else if (strcmp(a, "--max-years") == 0 && i + 1 < argc) maxYears = atof(argv[++i]);
+    else if (strcmp(a, "--csv") == 0) csv = true;
+    else usage(argv[0]);
+  }
+  if (threads < 1) threads = 1;
+
+  if (!readFirmwareDefines(includeDir)) return 1;
+
+  Profile prof;
+  if (profilePath && !readProfile(profilePath, prof)) {
+    fprintf(stderr, "cannot read profile %s\n", profilePath);
+    return 1;
+  }
+
+  // Axes default to the single value the firmware is configured with
+  std::vector<int> axes[6];
+  axes[0] = lists[0] ? parseList(lists[0], "interval") : std::vector<int>{ (int)defineValue("MEASUREMENT_INTERVAL") };
+  axes[1] = lists[1] ? parseList(lists[1], "batch") : std::vector<int>{ (int)defineValue("STATION_BATCH_READINGS") };
+  axes[2] = lists[2] ? parseList(lists[2], "fan")
+                     : std::vector<int>{ defineValue("useFan") ? (int)defineValue("FAN_DURATION") : 0 };
+  axes[3] = lists[3] ? parseList(lists[3], "mode")
+                     : std::vector<int>{ defineValue("SCD41_MODE") == defineValue("SCD41_MODE_SINGLE_SHOT") };
+  axes[4] = lists[4] ? parseList(lists[4], "co2-every") : std::vector<int>{ (int)defineValue("SCD41_CO2_EVERY") };
+  axes[5] = lists[5] ? parseList(lists[5], "serial-log") : std::vector<int>{ (int)defineValue("SERIAL_LOG") };
+
+  const long long multiMax = defineValue("MULTI_MAX_READINGS");
+  std::vector<Config> grid;
+  for (int interval : axes[0])
+  for (int batch : axes[1])
+  for (int fan : axes[2])
+  for (int mode : axes[3])
+  for (int co2Every : axes[4])
+  for (int serialLog : axes[5]) {
+    if (interval < 1 || batch < 1 || batch > multiMax || co2Every < 1) {
+      fprintf(stderr, "skipping interval %d, batch %d, co2 every %d: out of range\n", interval, batch, co2Every);
+      continue;
+    }
+    // Periodic mode measures CO2 every cycle, SCD41_CO2_EVERY does not apply: one row is enough
+    if (!mode && co2Every != axes[4][0]) continue;
+    Config c;
+    c.interval = interval;
+    c.batch = batch;
+    c.fan = fan;
+    c.singleShot = mode;
+    c.co2Every = mode ? co2Every : 1;
+    c.serialLog = serialLog;
+    c.led = defineValue("useOnboardLED") != 0;
+    std::map<std::string, std::string> vars = { { "MEASUREMENT_INTERVAL", std::to_string(interval) } };
+    c.caliPeriod = defineValue("CALI_PERIOD", vars);
+    c.periodicFirstMs = defineValue("SCD41_PERIODIC_FIRST_MS");
+    c.singleShotMs = defineValue("SCD41_SINGLE_SHOT_MS");
+    c.rhtMs = defineValue("SCD41_SINGLE_SHOT_RHT_MS");
+    c.powerUpMs = defineValue("SCD41_POWER_UP_MS");
+    c.deepSleepMinMs = defineValue("SCD41_DEEP_SLEEP_MIN_MS");
+    c.diagIntervalS = defineValue("DIAG_INTERVAL_S");
+    // Cold boot scan: on average the gateway is found halfway through the channels
+    c.scanMs = defineValue("ESPNOW_SCAN_DWELL_MS") * defineValue("ESPNOW_SCAN_CHANNELS") / 2;
+    grid.push_back(c);
+  }
+  if (grid.empty()) usage(argv[0]);
+
+  // Every grid point is independent: workers take the next one until none are left
+  std::vector<Result> results(grid.size());
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (int w = 0; w < threads && w < (int)grid.size(); ++w) {
+    workers.emplace_back([&]() {
+      for (size_t i; (i = next++) < grid.size();) results[i] = simulate(grid[i], prof, maxYears);
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  if (csv) {
+    printf("interval_s,batch,fan_s,sensor,co2_every,serial_log,cali_period,avg_ua,awake_ms_per_cycle,mah_per_day,radio_share,years\n");
+  } else {
+    printf("battery: %.0f mAh (%.0f%% usable), %d configurations on %d threads\n",
+           prof.battery_mah, prof.usable_fraction * 100, (int)grid.size(), threads);
+    printf("%8s %5s %4s %-8s %4s %4s %6s %9s %10s %8s %6s %7s\n", "interval", "batch", "fan", "sensor",
+           "co2/", "log", "cali", "avg uA", "awake ms", "mAh/day", "radio", "years");
+  }
+  for (size_t i = 0; i < grid.size(); ++i) {
+    const Config& c = grid[i];
+    const Result& r = results[i];
+    if (csv) {
+      printf("%d,%d,%d,%s,%d,%d,%lld,%.1f,%.1f,%.3f,%.3f,%.3f%s\n", c.interval, c.batch, c.fan,
+             c.singleShot ? "single" : "periodic", c.co2Every, c.serialLog, c.caliPeriod, r.avgUa,
+             r.awakeMsPerCycle, r.mahPerDay, r.radioShare, r.years, r.capped ? "+" : "");
+    } else {
+      printf("%7ds %5d %3ds %-8s %4d %4s %6lld %9.1f %10.1f %8.2f %5.0f%% %6.2f%s\n", c.interval, c.batch,
+             c.fan, c.singleShot ? "single" : "periodic", c.co2Every, c.serialLog ? "on" : "off",
+             c.caliPeriod, r.avgUa, r.awakeMsPerCycle, r.mahPerDay, r.radioShare * 100, r.years,
+             r.capped ? "+" : "");
+    }
+  }
+  if (!csv) printf("(+ = still running at --max-years; awake ms per measurement cycle; co2/ = CO2 every Nth reading)\n");
+  return 0;
+}
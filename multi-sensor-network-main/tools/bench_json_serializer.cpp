@@ -0,0 +1,173 @@
+// Host microbenchmark: gateway JSON serialization, String concatenation vs JsonWriter.
+//
+// Build and run (from the project root):
+//   g++ -O2 -std=c++17 -Iinclude tools/bench_json_serializer.cpp -o bench_json && ./bench_json
+//
+// "String" replays what sendToServer() did per reading before JsonWriter: the payload built
+// with String += and String(float, 2). BenchString below copies the allocation behaviour of the
+// ESP32 Arduino WString (11-byte small-string buffer, exact-size realloc on every growth, dtostrf
+// for floats), so the allocation counts match what the gateway heap saw.
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_writer.h"
+
+static unsigned long g_allocs = 0;   // malloc + realloc calls made by BenchString
+
+class BenchString {
+public:
+  BenchString() { sso[0] = '\0'; }
+  BenchString(const char* s) { sso[0] = '\0'; concat(s, strlen(s)); }
+  BenchString(float v, unsigned char decimals) {
+    sso[0] = '\0';
+    char tmp[33];
+    dtostrf(v, decimals + 2, decimals, tmp);
+    concat(tmp, strlen(tmp));
+  }
+  explicit BenchString(unsigned v) {
+    sso[0] = '\0';
+    char tmp[11];
+    snprintf(tmp, sizeof(tmp), "%u", v);   // WString uses utoa
+    concat(tmp, strlen(tmp));
+  }
+  ~BenchString() { if (heap) free(heap); }
+
+  BenchString& operator+=(const char* s) { concat(s, strlen(s)); return *this; }
+  BenchString& operator+=(const BenchString& s) { concat(s.c_str(), s.len); return *this; }
+  const char* c_str() const { return heap ? heap : sso; }
+  size_t length() const { return len; }
+
+private:
+  // ESP32 core dtostrf (stdlib_noniso.c): add half of the last digit, then emit digits by truncation
+  static void dtostrf(double number, int width, unsigned prec, char* out) {
+    int fillme = width;
+    if (prec > 0) fillme -= (prec + 1);
+    bool negative = number < 0.0;
+    if (negative) { fillme--; number = -number; }
+    double rounding = 2.0;
+    for (unsigned i = 0; i < prec; ++i) rounding *= 10.0;
+    number += 1.0 / rounding;
+    double tenpow = 1.0;
+    int digitcount = 1;
+    while (number >= 10.0 * tenpow) { tenpow *= 10.0; digitcount++; }
+    number /= tenpow;
+    fillme -= digitcount;
+    while (fillme-- > 0) *out++ = ' ';
+    if (negative) *out++ = '-';
+    digitcount += prec;
+    while (digitcount-- > 0) {
+      int digit = (int)number;
+      if (digit > 9) digit = 9;
+      *out++ = (char)('0' | digit);
+      if (digitcount == (int)prec && prec > 0) *out++ = '.';
+      number -= digit;
+      number *= 10.0;
+    }
+    *out = '\0';
+  }
+
+  void concat(const char* s, size_t n) {
+    size_t need = len + n;
+    if (need > cap) {
+      // WString::changeBuffer: realloc to exactly the requested size
+      char* p = (char*)realloc(heap, need + 1);
+      g_allocs++;
+      if (!heap) memcpy(p, sso, len + 1);
+      heap = p;
+      cap = need;
+    }
+    memcpy((heap ? heap : sso) + len, s, n);
+    len = need;
+    (heap ? heap : sso)[len] = '\0';
+  }
+
+  char sso[12];
+  char* heap = nullptr;
+  size_t cap = 11;
+  size_t len = 0;
+};
+
+struct Reading {
+  uint8_t mac[6];
+  float temperature;
+  float humidity;
+  uint16_t co2;
+};
+
+// The payload code sendToServer() used before JsonWriter
+static size_t serializeString(const Reading& r, char* sink) {
+  char macStr[18];
+  snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
+           r.mac[0], r.mac[1], r.mac[2], r.mac[3], r.mac[4], r.mac[5]);
+  BenchString payload = "{";
+  payload += "\"mac\":\""; payload += macStr; payload += "\",";
+  payload += "\"device_id\":\""; payload += macStr; payload += "\",";
+  payload += "\"temperature\":"; payload += BenchString(r.temperature, 2); payload += ",";
+  payload += "\"humidity\":"; payload += BenchString(r.humidity, 2); payload += ",";
+  payload += "\"co2\":"; payload += BenchString((unsigned)r.co2);
+  payload += "}";
+  memcpy(sink, payload.c_str(), payload.length() + 1);
+  return payload.length();
+}
+
+static size_t serializeWriter(const Reading& r, char* sink) {
+  static char buf[160];
+  JsonWriter w(buf, sizeof(buf));
+  writeReadingJson(w, r.mac, r.temperature, r.humidity, r.co2);
+  memcpy(sink, buf, w.length() + 1);
+  return w.length();
+}
+
+template <typename F>
+static double nsPerRecord(F fn, const Reading* readings, int count, int rounds, size_t& bytes) {
+  char sink[160];
+  bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; ++r) {
+    for (int i = 0; i < count; ++i) bytes += fn(readings[i], sink);
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() / ((double)count * rounds);
+}
+
+int main(int argc, char** argv) {
+  const int count = 1024;
+  const int rounds = argc > 1 ? atoi(argv[1]) : 200;
+  static Reading readings[count];
+  srand(1);
+  for (int i = 0; i < count; ++i) {
+    for (int j = 0; j < 6; ++j) readings[i].mac[j] = rand() & 0xFF;
+    readings[i].temperature = -10.0f + (rand() % 5000) / 100.0f + (rand() % 1000) / 100000.0f;
+    readings[i].humidity = (rand() % 10000) / 100.0f + (rand() % 1000) / 100000.0f;
+    readings[i].co2 = 400 + rand() % 4600;
+  }
+
+  // Both paths must produce the same bytes
+  int mismatches = 0;
+  for (int i = 0; i < count; ++i) {
+    char a[160], b[160];
+    serializeString(readings[i], a);
+    serializeWriter(readings[i], b);
+    if (strcmp(a, b) != 0) {
+      if (mismatches++ < 3) printf("MISMATCH\n  String:     %s\n  JsonWriter: %s\n", a, b);
+    }
+  }
+
+  size_t bytesString, bytesWriter;
+  g_allocs = 0;
+  double nsString = nsPerRecord(serializeString, readings, count, rounds, bytesString);
+  double allocsString = (double)g_allocs / ((double)count * rounds);
+  g_allocs = 0;
+  double nsWriter = nsPerRecord(serializeWriter, readings, count, rounds, bytesWriter);
+  double allocsWriter = (double)g_allocs / ((double)count * rounds);
+
+  printf("records: %d x %d rounds, output mismatches: %d\n", count, rounds, mismatches);
+  printf("%-12s %10s %14s %12s\n", "serializer", "ns/record", "allocs/record", "bytes/record");
+  printf("%-12s %10.1f %14.2f %12.1f\n", "String", nsString, allocsString, (double)bytesString / ((double)count * rounds));
+  printf("%-12s %10.1f %14.2f %12.1f\n", "JsonWriter", nsWriter, allocsWriter, (double)bytesWriter / ((double)count * rounds));
+  printf("speedup: %.1fx\n", nsString / nsWriter);
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+// Host microbenchmark: station lookup by MAC, linear scan vs StationRegistry, by station count.
+//
+// Build and run (from the project root):
+//   g++ -O2 -std=c++17 -Iinclude tools/bench_station_lookup.cpp -o bench_lookup && ./bench_lookup
+//
+// "linear" is the gateway's old findStation(): heap-allocated Station objects behind a pointer
+// array, memcmp over all registered stations. Hits are ESP-NOW packets from registered
+// stations; misses are management frames from other devices seen by promiscuous_rx_cb, which
+// are the common case and the worst case for the linear scan (it always walks the whole array).
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "station_registry.h"
+
+#define MAX_N 1024
+
+// Same members as the gateway Station class
+struct Station {
+  uint8_t mac[6];
+  int rssi;
+  struct { float temperature; uint16_t co2; float humidity; } readings;
+  Station() : rssi(0) { memset(mac, 0, 6); }
+  Station(const uint8_t* m) : rssi(0) { memcpy(mac, m, 6); }
+};
+
+static Station* linearStations[MAX_N];
+static int linearCount = 0;
+
+static Station* linearFind(const uint8_t* mac) {
+  for (int i = 0; i < linearCount; ++i) {
+    if (memcmp(linearStations[i]->mac, mac, 6) == 0) return linearStations[i];
+  }
+  return NULL;
+}
+
+static StationRegistry<Station, MAX_N> registry;
+
+// Station MACs share the vendor prefix (same board model), like a real deployment
+static void stationMac(int i, uint8_t mac[6]) {
+  uint32_t r = (uint32_t)i * 2654435761u;
+  uint8_t m[6] = {0x24, 0x6F, 0x28, (uint8_t)(r >> 16), (uint8_t)(r >> 8), (uint8_t)i};
+  memcpy(mac, m, 6);
+}
+
+static volatile int sink;
+
+template <typename Find>
+static double nsPerLookup(Find find, uint8_t (*macs)[6], int count, int rounds) {
+  auto t0 = std::chrono::steady_clock::now();
+  int found = 0;
+  for (int r = 0; r < rounds; ++r) {
+    for (int i = 0; i < count; ++i) {
+      if (find(macs[i])) found++;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  sink = found;
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)count * rounds);
+}
+
+int main(int argc, char** argv) {
+  const int lookups = 4096;
+  const int rounds = argc > 1 ? atoi(argv[1]) : 200;
+  static uint8_t hits[lookups][6], misses[lookups][6];
+  srand(1);
+  for (int i = 0; i < lookups; ++i) {
+    for (int j = 0; j < 6; ++j) misses[i][j] = rand() & 0xFF;
+  }
+
+  printf("%8s  %14s %14s  %14s %14s\n", "stations", "linear hit", "hash hit", "linear miss", "hash miss");
+  const int counts[] = {10, 50, 100, 250, 500, 1000};
+  for (int n : counts) {
+    // Register stations 0..n-1 in both tables
+    while (linearCount < n) {
+      uint8_t mac[6];
+      stationMac(linearCount, mac);
+      linearStations[linearCount++] = new Station(mac);
+      registry.findOrInsert(mac);
+    }
+    for (int i = 0; i < lookups; ++i) stationMac(rand() % n, hits[i]);
+
+    // Both tables must agree
+    for (int i = 0; i < lookups; ++i) {
+      if (!registry.find(hits[i]) || registry.find(misses[i]) != NULL || !linearFind(hits[i])) {
+        printf("MISMATCH at %d stations\n", n);
+        return 1;
+      }
+    }
+
+    double linHit = nsPerLookup(linearFind, hits, lookups, rounds);
+    double hashHit = nsPerLookup([](const uint8_t* m) { return registry.find(m); }, hits, lookups, rounds);
+    double linMiss = nsPerLookup(linearFind, misses, lookups, rounds);
+    double hashMiss = nsPerLookup([](const uint8_t* m) { return registry.find(m); }, misses, lookups, rounds);
+    printf("%8d  %11.1f ns %11.1f ns  %11.1f ns %11.1f ns\n", n, linHit, hashHit, linMiss, hashMiss);
+  }
+  return 0;
+}
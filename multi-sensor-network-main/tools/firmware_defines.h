@@ -0,0 +1,163 @@
+#pragma once
+#include <ctype.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Firmware constants for the host simulators (battery_sim, radio_sim): the #defines of
+// include/config.h and friends, read as text, so the tools follow the firmware without building it
+// (config.h needs Arduino.h and defines globals). -DNAME=VALUE on a tool's command line goes into
+// `overrides`, the way build_flags in platformio.ini override the #ifndef defaults.
+
+// Object-like #define lines of a header, first definition wins (conditional blocks are not
+// evaluated; the station timing defines are all unconditional). Also picks up "bool name = x;".
+static std::map<std::string, std::string> defines;
+static std::map<std::string, std::string> overrides;   // -D on the command line
+
+static bool readDefines(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[512];
+  while (fgets(line, sizeof line, f)) {
+    char* comment = strstr(line, "//");
+    if (comment) *comment = 0;
+    char name[64], value[256];
+    if (sscanf(line, " #define %63[A-Za-z0-9_] %255[^\n]", name, value) == 2 ||
+        sscanf(line, " bool %63[A-Za-z0-9_] = %255[^;]", name, value) == 2) {
+      if (strchr(name, '(')) continue;
+      defines.emplace(name, value);
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Integer expression over numbers, defines, + - * / and parentheses (what config.h uses for the
+// station timings). Integer arithmetic, like the preprocessor: 3600/MEASUREMENT_INTERVAL truncates.
+class Expr {
+public:
+  Expr(const std::map<std::string, std::string>& vars, const char* text, int depth)
+    : vars(vars), p(text), depth(depth), ok(true) {}
+
+  long long parse() {
+    long long v = sum();
+    skip();
+    if (*p) ok = false;
+    return v;
+  }
+
+  const std::map<std::string, std::string>& vars;
+  const char* p;
+  int depth;
+  bool ok;
+
+private:
+  void skip() { while (isspace((unsigned char)*p)) p++; }
+
+  long long sum() {
+    long long v = product();
+    for (;;) {
+      skip();
+      if (*p == '+') { p++; v += product(); }
+      else if (*p == '-') { p++; v -= product(); }
+      else return v;
+    }
+  }
+
+  long long product() {
+    long long v = unary();
+    for (;;) {
+      skip();
+      if (*p == '*') { p++; v *= unary(); }
+      else if (*p == '/') {
+        p++;
+        long long d = unary();
+        if (d == 0) { ok = false; return 0; }
+        v /= d;
+      }
+      else return v;
+    }
+  }
+
+  long long unary() {
+    skip();
+    if (*p == '-') { p++; return -unary(); }
+    if (*p == '(') {
+      p++;
+      long long v = sum();
+      skip();
+      if (*p == ')') p++; else ok = false;
+      return v;
+    }
+    if (isdigit((unsigned char)*p)) {
+      char* end;
+      long long v = strtoll(p, &end, 0);
+      p = end;
+      while (*p == 'U' || *p == 'u' || *p == 'L' || *p == 'l') p++;
+      return v;
+    }
+    if (isalpha((unsigned char)*p) || *p == '_') {
+      std::string name;
+      while (isalnum((unsigned char)*p) || *p == '_') name += *p++;
+      if (name == "true") return 1;
+      if (name == "false") return 0;
+      auto it = vars.find(name);
+      if (it == vars.end() || depth > 16) { ok = false; return 0; }
+      Expr inner(vars, it->second.c_str(), depth + 1);
+      long long v = inner.parse();
+      if (!inner.ok) ok = false;
+      return v;
+    }
+    ok = false;
+    return 0;
+  }
+};
+
+// Value of a define with the command-line overrides and the sweep's own values applied
+static long long defineValue(const char* name, const std::map<std::string, std::string>& extra) {
+  std::map<std::string, std::string> vars = defines;
+  for (auto& o : overrides) vars[o.first] = o.second;
+  for (auto& o : extra) vars[o.first] = o.second;
+  auto it = vars.find(name);
+  if (it == vars.end()) {
+    fprintf(stderr, "%s is not defined in the firmware headers\n", name);
+    exit(1);
+  }
+  Expr e(vars, it->second.c_str(), 0);
+  long long v = e.parse();
+  if (!e.ok) {
+    fprintf(stderr, "cannot evaluate %s = %s\n", name, it->second.c_str());
+    exit(1);
+  }
+  return v;
+}
+
+static long long defineValue(const char* name) {
+  return defineValue(name, std::map<std::string, std::string>());
+}
+
+// config.h, SDA41_sensor.h and espnow_proto.h from dir
+static bool readFirmwareDefines(const char* dir) {
+  static const char* const files[] = { "config.h", "SDA41_sensor.h", "espnow_proto.h" };
+  for (const char* f : files) {
+    std::string path = std::string(dir) + "/" + f;
+    if (!readDefines(path.c_str())) {
+      fprintf(stderr, "cannot read %s (run from the project root or pass --config)\n", path.c_str());
+      return false;
+    }
+  }
+  if (!defines.count("SERIAL_LOG")) defines["SERIAL_LOG"] = "1";   // serial_log.h default
+  return true;
+}
+
+// -DNAME or -DNAME=VALUE
+static bool parseDefineArg(const char* arg) {
+  if (strncmp(arg, "-D", 2) != 0 || !arg[2]) return false;
+  std::string d(arg + 2);
+  size_t eq = d.find('=');
+  overrides[d.substr(0, eq)] = eq == std::string::npos ? "1" : d.substr(eq + 1);
+  return true;
+}
@@ -0,0 +1,133 @@
+// Host decoder for binary log output (-DLOG_BINARY=1, see include/serial_log.h): picks the log
+// frames out of a raw serial capture and prints them as text, with the board's timestamp and the
+// level in front. Everything between frames (boot ROM output, panics, direct LOG_PRINT* output)
+// is passed through as it is.
+//
+// Build and run (from the project root):
+//   g++ -O2 -std=c++17 -Iinclude tools/log_decode.cpp -o log_decode
+//   stty -F /dev/ttyUSB0 115200 raw && ./log_decode < /dev/ttyUSB0     (live)
+//   ./log_decode capture.bin                                            (a saved capture)
+//
+// The board sends each format string once ('F' frame) before the first line that uses it, and
+// again every LOG_FMT_RESEND_MS, so no ELF file is needed; lines whose format was not seen yet
+// (capture started late) are printed as their raw arguments until it comes around again.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "log_record.h"
+
+std::string formats[65536];
+bool known[65536];
+uint32_t lastT = 0;
+uint64_t wraps = 0;       // micros() wraps every ~71.6 minutes
+uint32_t lastDrops = 0;
+unsigned badFrames = 0;
+
+void printRawArgs(const uint8_t* args, size_t len) {
+  LogArgReader rd(args, len);
+  LogArg a;
+  while (rd.next(a)) {
+    if (a.kind == LOG_ARG_STR) printf(" \"%.*s\"", a.size, a.s);
+    else if (a.kind == LOG_ARG_FLOAT) printf(" %g", a.d);
+    else if (a.kind == LOG_ARG_INT) printf(" %lld", (long long)a.u);
+    else printf(" %llu", (unsigned long long)a.u);
+  }
+  printf("\n");
+}
+
+void handleFrame(uint8_t type, const uint8_t* p, uint8_t len) {
+  if (type == LOG_FRAME_FORMAT && len >= 2) {
+    uint16_t id;
+    memcpy(&id, p, 2);
+    formats[id].assign((const char*)p + 2, len - 2);
+    known[id] = true;
+  } else if (type == LOG_FRAME_RECORD && len >= 7) {
+    uint16_t id;
+    uint32_t t;
+    memcpy(&id, p, 2);
+    memcpy(&t, p + 2, 4);
+    if (t < lastT && lastT - t > 0x80000000u) wraps++;
+    lastT = t;
+    double s = ((wraps << 32) + t) / 1e6;
+    if (!known[id]) {
+      printf("[%10.3f] %c (format %u not received yet)", s, logLevelChar(p[6]), id);
+      printRawArgs(p + 7, len - 7);
+      return;
+    }
+    char line[1024];
+    size_t n = logFormatArgs(line, sizeof(line), formats[id].c_str(), p + 7, len - 7);
+    size_t blank = 0;   // Leading empty lines go before the timestamp
+    while (blank < n && line[blank] == '\n') blank++;
+    printf("%.*s[%10.3f] %c ", (int)blank, line, s, logLevelChar(p[6]));
+    fwrite(line + blank, 1, n - blank, stdout);
+    if (n == blank || line[n - 1] != '\n') printf("\n");
+  } else if (type == LOG_FRAME_DROPS && len == 4) {
+    uint32_t drops;
+    memcpy(&drops, p, 4);
+    printf("[log] %u lines dropped, log ring full\n", drops - lastDrops);
+    lastDrops = drops;
+  }
+}
+
+// Decode what is in buf; returns how many bytes were used (the rest may be an incomplete frame)
+size_t decode(const uint8_t* buf, size_t len, bool eof) {
+  size_t i = 0, text = 0;
+  while (i < len) {
+    if (buf[i] != LOG_FRAME_SYNC) {
+      i++;
+      continue;
+    }
+    if (i + 3 > len || i + 4 + buf[i + 2] > len) {
+      if (!eof) break;   // Wait for the rest of the frame
+      i++;
+      continue;
+    }
+    uint8_t type = buf[i + 1], plen = buf[i + 2];
+    bool typeOk = type == LOG_FRAME_FORMAT || type == LOG_FRAME_RECORD || type == LOG_FRAME_DROPS;
+    if (!typeOk || logCrc8(buf + i + 1, 2 + (size_t)plen) != buf[i + 3 + plen]) {
+      if (typeOk) badFrames++;
+      i++;   // Not a frame (or a damaged one): the byte is text
+      continue;
+    }
+    fwrite(buf + text, 1, i - text, stdout);
+    handleFrame(type, buf + i + 3, plen);
+    i += 4 + plen;
+    text = i;
+  }
+  fwrite(buf + text, 1, i - text, stdout);
+  return i;
+}
+
+int main(int argc, char** argv) {
+  int fd = 0;
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1])) {
+    fprintf(stderr, "usage: %s [capture file]   (reads stdin without one)\n", argv[0]);
+    return 1;
+  }
+  if (argc == 2 && strcmp(argv[1], "-") != 0) {
+    fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  std::vector<uint8_t> buf;
+  uint8_t chunk[4096];
+  for (;;) {
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    bool eof = n <= 0;
+    if (!eof) buf.insert(buf.end(), chunk, chunk + n);
+    size_t used = decode(buf.data(), buf.size(), eof);
+    buf.erase(buf.begin(), buf.begin() + used);
+    fflush(stdout);
+    if (eof) break;
+  }
+  if (badFrames) fprintf(stderr, "%u damaged frames skipped\n", badFrames);
+  return 0;
+}
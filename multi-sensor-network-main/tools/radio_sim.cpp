@@ -0,0 +1,517 @@
+// Host discrete-event simulator of a station fleet on one ESP-NOW channel: how many stations one
+// gateway handles before frames collide or the gateway falls behind.
+//
+// Build and run (from the project root):
+//   g++ -O2 -std=c++17 -pthread -Iinclude tools/radio_sim.cpp -o radio_sim && ./radio_sim
+//
+// Every station runs the src/station/main.cpp cycle: wake, measure (SCD41 wait), read, start the
+// radio, send, deep sleep for the rest of MEASUREMENT_INTERVAL. Sleep times run on the station's
+// own RTC clock (--drift-ppm, a fixed error per station), and the awake part varies by --jitter-ms.
+// The long sleep does not subtract the awake time, so stations powered on together stay in step
+// until drift and retries pull them apart; --spread-s powers them on over a window instead.
+//
+// Radio: 802.11b DSSS at the ESP-NOW default 1 Mbps (long preamble), carrier sense with DCF
+// backoff, MAC ACK after SIFS, --mac-retries retransmissions with doubling contention window, then
+// the firmware's own retries (ESPNOW_SEND_ATTEMPTS, ESPNOW_RETRY_BASE_MS doubling up to
+// ESPNOW_RETRY_MAX_MS, plus jitter). Two frames overlapping at the gateway are both lost (no
+// capture). A station hears a transmission one slot after it started; --hidden is the chance that
+// two stations cannot hear each other at all. The gateway's beacons (GATEWAY_BEACON_INTERVAL_MS)
+// share the channel.
+//
+// Gateway: OnDataRecv runs in the Wi-Fi task, one frame at a time, for --proc-us per frame. Frames
+// arriving meanwhile wait in the driver's receive buffers (--rx-queue); beyond that they are
+// dropped after the MAC ACK, so the station counts them as delivered. The default --proc-us, 10 us,
+// is the measured OnDataRecv time per frame: recv_us p50 of the native bench (pio run -e
+// native-bench, 7-9 us at 100 frames/s; p99 35-85 us). That is on the host; measure on the board
+// and pass it for a closer figure. The old default of 37 ms dates from before deferred logging
+// (serial_log.h), when OnDataRecv printed ~430 bytes per frame at 115200 baud itself.
+//
+// Sweeps: --stations is a comma-separated list, one simulation per entry, in parallel.
+//   ./radio_sim --stations 10,100,200,500,1000 --days 7
+//   ./radio_sim --stations 1000 --proc-us 300 --batch 6 --json
+// Other options: --interval S, --batch N (readings per frame, STATION_BATCH_READINGS), --seed N,
+// --threads N, -DNAME=VALUE (overrides a firmware define), --config DIR.
+//
+// Latency is from the end of the sensor read to the end of OnDataRecv at the gateway, for the
+// newest reading in the frame.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <queue>
+#include <random>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "firmware_defines.h"
+#include "espnow_proto.h"
+
+// 802.11b timing (us)
+#define PHY_PREAMBLE_US 192     // Long preamble + PLCP header
+#define PHY_US_PER_BYTE 8       // 1 Mbps
+#define SLOT_US 20
+#define SIFS_US 10
+#define DIFS_US (SIFS_US + 2 * SLOT_US)
+#define CW_MIN 31
+#define CW_MAX 1023
+#define MAC_ACK_BYTES 14
+// ESP-NOW frame around the payload: MAC header 24, category 1, OUI 3, random 4, vendor element
+// header 7, FCS 4
+#define ESPNOW_OVERHEAD_BYTES 43
+
+static int64_t airtimeUs(size_t bytes) {
+  return PHY_PREAMBLE_US + (int64_t)bytes * PHY_US_PER_BYTE;
+}
+
+// ---- Parameters ----
+
+struct Params {
+  int stations;
+  int batch;
+  int64_t intervalUs;
+  int64_t measureUs;       // SCD41 wait between the measure and the read wake (deep sleep)
+  int64_t awakeUs;         // Awake time of both wakes up to the first send, radio start included
+  int64_t radioInitUs;     // Part of awakeUs: radio start before the first send
+  int64_t jitterUs;        // Spread of the awake time per cycle (uniform +-)
+  double driftPpm;         // Station clocks are off by up to +-driftPpm
+  double spreadS;          // Power-on spread
+  double hidden;           // Chance that two stations cannot hear each other
+  int64_t procUs;          // OnDataRecv per frame
+  int rxQueue;             // Frames the gateway buffers while OnDataRecv runs
+  int macRetries;
+  int sendAttempts;        // ESPNOW_SEND_ATTEMPTS
+  int64_t retryBaseUs, retryMaxUs;
+  int64_t beaconUs;        // GATEWAY_BEACON_INTERVAL_MS
+  int64_t frameAirUs;      // Station frame
+  int64_t beaconAirUs;
+  int64_t ackAirUs;        // MAC ACK
+  double days;
+  uint32_t seed;
+};
+
+// ---- Results ----
+
+// Latency histogram, 0.1 ms buckets up to 60 s
+#define LAT_BUCKET_US 100
+#define LAT_BUCKETS 600000
+
+struct Result {
+  uint64_t readings = 0;        // Taken by the stations
+  uint64_t delivered = 0;       // Processed by the gateway
+  uint64_t lostRadio = 0;       // Given up after all retries, or overwritten in the batch ring
+  uint64_t lostGateway = 0;     // ACKed but dropped: gateway receive buffers full
+  uint64_t frames = 0;          // Frames the stations tried to send
+  uint64_t transmissions = 0;   // Times a frame went on air (MAC and firmware retries included)
+  uint64_t collisions = 0;      // Transmissions lost to an overlap
+  uint64_t busyUs = 0;          // Channel occupied (station frames + ACKs + beacons)
+  int maxQueue = 0;
+  double simSeconds = 0;
+  double wallSeconds = 0;
+  std::vector<uint32_t> latency;
+
+  double latencyQuantileMs(double q) const {
+    uint64_t total = 0;
+    for (uint32_t n : latency) total += n;
+    if (!total) return 0;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < latency.size(); ++b) {
+      seen += latency[b];
+      if (seen >= q * total) return (b + 1) * LAT_BUCKET_US / 1000.0;
+    }
+    return latency.size() * LAT_BUCKET_US / 1000.0;
+  }
+};
+
+// ---- Simulation ----
+
+enum EventType : uint8_t {
+  EV_TX_TRY,     // Station wants the channel (first try, after a backoff or a deferral)
+  EV_TX_END,     // Station frame + ACK exchange over
+  EV_GW_DONE,    // OnDataRecv finished the frame at the head of the gateway queue
+  EV_BEACON      // Gateway beacon due
+};
+
+struct Event {
+  int64_t t;
+  int32_t station;
+  EventType type;
+  bool operator>(const Event& o) const { return t > o.t; }
+};
+
+struct Station {
+  double clock;            // Sleep time multiplier (1 + drift)
+  int64_t readyUs;         // End of the sensor read of the newest reading
+  int pending;             // Readings in the batch ring
+  int sendEvery;           // Cycles until the next send
+  int attempt;             // Firmware send attempt (0-based)
+  int macTry;
+  int cw;
+  bool collided;           // Current transmission overlapped another one
+};
+
+struct Transmission {
+  int64_t start, airEnd, end;   // Frame on air until airEnd, ACK until end
+  int32_t station;              // -1: gateway beacon
+};
+
+struct GatewayFrame {
+  int64_t readyUs;
+  int readings;
+};
+
+class Simulation {
+public:
+  Simulation(const Params& p) : p(p), rng(p.seed) {}
+
+  Result run() {
+    auto wallStart = std::chrono::steady_clock::now();
+    res.latency.assign(LAT_BUCKETS, 0);
+    const int n = p.stations;
+    stations.resize(n);
+    if (p.hidden > 0) {
+      hiddenBits.assign(((size_t)n * n + 63) / 64, 0);
+      for (int a = 0; a < n; ++a) {
+        for (int b = a + 1; b < n; ++b) {
+          if (uniform() < p.hidden) {
+            setBit((size_t)a * n + b);
+            setBit((size_t)b * n + a);
+          }
+        }
+      }
+    }
+    for (int i = 0; i < n; ++i) {
+      Station& s = stations[i];
+      s.clock = 1.0 + (uniform() * 2 - 1) * p.driftPpm * 1e-6;
+      s.pending = 0;
+      s.sendEvery = p.batch;
+      int64_t powerOn = (int64_t)(uniform() * p.spreadS * 1e6);
+      startCycle(i, powerOn);
+    }
+    push({ 0, -1, EV_BEACON });
+
+    const int64_t endUs = (int64_t)(p.days * 86400e6);
+    while (!events.empty() && events.top().t < endUs) {
+      Event e = events.top();
+      events.pop();
+      now = e.t;
+      switch (e.type) {
+        case EV_TX_TRY: txTry(e.station); break;
+        case EV_TX_END: txEnd(e.station); break;
+        case EV_GW_DONE: gatewayDone(); break;
+        case EV_BEACON: beacon(); break;
+      }
+    }
+    res.simSeconds = endUs / 1e6;
+    res.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return res;
+  }
+
+private:
+  const Params& p;
+  std::mt19937_64 rng;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+  std::vector<Station> stations;
+  std::vector<uint64_t> hiddenBits;
+  std::vector<Transmission> onAir;       // Transmissions not over yet (a handful)
+  std::deque<GatewayFrame> gwQueue;      // Head is in OnDataRecv
+  int64_t now = 0;
+  int64_t busyUntil = 0;                 // For the channel occupancy count
+  Result res;
+
+  double uniform() { return (rng() >> 11) * (1.0 / 9007199254740992.0); }
+  int64_t jitter(int64_t range) { return range ? (int64_t)(rng() % (uint64_t)(2 * range + 1)) - range : 0; }
+  void setBit(size_t i) { hiddenBits[i >> 6] |= 1ULL << (i & 63); }
+  bool hears(int a, int b) const {
+    if (b < 0 || hiddenBits.empty()) return true;
+    size_t i = (size_t)a * p.stations + b;
+    return !(hiddenBits[i >> 6] & (1ULL << (i & 63)));
+  }
+  void push(const Event& e) { events.push(e); }
+
+  void occupy(int64_t start, int64_t end) {
+    if (end <= busyUntil) return;
+    res.busyUs += end - std::max(start, busyUntil);
+    busyUntil = end;
+  }
+
+  void prune() {
+    onAir.erase(std::remove_if(onAir.begin(), onAir.end(),
+                               [this](const Transmission& t) { return t.end <= now; }), onAir.end());
+  }
+
+  // A measurement cycle starting at the START_MEASURE wake at `start`: measurement wait (deep sleep,
+  // station clock), both wakes' awake time, then the radio if this cycle sends
+  void startCycle(int i, int64_t start) {
+    Station& s = stations[i];
+    int64_t awake = p.awakeUs + jitter(p.jitterUs);
+    int64_t sendAt = start + (int64_t)(p.measureUs * s.clock) + awake;
+    s.readyUs = sendAt - p.radioInitUs;
+    res.readings++;
+    if (s.pending == p.batch) res.lostRadio++;   // Ring full: the oldest reading is overwritten
+    else s.pending++;
+    if (--s.sendEvery > 0) {
+      // Radio stays off: back to sleep after the read
+      endCycle(i, s.readyUs);
+      return;
+    }
+    s.sendEvery = p.batch;
+    s.attempt = 0;
+    s.macTry = 0;
+    s.cw = CW_MIN;
+    res.frames++;
+    push({ sendAt, i, EV_TX_TRY });
+  }
+
+  // Long sleep for the rest of the interval (the awake time is not subtracted), then the next cycle
+  void endCycle(int i, int64_t t) {
+    Station& s = stations[i];
+    int64_t longSleep = p.intervalUs > p.measureUs ? p.intervalUs - p.measureUs : 100000;
+    startCycle(i, t + (int64_t)(longSleep * s.clock));
+  }
+
+  // Carrier sense, then transmit or defer
+  void txTry(int i) {
+    prune();
+    int64_t busy = 0;
+    for (const Transmission& t : onAir) {
+      // Heard one slot after it started (CCA); the ACK after a frame is heard as well
+      if (t.start + SLOT_US <= now && hears(i, t.station)) busy = std::max(busy, t.end);
+    }
+    Station& s = stations[i];
+    if (busy) {
+      push({ busy + DIFS_US + (int64_t)(rng() % (s.cw + 1)) * SLOT_US, i, EV_TX_TRY });
+      return;
+    }
+    Transmission tx;
+    tx.start = now;
+    tx.airEnd = now + p.frameAirUs;
+    tx.end = tx.airEnd + SIFS_US + p.ackAirUs;
+    tx.station = i;
+    s.collided = false;
+    // Any overlap with another frame on air at the gateway destroys both
+    for (const Transmission& t : onAir) {
+      if (t.start < tx.airEnd && tx.start < t.airEnd) {
+        if (t.station >= 0) stations[t.station].collided = true;
+        s.collided = true;
+      }
+    }
+    onAir.push_back(tx);
+    res.transmissions++;
+    push({ tx.end, i, EV_TX_END });
+  }
+
+  void txEnd(int i) {
+    Station& s = stations[i];
+    if (!s.collided) {
+      occupy(now - p.frameAirUs - SIFS_US - p.ackAirUs, now);
+      // MAC ACK sent; the gateway keeps the frame only if it has a free buffer
+      if ((int)gwQueue.size() < p.rxQueue) {
+        gwQueue.push_back({ s.readyUs, s.pending });
+        res.maxQueue = std::max(res.maxQueue, (int)gwQueue.size());
+        if (gwQueue.size() == 1) push({ now + p.procUs, -1, EV_GW_DONE });
+      } else {
+        res.lostGateway += s.pending;
+      }
+      s.pending = 0;
+      endCycle(i, now);
+      return;
+    }
+    occupy(now - p.frameAirUs - SIFS_US - p.ackAirUs, now - SIFS_US - p.ackAirUs);
+    res.collisions++;
+    if (s.macTry < p.macRetries) {
+      // MAC retransmission after the ACK timeout, contention window doubled
+      s.macTry++;
+      s.cw = std::min(2 * s.cw + 1, CW_MAX);
+      push({ now + DIFS_US + (int64_t)(rng() % (s.cw + 1)) * SLOT_US, i, EV_TX_TRY });
+      return;
+    }
+    // Send callback reports a failure: firmware backoff and retry (sendToGateway)
+    s.attempt++;
+    s.macTry = 0;
+    s.cw = CW_MIN;
+    if (s.attempt < p.sendAttempts) {
+      int64_t backoff = std::min(p.retryBaseUs << (s.attempt - 1), p.retryMaxUs);
+      backoff += (int64_t)(rng() % (uint64_t)p.retryBaseUs);
+      push({ now + backoff, i, EV_TX_TRY });
+      return;
+    }
+    // Given up; batched readings stay in the ring for the next frame
+    if (p.batch == 1) {
+      res.lostRadio += s.pending;
+      s.pending = 0;
+    }
+    endCycle(i, now);
+  }
+
+  void gatewayDone() {
+    const GatewayFrame& f = gwQueue.front();
+    res.delivered += f.readings;
+    int64_t b = (now - f.readyUs) / LAT_BUCKET_US;
+    res.latency[b < LAT_BUCKETS ? b : LAT_BUCKETS - 1] += f.readings;
+    gwQueue.pop_front();
+    if (!gwQueue.empty()) push({ now + p.procUs, -1, EV_GW_DONE });
+  }
+
+  // sendBeacon() from the gateway loop: carrier sense like any sender, no ACK
+  void beacon() {
+    prune();
+    int64_t busy = 0;
+    for (const Transmission& t : onAir) {
+      if (t.start + SLOT_US <= now) busy = std::max(busy, t.end);
+    }
+    if (busy) {
+      push({ busy + DIFS_US + (int64_t)(rng() % (CW_MIN + 1)) * SLOT_US, -1, EV_BEACON });
+      return;
+    }
+    Transmission tx;
+    tx.start = now;
+    tx.airEnd = tx.end = now + p.beaconAirUs;
+    tx.station = -1;
+    for (const Transmission& t : onAir) {
+      if (t.start < tx.airEnd && tx.start < t.airEnd && t.station >= 0) stations[t.station].collided = true;
+    }
+    onAir.push_back(tx);
+    occupy(tx.start, tx.end);
+    push({ now + p.beaconUs, -1, EV_BEACON });
+  }
+};
+
+// ---- Command line ----
+
+static std::vector<int> parseIntList(const char* arg) {
+  std::vector<int> out;
+  const char* s = arg;
+  while (*s) {
+    char* end;
+    long v = strtol(s, &end, 10);
+    if (end == s || v < 1) {
+      fprintf(stderr, "bad list '%s'\n", arg);
+      exit(1);
+    }
+    out.push_back((int)v);
+    s = *end == ',' ? end + 1 : end;
+    if (*end && *end != ',') {
+      fprintf(stderr, "bad list '%s'\n", arg);
+      exit(1);
+    }
+  }
+  return out;
+}
+
+int main(int argc, char** argv) {
+  const char* includeDir = "include";
+  const char* stationList = "10,50,100,200,500,1000";
+  int interval = 0, batch = 0, threads = (int)std::thread::hardware_concurrency();
+  double days = 7;
+  bool json = false;
+  Params p = {};
+  p.jitterUs = 2000;
+  p.driftPpm = 2000;   // RTC slow clock (internal 150 kHz RC, calibrated); a 32 kHz crystal is ~20 ppm
+  p.hidden = 0;
+  p.procUs = 10;       // OnDataRecv, native bench p50 (see the top of the file)
+  p.rxQueue = 32;      // Wi-Fi dynamic receive buffers (Arduino-ESP32 default)
+  p.macRetries = 7;
+  p.seed = 1;
+  int64_t awakeMs = 110, radioInitMs = 60;
+
+  for (int i = 1; i < argc; ++i) {
+    const char* a = argv[i];
+    bool more = i + 1 < argc;
+    if (parseDefineArg(a)) continue;
+    if (strcmp(a, "--stations") == 0 && more) stationList = argv[++i];
+    else if (strcmp(a, "--interval") == 0 && more) interval = atoi(argv[++i]);
+    else if (strcmp(a, "--batch") == 0 && more) batch = atoi(argv[++i]);
+    else if (strcmp(a, "--days") == 0 && more) days = atof(argv[++i]);
+    else if (strcmp(a, "--drift-ppm") == 0 && more) p.driftPpm = atof(argv[++i]);
+    else if (strcmp(a, "--jitter-ms") == 0 && more) p.jitterUs = (int64_t)(atof(argv[++i]) * 1000);
+    else if (strcmp(a, "--spread-s") == 0 && more) p.spreadS = atof(argv[++i]);
+    else if (strcmp(a, "--hidden") == 0 && more) p.hidden = atof(argv[++i]);
+    else if (strcmp(a, "--proc-us") == 0 && more) p.procUs = atoll(argv[++i]);
+    else if (strcmp(a, "--rx-queue") == 0 && more) p.rxQueue = atoi(argv[++i]);
+    else if (strcmp(a, "--mac-retries") == 0 && more) p.macRetries = atoi(argv[++i]);
+    else if (strcmp(a, "--awake-ms") == 0 && more) awakeMs = atoll(argv[++i]);
+    else if (strcmp(a, "--seed") == 0 && more) p.seed = (uint32_t)atoi(argv[++i]);
+    else if (strcmp(a, "--threads") == 0 && more) threads = atoi(argv[++i]);
+    else if (strcmp(a, "--config") == 0 && more) includeDir = argv[++i];
+    else if (strcmp(a, "--json") == 0) json = true;
+    else {
+      fprintf(stderr,
+        "usage: %s [--stations N,..] [--days D] [--interval S] [--batch N] [--drift-ppm P]\n"
+        "          [--jitter-ms MS] [--spread-s S] [--hidden P] [--proc-us US] [--rx-queue N]\n"
+        "          [--mac-retries N] [--awake-ms MS] [--seed N] [--threads N] [-DNAME=VALUE]\n"
+        "          [--config DIR] [--json]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (threads < 1) threads = 1;
+  if (!readFirmwareDefines(includeDir)) return 1;
+
+  p.intervalUs = (int64_t)(interval ? interval : defineValue("MEASUREMENT_INTERVAL")) * 1000000;
+  p.batch = batch ? batch : (int)defineValue("STATION_BATCH_READINGS");
+  if (p.batch < 1 || p.batch > MULTI_MAX_READINGS) {
+    fprintf(stderr, "--batch must be 1..%d\n", MULTI_MAX_READINGS);
+    return 1;
+  }
+  p.measureUs = defineValue("SCD41_PERIODIC_FIRST_MS") * 1000;
+  p.awakeUs = awakeMs * 1000;
+  p.radioInitUs = radioInitMs * 1000;
+  p.sendAttempts = (int)defineValue("ESPNOW_SEND_ATTEMPTS");
+  p.retryBaseUs = defineValue("ESPNOW_RETRY_BASE_MS") * 1000;
+  p.retryMaxUs = defineValue("ESPNOW_RETRY_MAX_MS") * 1000;
+  p.beaconUs = defineValue("GATEWAY_BEACON_INTERVAL_MS") * 1000;
+  size_t payload = p.batch > 1 ? sizeof(WireMulti) + p.batch * sizeof(WireMultiEntry) : sizeof(WireSensor);
+  p.frameAirUs = airtimeUs(ESPNOW_OVERHEAD_BYTES + payload);
+  p.beaconAirUs = airtimeUs(ESPNOW_OVERHEAD_BYTES + sizeof(WireBeacon));
+  p.ackAirUs = airtimeUs(MAC_ACK_BYTES);
+  p.days = days;
+
+  std::vector<int> counts = parseIntList(stationList);
+  std::vector<Params> runs(counts.size(), p);
+  for (size_t i = 0; i < counts.size(); ++i) runs[i].stations = counts[i];
+  std::vector<Result> results(runs.size());
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> workers;
+  for (int w = 0; w < threads && w < (int)runs.size(); ++w) {
+    workers.emplace_back([&]() {
+      for (size_t i; (i = next++) < runs.size();) results[i] = Simulation(runs[i]).run();
+    });
+  }
+  for (auto& w : workers) w.join();
+
+  if (json) printf("[\n");
+  else {
+    printf("%.1f days, interval %lld s, %d reading(s) per %u-byte frame (%lld us on air), OnDataRecv %lld us,\n"
+           "drift +-%.0f ppm, jitter +-%lld ms, power-on spread %.0f s, hidden pairs %.0f%%\n",
+           days, (long long)(p.intervalUs / 1000000), p.batch, (unsigned)payload, (long long)p.frameAirUs,
+           (long long)p.procUs, p.driftPpm, (long long)(p.jitterUs / 1000), p.spreadS, p.hidden * 100);
+    printf("%8s %9s %8s %8s %10s %7s %8s %9s %9s %9s %6s %7s\n", "stations", "delivered", "lost rf",
+           "lost gw", "collisions", "tx/frm", "channel", "p50 ms", "p99 ms", "p999 ms", "max q", "wall s");
+  }
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const Result& r = results[i];
+    double delivered = r.readings ? (double)r.delivered / r.readings : 0;
+    double collisionRate = r.transmissions ? (double)r.collisions / r.transmissions : 0;
+    double txPerFrame = r.frames ? (double)r.transmissions / r.frames : 0;
+    double channel = r.simSeconds ? r.busyUs / (r.simSeconds * 1e6) : 0;
+    if (json) {
+      printf("  {\"stations\": %d, \"readings\": %llu, \"delivered\": %llu, \"delivery_ratio\": %.5f, "
+             "\"lost_radio\": %llu, \"lost_gateway\": %llu, \"transmissions\": %llu, \"collision_rate\": %.5f, "
+             "\"tx_per_frame\": %.3f, \"channel_busy\": %.5f, \"latency_ms\": {\"p50\": %.1f, \"p99\": %.1f, "
+             "\"p999\": %.1f}, \"max_gateway_queue\": %d, \"wall_s\": %.2f}%s\n",
+             runs[i].stations, (unsigned long long)r.readings, (unsigned long long)r.delivered, delivered,
+             (unsigned long long)r.lostRadio, (unsigned long long)r.lostGateway,
+             (unsigned long long)r.transmissions, collisionRate, txPerFrame, channel,
+             r.latencyQuantileMs(0.5), r.latencyQuantileMs(0.99), r.latencyQuantileMs(0.999), r.maxQueue,
+             r.wallSeconds, i + 1 < runs.size() ? "," : "");
+    } else {
+      printf("%8d %8.3f%% %8llu %8llu %9.2f%% %7.2f %7.2f%% %9.1f %9.1f %9.1f %6d %7.2f\n", runs[i].stations,
+             delivered * 100, (unsigned long long)r.lostRadio, (unsigned long long)r.lostGateway,
+             collisionRate * 100, txPerFrame, channel * 100, r.latencyQuantileMs(0.5), r.latencyQuantileMs(0.99),
+             r.latencyQuantileMs(0.999), r.maxQueue, r.wallSeconds);
+    }
+  }
+  if (json) printf("]\n");
+  return 0;
+}
@@ -0,0 +1,325 @@
+// Host tool for the gateway write-ahead log (include/flash_wal.h).
+//
+// Build (from the project root):
+//   g++ -O2 -std=c++17 -Iinclude tools/wal_reader.cpp -o wal_reader
+//
+// Read a log copied off the gateway:
+//   esptool.py read_flash 0x290000 0x160000 wal.bin          (offset/size from partitions_gateway.csv)
+//   mklittlefs -u wal_dump -b 4096 -p 256 -s 0x160000 wal.bin
+//   ./wal_reader wal_dump              all records as CSV, plus a per-segment summary
+//   ./wal_reader wal_dump --pending    only records after the upload cursor
+//
+// Power-loss check:
+//   ./wal_reader --simulate-power-loss
+// writes a log into a RAM "flash", cuts the power at every byte of the page writes around a
+// segment boundary (torn pages, both shortened and garbage-filled), reboots and checks that
+// every committed reading after the saved cursor is recovered unchanged, nothing else is
+// returned, and sequence numbers keep increasing. Exits non-zero on the first failure.
+
+#include <dirent.h>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "flash_wal.h"
+
+// Segment files "seg00000012.wal" and "cursor" in a directory
+class DirStorage {
+public:
+  explicit DirStorage(const char* dir) : dir(dir) {}
+
+  bool segmentRange(uint32_t& first, uint32_t& last) {
+    DIR* d = opendir(dir);
+    if (!d) return false;
+    bool found = false;
+    while (struct dirent* e = readdir(d)) {
+      unsigned long seg;
+      char tail[8];
+      if (sscanf(e->d_name, "seg%8lu%7s", &seg, tail) == 2 && strcmp(tail, ".wal") == 0) {
+        if (!found || seg < first) first = seg;
+        if (!found || seg > last) last = seg;
+        found = true;
+      }
+    }
+    closedir(d);
+    return found;
+  }
+
+  uint32_t segmentPages(uint32_t seg) {
+    FILE* f = open(seg, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size / WAL_PAGE_SIZE;
+  }
+
+  bool readPage(uint32_t seg, uint32_t page, uint8_t* buf) {
+    FILE* f = open(seg, "rb");
+    if (!f) return false;
+    bool ok = fseek(f, (long)page * WAL_PAGE_SIZE, SEEK_SET) == 0 && fread(buf, 1, WAL_PAGE_SIZE, f) == WAL_PAGE_SIZE;
+    fclose(f);
+    return ok;
+  }
+
+  bool appendPage(uint32_t seg, const uint8_t* buf) {
+    FILE* f = open(seg, "ab");
+    if (!f) return false;
+    bool ok = fwrite(buf, 1, WAL_PAGE_SIZE, f) == WAL_PAGE_SIZE;
+    return fclose(f) == 0 && ok;
+  }
+
+  void removeSegment(uint32_t seg) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/seg%08lu.wal", dir, (unsigned long)seg);
+    remove(path);
+  }
+
+  bool loadCursor(uint8_t* buf, size_t len) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/cursor", dir);
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    bool ok = fread(buf, 1, len, f) == len;
+    fclose(f);
+    return ok;
+  }
+
+  bool saveCursor(const uint8_t* buf, size_t len) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/cursor", dir);
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(buf, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+  }
+
+private:
+  FILE* open(uint32_t seg, const char* mode) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/seg%08lu.wal", dir, (unsigned long)seg);
+    return fopen(path, mode);
+  }
+
+  const char* dir;
+};
+
+// "Flash" in RAM that loses power after a given number of written bytes
+class PowerLossStorage {
+public:
+  PowerLossStorage() : budget(-1), garbageTail(false) {}
+
+  // Power fails after `bytes` more bytes of page data. A torn page is either cut short (the
+  // file ends mid-page) or has its tail filled with garbage (page-sized, bad CRC).
+  void cutPowerAfter(long bytes, bool garbage) { budget = bytes; garbageTail = garbage; }
+  void powerOn() { budget = -1; }
+  bool powered() const { return budget != 0; }
+
+  bool segmentRange(uint32_t& first, uint32_t& last) {
+    if (segs.empty()) return false;
+    first = segs.begin()->first;
+    last = segs.rbegin()->first;
+    return true;
+  }
+  uint32_t segmentPages(uint32_t seg) {
+    auto it = segs.find(seg);
+    return it == segs.end() ? 0 : it->second.size() / WAL_PAGE_SIZE;
+  }
+  bool readPage(uint32_t seg, uint32_t page, uint8_t* buf) {
+    auto it = segs.find(seg);
+    if (it == segs.end() || (page + 1) * WAL_PAGE_SIZE > it->second.size()) return false;
+    memcpy(buf, it->second.data() + (size_t)page * WAL_PAGE_SIZE, WAL_PAGE_SIZE);
+    return true;
+  }
+  bool appendPage(uint32_t seg, const uint8_t* buf) {
+    if (budget == 0) return false;
+    std::vector<uint8_t>& f = segs[seg];
+    if (budget > 0 && budget < WAL_PAGE_SIZE) {
+      f.insert(f.end(), buf, buf + budget);
+      if (garbageTail) f.resize(f.size() + WAL_PAGE_SIZE - budget, 0xA5);
+      budget = 0;
+      return false;
+    }
+    f.insert(f.end(), buf, buf + WAL_PAGE_SIZE);
+    if (budget > 0) budget -= WAL_PAGE_SIZE;
+    return true;
+  }
+  void removeSegment(uint32_t seg) {
+    if (budget != 0) segs.erase(seg);
+  }
+  bool loadCursor(uint8_t* buf, size_t len) {
+    if (cursor.size() != len) return false;
+    memcpy(buf, cursor.data(), len);
+    return true;
+  }
+  bool saveCursor(const uint8_t* buf, size_t len) {
+    if (budget == 0) return false;
+    cursor.assign(buf, buf + len);  // Atomic, like a LittleFS file rewrite
+    return true;
+  }
+
+private:
+  std::map<uint32_t, std::vector<uint8_t>> segs;
+  std::vector<uint8_t> cursor;
+  long budget;
+  bool garbageTail;
+};
+
+static WalRecord makeRecord(uint32_t i) {
+  WalRecord r;
+  r.seq = 0;
+  uint8_t mac[6] = {0x24, 0x6F, 0x28, 0x00, (uint8_t)(i >> 8), (uint8_t)i};
+  memcpy(r.mac, mac, 6);
+  r.rssi = -40 - (int16_t)(i % 50);
+  r.temperature = 18.0f + (i % 700) / 100.0f;
+  r.humidity = 30.0f + (i % 4000) / 100.0f;
+  r.co2 = 400 + i % 2000;
+  r.unix_s = 1700000000 + i * 10;
+  return r;
+}
+
+static bool sameReading(const WalRecord& a, const WalRecord& b) {
+  return memcmp(a.mac, b.mac, 6) == 0 && a.rssi == b.rssi && a.temperature == b.temperature &&
+         a.humidity == b.humidity && a.co2 == b.co2 && a.unix_s == b.unix_s;
+}
+
+// One power-loss run: write, cut, reboot, verify, write more, reboot, verify again.
+// Returns an error message, or NULL if the run passed.
+static const char* powerLossRun(long cutAt, bool garbage, uint32_t& checked) {
+  PowerLossStorage flash;
+  std::map<uint32_t, WalRecord> written;   // Everything append() accepted, by seq
+  uint32_t now = 0;
+  uint32_t i = 0;
+
+  // Before the cut: readings arrive, uploads confirm them in bursts, 40..90 readings behind
+  {
+    FlashWal<PowerLossStorage> wal(flash);
+    wal.begin();
+    flash.cutPowerAfter(cutAt, garbage);
+    while (flash.powered() && i < 100000) {
+      WalRecord r = makeRecord(i++);
+      r.seq = wal.append(r, now);
+      written[r.seq] = r;
+      now += 1000;
+      if (i % 50 == 0) wal.setCursor(wal.nextSeq() - 40);
+      wal.tick(now);
+    }
+    if (i >= 100000) return "power was never cut";
+  }
+
+  // Reboot: committed readings from the saved cursor on must come back
+  flash.powerOn();
+  FlashWal<PowerLossStorage> wal(flash);
+  wal.begin();
+  uint32_t cursor = wal.cursor();
+  uint32_t expect = cursor;
+  const char* err = NULL;
+  wal.replay(cursor, [&](const WalRecord& r) {
+    if (err) return;
+    auto it = written.find(r.seq);
+    if (r.seq != expect) err = "replay skipped or reordered a record";
+    else if (it == written.end() || !sameReading(it->second, r)) err = "replayed record differs from what was written";
+    expect = r.seq + 1;
+    checked++;
+  });
+  if (err) return err;
+  // Only the open page (up to one page of readings) and the torn page may be missing
+  if (written.rbegin()->first + 1 - expect > 2 * WAL_RECORDS_PER_PAGE) return "too many committed records lost";
+  if (wal.nextSeq() < expect) return "sequence number went backwards";
+
+  // The log keeps working after the reboot
+  uint32_t firstNew = wal.nextSeq();
+  for (int k = 0; k < 3 * WAL_RECORDS_PER_PAGE; ++k) {
+    WalRecord r = makeRecord(i++);
+    r.seq = wal.append(r, now);
+    written[r.seq] = r;
+    now += 1000;
+  }
+  wal.commit();
+  FlashWal<PowerLossStorage> again(flash);
+  again.begin();
+  uint32_t seen = 0;
+  again.replay(firstNew, [&](const WalRecord& r) {
+    if (!sameReading(written[r.seq], r)) err = "record written after reboot differs";
+    seen++;
+  });
+  if (err) return err;
+  if (seen != 3 * WAL_RECORDS_PER_PAGE) return "records written after reboot were lost";
+  if (again.cursor() != cursor) return "cursor changed across a clean reboot";
+  return NULL;
+}
+
+static int simulatePowerLoss() {
+  // Cut points: every byte of the pages around the first segment rotation, then every page
+  // boundary of a few more segments (cursor saves and segment cleanup happen in between)
+  long rotation = (long)WAL_SEGMENT_PAGES * WAL_PAGE_SIZE;
+  std::vector<long> cuts;
+  for (long b = rotation - 2 * WAL_PAGE_SIZE; b <= rotation + 2 * WAL_PAGE_SIZE; ++b) cuts.push_back(b);
+  for (long b = WAL_PAGE_SIZE / 2; b < 6 * rotation; b += WAL_PAGE_SIZE) cuts.push_back(b);
+
+  uint32_t runs = 0, checked = 0;
+  for (long cut : cuts) {
+    for (int garbage = 0; garbage < 2; ++garbage) {
+      const char* err = powerLossRun(cut, garbage, checked);
+      runs++;
+      if (err) {
+        printf("FAIL: power cut after %ld bytes (%s tail): %s\n", cut, garbage ? "garbage" : "short", err);
+        return 1;
+      }
+    }
+  }
+  printf("OK: %u power cuts, %u replayed readings checked\n", runs, checked);
+  return 0;
+}
+
+static int dump(const char* dir, bool pendingOnly) {
+  DirStorage storage(dir);
+  uint32_t first, last;
+  if (!storage.segmentRange(first, last)) {
+    fprintf(stderr, "No segments in %s\n", dir);
+    return 1;
+  }
+  FlashWal<DirStorage> wal(storage);
+  wal.begin();
+  uint32_t cursor = wal.cursor();
+
+  printf("seq,mac,temperature,humidity,co2,rssi,unix_s,uploaded\n");
+  uint32_t records = 0, pending = 0;
+  wal.replay(pendingOnly ? cursor : 0, [&](const WalRecord& r) {
+    char co2[8] = "";   // Empty for a reading without CO2
+    if (r.co2 != CO2_NONE) snprintf(co2, sizeof(co2), "%u", r.co2);
+    printf("%u,%02X:%02X:%02X:%02X:%02X:%02X,%.2f,%.2f,%s,%d,%u,%d\n", r.seq,
+           r.mac[0], r.mac[1], r.mac[2], r.mac[3], r.mac[4], r.mac[5],
+           r.temperature, r.humidity, co2, r.rssi, r.unix_s, r.seq < cursor);
+    records++;
+    if (r.seq >= cursor) pending++;
+  });
+
+  fprintf(stderr, "Segments %u..%u:\n", first, last);
+  uint8_t page[WAL_PAGE_SIZE];
+  for (uint32_t seg = first; seg <= last; ++seg) {
+    uint32_t pages = storage.segmentPages(seg), valid = 0, n = 0;
+    for (uint32_t p = 0; p < pages; ++p) {
+      uint8_t c = storage.readPage(seg, p, page) ? walPageValid(page) : 0;
+      if (c) valid++;
+      n += c;
+    }
+    fprintf(stderr, "  seg%08u: %u pages (%u corrupt), %u records\n", seg, pages, pages - valid, n);
+  }
+  fprintf(stderr, "Cursor %u, next seq %u: %u records shown, %u not uploaded, %u corrupt pages\n",
+          cursor, wal.nextSeq(), records, pending, wal.corruptPages);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "--simulate-power-loss") == 0) {
+    return simulatePowerLoss();
+  }
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <dir> [--pending] | --simulate-power-loss\n", argv[0]);
+    return 2;
+  }
+  return dump(argv[1], argc > 2 && strcmp(argv[2], "--pending") == 0);
+}